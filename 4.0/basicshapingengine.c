@@ -585,6 +585,7 @@ static void create_layout(ParagraphInfo* p)
     p->textruns = CreateTextRuns(p->ucs, p->nr_ucs,
             LANGCODE_unknown, BIDI_PGDIR_LTR,
             _font_cases[_curr_font], MakeRGB(0, 0, 0), 0, p->bos + 1);
+    startup_trace_mark("textruns");
 
     if (p->textruns) {
         if (!InitBasicShapingEngine(p->textruns)) {
@@ -592,6 +593,7 @@ static void create_layout(ParagraphInfo* p)
                     __FUNCTION__);
             exit(1);
         }
+        startup_trace_mark("shaping");
 
         p->layout = CreateLayout(p->textruns,
                 render_flags,
@@ -600,12 +602,14 @@ static void create_layout(ParagraphInfo* p)
             _ERR_PRINTF("%s: CreateLayout returns NULL\n", __FUNCTION__);
             exit(1);
         }
+        startup_trace_mark("create-layout");
 
         LAYOUTLINE* line = NULL;
         int i = 1;
         while ((line = LayoutNextLine(p->layout, line, 100 * i, 0, NULL, 0))) {
             i++;
         }
+        startup_trace_mark("layout-lines");
     }
     else {
         _ERR_PRINTF("%s: CreateTextRuns returns NULL\n", __FUNCTION__);
@@ -653,20 +657,27 @@ static inline void dump_glyphs_and_breaks(const char* text,
         const Uchar32* ucs, const Uint16* bos, int n)
 {
     int i;
-    char* tmp = _utf8_str;
 
     printf("START OF DUMPING GLYPHS AND BREAKS\n");
     printf("==================================\n");
 
     memset(_utf8_str, 0, 5000);
-    for (i = 0; i < n; i++) {
-        int len;
-        Uchar32 uc = ucs[i];
+    if (uc32s_to_utf8(ucs, n, _utf8_str, 4990, NULL) < 0) {
+        /* lone surrogates or out-of-range code points; go one by one */
+        char* tmp = _utf8_str;
 
-        if ((tmp - _utf8_str) < 4990) {
-            len = uc32_to_utf8(uc, tmp);
-            tmp += len;
+        memset(_utf8_str, 0, 5000);
+        for (i = 0; i < n && (tmp - _utf8_str) < 4990; i++) {
+            Uchar32 uc = ucs[i];
+
+            if ((uc >= 0xD800 && uc <= 0xDFFF) || uc > 0x10FFFF)
+                uc = 0xFFFD;
+            tmp += uc32_to_utf8(uc, tmp);
         }
+    }
+
+    for (i = 0; i < n; i++) {
+        Uchar32 uc = ucs[i];
 
         printf("%04X(%s, %s)\n", uc,
             get_general_category_name(UCharGetCategory(uc)),
@@ -745,6 +756,7 @@ static void create_paragraphs(void)
     int left_len_text;
 
     text = get_text_case(_text_cases[_curr_text], _text_from_file, 4096);
+    startup_trace_mark("load-text");
 
     strcpy (charset, "utf-8");
     if (text == _text_from_file) {
@@ -756,6 +768,7 @@ static void create_paragraphs(void)
                 __FUNCTION__, charset);
         exit(1);
     }
+    startup_trace_mark("charset-logfont");
 
     destroy_paragraphs();
 
@@ -770,6 +783,7 @@ static void create_paragraphs(void)
         consumed = GetUCharsUntilParagraphBoundary(lf, text, left_len_text,
                 (Uint8)_wsr_cases[_curr_wsr].rule,
                 &ucs, &n);
+        startup_trace_mark("paragraph-split");
         if (consumed > 0) {
 
             _MG_PRINTF("%s: GetUCharsUntilParagraphBoundary: bytes: %d, glyphs: %d\n",
@@ -789,6 +803,7 @@ static void create_paragraphs(void)
                     (Uint8)_wbr_cases[_curr_wbr].rule,
                     (Uint8)_lbp_cases[_curr_lbp].rule,
                     ucs, n, &bos);
+                startup_trace_mark("breaks");
 
                 if (len_bos > 0) {
                     //dump_glyphs_and_breaks(text, ucs, bos, n);
@@ -1026,6 +1041,7 @@ LRESULT MyMainWinProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
     case MSG_PAINT: {
         HDC hdc;
         hdc = BeginPaint(hWnd);
+        startup_trace_mark("begin-paint");
         output_rules(hdc);
 
         SetPenColor(hdc, PIXEL_red);
@@ -1038,7 +1054,11 @@ LRESULT MyMainWinProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
             render_paragraphs_draw_line(hdc);
         }
         paint_count++;
+        startup_trace_mark("render");
         EndPaint(hWnd, hdc);
+        startup_trace_mark("end-paint");
+        if (startup_trace_end("basicshapingengine"))
+            exit(0);
         return 0;
     }
 
@@ -1172,6 +1192,8 @@ int MiniGUIMain (int argc, const char* argv[])
     MAINWINCREATE CreateInfo;
     HWND hMainWnd;
 
+    startup_trace_begin();
+
     srandom(time(NULL));
     if (argc > 1)
         _auto_test_runs = atoi(argv[1]);
@@ -1197,6 +1219,7 @@ int MiniGUIMain (int argc, const char* argv[])
         printf ("InitVectorialFonts: error.\n");
         exit (2);
     }
+    startup_trace_mark("join-layer");
 #endif
 
     for (i = 0; i < TABLESIZE(_devfontinfo); i++) {
@@ -1207,14 +1230,17 @@ int MiniGUIMain (int argc, const char* argv[])
                 __FUNCTION__, _devfontinfo[i].fontname, _devfontinfo[i].filename);
         }
     }
+    startup_trace_mark("load-devfonts");
 
     InitCreateInfo (&CreateInfo);
 
     hMainWnd = CreateMainWindow (&CreateInfo);
     if (hMainWnd == HWND_INVALID)
         exit (3);
+    startup_trace_mark("create-main-window");
 
     ShowWindow (hMainWnd, SW_SHOWNORMAL);
+    startup_trace_mark("show-window");
     while (GetMessage (&Msg, hMainWnd)) {
         TranslateMessage (&Msg);
         DispatchMessage (&Msg);
@@ -0,0 +1,431 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//                        IMPORTANT LEGAL NOTICE
+//
+// The following open source license statement does not apply to any
+// entity in the Exception List published by FMSoft.
+//
+// For more information, please visit:
+//
+// https://www.fmsoft.cn/exception-list
+//
+//////////////////////////////////////////////////////////////////////////////
+/*
+** concurrentlayout.c:
+**
+**  Stress test and benchmark for laying out and drawing text in several
+**  threads at the same time under MiniGUI-Threads. Every thread lays out
+**  the same paragraphs and draws them into its own memory DC; the glyph
+**  positions and the pixels are checked against the golden output of a
+**  single-threaded run, and the scaling curve is reported.
+**
+**  The following APIs are covered:
+**
+**      CreateTextRuns
+**      InitBasicShapingEngine
+**      UStrGetBreaks
+**      CreateLayout
+**      LayoutNextLine
+**      DrawLayoutLine
+**      CreateMemDC
+**      LockDC/UnlockDC
+**
+**  Usage: concurrentlayout [-synth <spec>] [-seed <seed>] [max_threads] [nr_loops]
+**
+**  With -synth, the paragraphs are synthetic text (see parse_synth_spec()
+**  in helpers.c) instead of random picks from a small word list.
+**
+** Copyright (C) 2019 FMSoft (http://www.fmsoft.cn).
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <minigui/common.h>
+#include <minigui/minigui.h>
+#include <minigui/gdi.h>
+#include <minigui/window.h>
+
+#if (_MINIGUI_VERSION_CODE >= _VERSION_CODE(4,0,0)) \
+        && defined(_MGCHARSET_UNICODE) && defined(_MGRM_THREADS)
+
+#include "helpers.h"
+
+#define DEF_MAX_THREADS     8
+#define DEF_NR_LOOPS        4
+
+#define NR_PARAGRAPHS       24
+#define NR_PARAGRAPH_WORDS  80
+#define MAX_PARAGRAPH_LEN   4096
+#define NR_SYNTH_PARAGRAPH_CHARS    400
+
+#define CANVAS_WIDTH        320
+#define CANVAS_HEIGHT       480
+
+#define LAYOUT_FONT  "ttf-Courier,宋体,Naskh,SansSerif-rrncns-U-16-UTF-8"
+
+static const char* _words[] = {
+    "The", "quick", "brown", "fox", "jumps", "over", "the", "lazy", "dog.",
+    "MiniGUI", "lays", "out", "text", "in", "several", "threads",
+    "人之初，", "性本善。", "性相近，", "习相远。", "苟不教，", "性乃迁。",
+    "Привет,", "мир!", "Ελληνικά", "한국어", "日本語",
+    "مرحبا", "بالعالم", "שלום", "עולם",
+};
+
+struct paragraph {
+    Uchar32*    ucs;
+    int         nr_ucs;
+    Uint64      golden;     // the checksum got by the single-threaded run
+};
+
+static struct paragraph _paragraphs[NR_PARAGRAPHS];
+
+struct thread_info {
+    pthread_t   th;
+    int         nr_loops;
+    int         nr_mismatched;
+    int         nr_laid_out;
+};
+
+static pthread_barrier_t _start_barrier;
+
+#define FNV_OFFSET_BASIS    0xCBF29CE484222325ULL
+#define FNV_PRIME           0x100000001B3ULL
+
+static inline Uint64 fnv1a(Uint64 hash, const void* data, size_t len)
+{
+    const Uint8* p = data;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+static BOOL on_glyph_laid_out(GHANDLE ctxt, Glyph32 gv,
+        const GLYPHPOS* pos, const RENDERDATA* data)
+{
+    Uint64* hash = (Uint64*)ctxt;
+
+    *hash = fnv1a(*hash, &gv, sizeof(gv));
+    *hash = fnv1a(*hash, &pos->x, sizeof(pos->x));
+    *hash = fnv1a(*hash, &pos->y, sizeof(pos->y));
+    *hash = fnv1a(*hash, &pos->advance, sizeof(pos->advance));
+    *hash = fnv1a(*hash, &data->uc_index, sizeof(data->uc_index));
+    return TRUE;
+}
+
+static void create_paragraphs(const struct synth_mix* mix, unsigned int seed)
+{
+    char utf8[MAX_PARAGRAPH_LEN];
+    int i, j;
+
+    /* all runs must lay out the same text */
+    srandom(seed);
+
+    for (i = 0; i < NR_PARAGRAPHS; i++) {
+        int len = 0;
+
+        if (mix) {
+            _paragraphs[i].nr_ucs = NR_SYNTH_PARAGRAPH_CHARS;
+            _paragraphs[i].ucs = malloc(sizeof(Uchar32) *
+                    NR_SYNTH_PARAGRAPH_CHARS);
+            generate_synth_text(seed + i, mix, _paragraphs[i].ucs,
+                    NR_SYNTH_PARAGRAPH_CHARS);
+            continue;
+        }
+
+        for (j = 0; j < NR_PARAGRAPH_WORDS; j++) {
+            const char* word = _words[random() % TABLE_SIZE(_words)];
+            int word_len = strlen(word);
+
+            if (len + word_len + 1 >= MAX_PARAGRAPH_LEN)
+                break;
+
+            memcpy(utf8 + len, word, word_len);
+            len += word_len;
+            utf8[len++] = ' ';
+        }
+
+        _paragraphs[i].ucs = malloc(sizeof(Uchar32) * len);
+        _paragraphs[i].nr_ucs = utf8_to_uc32s(utf8, len,
+                _paragraphs[i].ucs, len, NULL);
+        if (_paragraphs[i].nr_ucs <= 0) {
+            _ERR_PRINTF("%s: bad paragraph text\n", __FUNCTION__);
+            exit(1);
+        }
+    }
+}
+
+static void destroy_paragraphs(void)
+{
+    int i;
+
+    for (i = 0; i < NR_PARAGRAPHS; i++) {
+        free(_paragraphs[i].ucs);
+    }
+}
+
+/*
+ * Lay out and draw one paragraph from scratch, as a window does when
+ * handling MSG_PAINT; returns the checksum of the glyph positions and
+ * the pixels drawn.
+ */
+static Uint64 layout_paragraph(HDC hdc, const struct paragraph* parag)
+{
+    TEXTRUNS* runs;
+    LAYOUT* layout;
+    LAYOUTLINE* line = NULL;
+    BreakOppo* bos = NULL;
+    Uint64 hash = FNV_OFFSET_BASIS;
+    Uint8* bits;
+    int y = 0;
+    int width, height, pitch, i;
+
+    if (UStrGetBreaks(LANGCODE_unknown, CTR_NONE, WBR_NORMAL, LBP_NORMAL,
+            parag->ucs, parag->nr_ucs, &bos) <= 0) {
+        _ERR_PRINTF("%s: UStrGetBreaks failed\n", __FUNCTION__);
+        exit(1);
+    }
+
+    runs = CreateTextRuns(parag->ucs, parag->nr_ucs, LANGCODE_unknown,
+            BIDI_PGDIR_WLTR, LAYOUT_FONT, MakeRGB(0, 0, 0), 0, NULL);
+    if (runs == NULL) {
+        _ERR_PRINTF("%s: CreateTextRuns returns NULL\n", __FUNCTION__);
+        exit(1);
+    }
+
+    if (!InitBasicShapingEngine(runs)) {
+        _ERR_PRINTF("%s: InitBasicShapingEngine returns FALSE\n",
+                __FUNCTION__);
+        exit(1);
+    }
+
+    layout = CreateLayout(runs, GRF_LINE_EXTENT_VARIABLE, bos + 1, FALSE,
+            0, 0, 0, 0, 10, NULL, 0);
+    if (layout == NULL) {
+        _ERR_PRINTF("%s: CreateLayout returns NULL\n", __FUNCTION__);
+        exit(1);
+    }
+
+    SetBrushColor(hdc, RGB2Pixel(hdc, 0xFF, 0xFF, 0xFF));
+    FillBox(hdc, 0, 0, CANVAS_WIDTH, CANVAS_HEIGHT);
+
+    while ((line = LayoutNextLine(layout, line, CANVAS_WIDTH, FALSE,
+            on_glyph_laid_out, (GHANDLE)&hash))) {
+        SIZE size;
+
+        DrawLayoutLine(hdc, line, 0, y);
+        GetLayoutLineSize(line, &size);
+        y += size.cy;
+    }
+
+    DestroyLayout(layout);
+    DestroyTextRuns(runs);
+    free(bos);
+
+    bits = LockDC(hdc, NULL, &width, &height, &pitch);
+    if (bits == NULL) {
+        _ERR_PRINTF("%s: LockDC failed\n", __FUNCTION__);
+        exit(1);
+    }
+
+    for (i = 0; i < height; i++) {
+        hash = fnv1a(hash, bits + pitch * i, width * 4);
+    }
+    UnlockDC(hdc);
+
+    return hash;
+}
+
+static HDC create_canvas(void)
+{
+    HDC hdc;
+
+    hdc = CreateMemDC(CANVAS_WIDTH, CANVAS_HEIGHT, 32, MEMDC_FLAG_SWSURFACE,
+            0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+    if (hdc == HDC_INVALID) {
+        _ERR_PRINTF("%s: CreateMemDC failed\n", __FUNCTION__);
+        exit(1);
+    }
+
+    SetBkMode(hdc, BM_TRANSPARENT);
+    return hdc;
+}
+
+static void make_golden_output(void)
+{
+    HDC hdc = create_canvas();
+    int i;
+
+    for (i = 0; i < NR_PARAGRAPHS; i++) {
+        _paragraphs[i].golden = layout_paragraph(hdc, _paragraphs + i);
+    }
+
+    DeleteMemDC(hdc);
+}
+
+static void* layout_thread_entry(void* arg)
+{
+    struct thread_info* info = (struct thread_info*)arg;
+    HDC hdc = create_canvas();
+    int i, j;
+
+    pthread_barrier_wait(&_start_barrier);
+
+    for (i = 0; i < info->nr_loops; i++) {
+        for (j = 0; j < NR_PARAGRAPHS; j++) {
+            if (layout_paragraph(hdc, _paragraphs + j) !=
+                    _paragraphs[j].golden) {
+                info->nr_mismatched++;
+            }
+            info->nr_laid_out++;
+        }
+    }
+
+    DeleteMemDC(hdc);
+    return NULL;
+}
+
+/* returns the number of paragraphs laid out per second */
+static double run_threads(int nr_threads, int nr_loops)
+{
+    struct thread_info* infos;
+    double start_time, elapsed;
+    int i, nr_mismatched = 0, nr_laid_out = 0;
+
+    infos = calloc(nr_threads, sizeof(struct thread_info));
+    pthread_barrier_init(&_start_barrier, NULL, nr_threads + 1);
+
+    for (i = 0; i < nr_threads; i++) {
+        infos[i].nr_loops = nr_loops;
+        if (pthread_create(&infos[i].th, NULL, layout_thread_entry,
+                    infos + i)) {
+            _ERR_PRINTF("%s: failed to create thread #%d\n",
+                    __FUNCTION__, i);
+            exit(1);
+        }
+    }
+
+    pthread_barrier_wait(&_start_barrier);
+    start_time = get_curr_time();
+
+    for (i = 0; i < nr_threads; i++) {
+        pthread_join(infos[i].th, NULL);
+        nr_mismatched += infos[i].nr_mismatched;
+        nr_laid_out += infos[i].nr_laid_out;
+    }
+
+    elapsed = get_curr_time() - start_time;
+    pthread_barrier_destroy(&_start_barrier);
+    free(infos);
+
+    if (nr_mismatched > 0) {
+        _ERR_PRINTF("%s: %d of %d layouts mismatched with the golden output "
+                "when running in %d threads\n",
+                __FUNCTION__, nr_mismatched, nr_laid_out, nr_threads);
+        exit(1);
+    }
+
+    return nr_laid_out / elapsed;
+}
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    struct synth_mix mix;
+    const char* spec = NULL;
+    unsigned int seed = 1;
+    int max_threads = DEF_MAX_THREADS;
+    int nr_loops = DEF_NR_LOOPS;
+    int nr_args = 0;
+    double base = 0;
+    int nr_threads, i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-synth") == 0 && i + 1 < argc) {
+            spec = argv[++i];
+        }
+        else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+            seed = (unsigned int)strtoul(argv[++i], NULL, 0);
+        }
+        else if (nr_args == 0) {
+            max_threads = atoi(argv[i]);
+            nr_args++;
+        }
+        else {
+            nr_loops = atoi(argv[i]);
+        }
+    }
+
+    if (spec && !parse_synth_spec(spec, &mix)) {
+        _ERR_PRINTF("%s: bad synthetic text spec: %s\n", __FUNCTION__, spec);
+        exit(1);
+    }
+
+    if (max_threads <= 0)
+        max_threads = DEF_MAX_THREADS;
+    if (nr_loops <= 0)
+        nr_loops = DEF_NR_LOOPS;
+
+    create_paragraphs(spec ? &mix : NULL, seed);
+    make_golden_output();
+
+    _MG_PRINTF("========= START TO BENCH concurrent layouts (%d paragraphs)\n",
+            NR_PARAGRAPHS);
+    _MG_PRINTF("%8s %16s %10s %12s\n", "threads", "paragraphs/sec",
+            "speedup", "efficiency");
+
+    nr_threads = 1;
+    while (nr_threads <= max_threads) {
+        double rate = run_threads(nr_threads, nr_loops);
+
+        if (nr_threads == 1)
+            base = rate;
+
+        _MG_PRINTF("%8d %16.1f %10.2f %11.0f%%\n", nr_threads, rate,
+                rate / base, rate / base / nr_threads * 100);
+
+        /* double the threads, but always end with max_threads */
+        if (nr_threads < max_threads && nr_threads * 2 > max_threads)
+            nr_threads = max_threads;
+        else
+            nr_threads *= 2;
+    }
+
+    _MG_PRINTF("========= END OF BENCH concurrent layouts\n");
+
+    destroy_paragraphs();
+
+    exit(0);
+    return 0;
+}
+
+#elif (_MINIGUI_VERSION_CODE >= _VERSION_CODE(4,0,0)) \
+        && defined(_MGCHARSET_UNICODE)
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    _WRN_PRINTF ("This test program requires MiniGUI-Threads runtime mode.\n");
+    return 0;
+}
+
+#else
+#error "To test concurrent layouts, please use MiniGUI 4.0.0 and enable support for UNICODE"
+#endif /* checking version and features */
@@ -589,6 +589,7 @@ static void run_test_case(HDC hdc)
             _decoration_style_cases[_curr_decoration_style].style_ch,
             _rendering_style_cases[_curr_rendering_style].style_ch,
             _font_size, _font_rotation);
+    startup_trace_mark("create-logfont");
 
     dump_logfont_info(lf1);
 
@@ -607,6 +608,7 @@ static void run_test_case(HDC hdc)
     printf("%s: calling CreateLogFontByName(%s)\n",
         __FUNCTION__, lf_name);
     lf2 = CreateLogFontByName(lf_name);
+    startup_trace_mark("create-logfont");
     dump_logfont_info(lf2);
 
     if (lf2 && _font_rotation) {
@@ -622,8 +624,10 @@ static void run_test_case(HDC hdc)
     }
 
     if (lf3) DestroyLogFont(lf3);
+    startup_trace_mark("check-logfonts");
 
     show_test_case(hdc, lf_name, lf1, lf2);
+    startup_trace_mark("render");
 
     if (lf2) DestroyLogFont(lf2);
     if (lf1) DestroyLogFont(lf1);
@@ -652,8 +656,12 @@ static LRESULT MyMainWinProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lPar
     case MSG_PAINT: {
         HDC hdc;
         hdc = BeginPaint(hWnd);
+        startup_trace_mark("begin-paint");
         run_test_case(hdc);
         EndPaint(hWnd, hdc);
+        startup_trace_mark("end-paint");
+        if (startup_trace_end("createlogfontex"))
+            exit(0);
         return 0;
     }
 
@@ -965,6 +973,8 @@ int MiniGUIMain (int argc, const char* argv[])
     MAINWINCREATE CreateInfo;
     HWND hMainWnd;
 
+    startup_trace_begin();
+
     srandom(time(NULL));
     if (argc > 1)
         _auto_test_runs = atoi(argv[1]);
@@ -990,6 +1000,7 @@ int MiniGUIMain (int argc, const char* argv[])
         printf ("InitVectorialFonts: error.\n");
         exit (2);
     }
+    startup_trace_mark("join-layer");
 #endif
 
     for (i = 0; i < TABLESIZE(_devfontinfo); i++) {
@@ -1000,14 +1011,17 @@ int MiniGUIMain (int argc, const char* argv[])
                 __FUNCTION__, _devfontinfo[i].fontname, _devfontinfo[i].filename);
         }
     }
+    startup_trace_mark("load-devfonts");
 
     InitCreateInfo (&CreateInfo);
 
     hMainWnd = CreateMainWindow (&CreateInfo);
     if (hMainWnd == HWND_INVALID)
         exit (3);
+    startup_trace_mark("create-main-window");
 
     ShowWindow (hMainWnd, SW_SHOWNORMAL);
+    startup_trace_mark("show-window");
     while (GetMessage (&Msg, hMainWnd)) {
         TranslateMessage (&Msg);
         DispatchMessage (&Msg);
@@ -21,6 +21,9 @@
 **      GetGlyphsExtentFromUChars
 **      DrawGlyphStringEx
 **
+**  Usage: drawglyphstringex [nr_auto_test_runs]
+**         drawglyphstringex -bench [nr_loops]
+**
 ** Copyright (C) 2019 FMSoft (http://www.fmsoft.cn).
 **
 ** Licensed under the Apache License, Version 2.0 (the "License");
@@ -483,6 +486,17 @@ static void create_logfonts(void)
 
 static int _text_x, _text_y;
 
+static Uint32 get_render_flags(void)
+{
+    return _writing_mode_cases[_curr_writing_mode].rule |
+            _text_ort_cases[_curr_text_ort].rule |
+            _overflow_wrap_cases[_curr_overflow_wrap].rule |
+            _align_cases[_curr_align].rule |
+            _text_justify_cases[_curr_text_justify].rule |
+            _hanging_punc_cases[_curr_hanging_punc].rule |
+            _spaces_cases[_curr_spaces].rule;
+}
+
 static int render_glyphs(HDC hdc, PLOGFONT lf,
     const Uchar32* ucs, const Uint16* bos, int n)
 {
@@ -502,14 +516,7 @@ static int render_glyphs(HDC hdc, PLOGFONT lf,
         return -1;
     }
 
-    render_flags =
-            _writing_mode_cases[_curr_writing_mode].rule |
-            _text_ort_cases[_curr_text_ort].rule |
-            _overflow_wrap_cases[_curr_overflow_wrap].rule |
-            _align_cases[_curr_align].rule |
-            _text_justify_cases[_curr_text_justify].rule |
-            _hanging_punc_cases[_curr_hanging_punc].rule |
-            _spaces_cases[_curr_spaces].rule;
+    render_flags = get_render_flags();
 
     if (_limited) {
         if (_writing_mode_cases[_curr_writing_mode].rule
@@ -714,20 +721,27 @@ static void dump_glyphs_and_breaks(LOGFONT* lf, const char* text,
         const Uchar32* ucs, const Uint16* bos, int n)
 {
     int i;
-    char* tmp = _utf8_str;
 
     printf("START OF DUMPING GLYPHS AND BREAKS\n");
     printf("==================================\n");
 
     memset(_utf8_str, 0, 5000);
-    for (i = 0; i < n; i++) {
-        int len;
-        Uchar32 uc = ucs[i];
+    if (uc32s_to_utf8(ucs, n, _utf8_str, 4990, NULL) < 0) {
+        /* lone surrogates or out-of-range code points; go one by one */
+        char* tmp = _utf8_str;
+
+        memset(_utf8_str, 0, 5000);
+        for (i = 0; i < n && (tmp - _utf8_str) < 4990; i++) {
+            Uchar32 uc = ucs[i];
 
-        if ((tmp - _utf8_str) < 4990) {
-            len = uc32_to_utf8(uc, tmp);
-            tmp += len;
+            if ((uc >= 0xD800 && uc <= 0xDFFF) || uc > 0x10FFFF)
+                uc = 0xFFFD;
+            tmp += uc32_to_utf8(uc, tmp);
         }
+    }
+
+    for (i = 0; i < n; i++) {
+        Uchar32 uc = ucs[i];
 
         printf("%04X(%s, %s)\n", uc,
             get_general_category_name(UCharGetCategory(uc)),
@@ -889,6 +903,252 @@ error:
     if (bos) free (bos);
 }
 
+/*
+ * Headless benchmark (-bench): renders all text cases with every font in
+ * _font_cases into a memory DC, and splits the time between
+ * GetGlyphsExtentFromUChars and DrawGlyphStringEx. The glyph arrays are
+ * either allocated for each paragraph as render_glyphs() does, or
+ * allocated once and reused across paragraphs and lines.
+ */
+#define BENCH_DC_WIDTH      1024
+#define BENCH_DC_HEIGHT     768
+
+typedef struct _BENCH_PARAGRAPH {
+    Uchar32*    ucs;
+    Uint16*     bos;
+    int         n;
+} BENCH_PARAGRAPH;
+
+typedef struct _GLYPH_BUFFERS {
+    Glyph32*        gvs;
+    GLYPHEXTINFO*   gei;
+    GLYPHPOS*       gps;
+    int             size;
+} GLYPH_BUFFERS;
+
+typedef struct _BENCH_RESULT {
+    Uint64      extent_ns;
+    Uint64      draw_ns;
+    Uint64      alloc_ns;
+    Uint64      total_ns;
+    Uint64      nr_glyphs;
+} BENCH_RESULT;
+
+static void free_glyph_buffers(GLYPH_BUFFERS* bufs)
+{
+    free(bufs->gvs);
+    free(bufs->gei);
+    free(bufs->gps);
+    memset(bufs, 0, sizeof(GLYPH_BUFFERS));
+}
+
+static void reserve_glyph_buffers(GLYPH_BUFFERS* bufs, int n)
+{
+    if (bufs->size >= n)
+        return;
+
+    free_glyph_buffers(bufs);
+    bufs->gvs = (Glyph32*)malloc(sizeof(Glyph32) * n);
+    bufs->gei = (GLYPHEXTINFO*)malloc(sizeof(GLYPHEXTINFO) * n);
+    bufs->gps = (GLYPHPOS*)malloc(sizeof(GLYPHPOS) * n);
+    if (bufs->gvs == NULL || bufs->gei == NULL || bufs->gps == NULL) {
+        _ERR_PRINTF("%s: failed to allocate memory\n", __FUNCTION__);
+        exit(1);
+    }
+    bufs->size = n;
+}
+
+static int create_bench_paragraphs(BENCH_PARAGRAPH** parags)
+{
+    PLOGFONT lf;
+    int nr_parags = 0;
+    size_t i;
+
+    if (!(lf = CreateLogFontForMChar2UChar("utf-8"))) {
+        _ERR_PRINTF("%s: failed to create logfont for UTF-8\n", __FUNCTION__);
+        exit(1);
+    }
+
+    *parags = NULL;
+    for (i = 0; i < TABLESIZE(_text_cases); i++) {
+        const char* text = _text_cases[i];
+        int left_len_text = strlen(text);
+
+        while (left_len_text > 0) {
+            BENCH_PARAGRAPH parag;
+            int consumed;
+
+            parag.ucs = NULL;
+            consumed = GetUCharsUntilParagraphBoundary(lf, text,
+                    left_len_text, (Uint8)_wsr_cases[_curr_wsr].rule,
+                    &parag.ucs, &parag.n);
+            if (consumed <= 0) {
+                _ERR_PRINTF("%s: GetUCharsUntilParagraphBoundary failed\n",
+                    __FUNCTION__);
+                exit(1);
+            }
+
+            if (parag.n > 0) {
+                parag.bos = NULL;
+                if (UStrGetBreaks(LANGCODE_unknown,
+                        (Uint8)_ctr_cases[_curr_ctr].rule,
+                        (Uint8)_wbr_cases[_curr_wbr].rule,
+                        (Uint8)_lbp_cases[_curr_lbp].rule,
+                        parag.ucs, parag.n, &parag.bos) <= 0) {
+                    _ERR_PRINTF("%s: UStrGetBreaks failed.\n", __FUNCTION__);
+                    exit(1);
+                }
+
+                *parags = realloc(*parags,
+                        sizeof(BENCH_PARAGRAPH) * (nr_parags + 1));
+                (*parags)[nr_parags++] = parag;
+            }
+            else {
+                free(parag.ucs);
+            }
+
+            left_len_text -= consumed;
+            text += consumed;
+        }
+    }
+
+    DestroyLogFont(lf);
+    return nr_parags;
+}
+
+static void bench_glyphs_with_font(HDC hdc, PLOGFONT lf,
+        const BENCH_PARAGRAPH* parags, int nr_parags, int nr_loops,
+        BOOL reuse, BENCH_RESULT* result)
+{
+    GLYPH_BUFFERS bufs = { NULL, NULL, NULL, 0 };
+    PLOGFONT lf_sw = NULL;
+    Uint32 render_flags = get_render_flags();
+    int max_extent = BENCH_DC_WIDTH - 10;
+    Uint64 t0, t1, t2, start_ns;
+    int i, j;
+
+    memset(result, 0, sizeof(BENCH_RESULT));
+
+    start_ns = get_curr_ns();
+    for (i = 0; i < nr_loops; i++) {
+        int x = 5, y = 5;
+
+        for (j = 0; j < nr_parags; j++) {
+            const Uchar32* ucs = parags[j].ucs;
+            const Uint16* bos = parags[j].bos + 1;
+            int n = parags[j].n;
+
+            t0 = get_curr_ns();
+            if (!reuse)
+                free_glyph_buffers(&bufs);
+            reserve_glyph_buffers(&bufs, n);
+            result->alloc_ns += get_curr_ns() - t0;
+
+            while (n > 0) {
+                SIZE line_size;
+                int consumed;
+
+                t0 = get_curr_ns();
+                consumed = GetGlyphsExtentFromUChars(lf, ucs, n, bos,
+                        render_flags, x, y,
+                        _letter_spacing, _word_spacing, _tab_size, max_extent,
+                        &line_size, bufs.gvs, bufs.gei, bufs.gps, &lf_sw);
+                t1 = get_curr_ns();
+                if (consumed <= 0) {
+                    _ERR_PRINTF("%s: GetGlyphsExtentFromUChars did not eat any glyph\n",
+                        __FUNCTION__);
+                    exit(1);
+                }
+
+                DrawGlyphStringEx(hdc, lf, lf_sw, bufs.gvs, bufs.gps, consumed);
+                t2 = get_curr_ns();
+
+                result->extent_ns += t1 - t0;
+                result->draw_ns += t2 - t1;
+                result->nr_glyphs += consumed;
+
+                y += line_size.cy;
+                if (y > BENCH_DC_HEIGHT)
+                    y = 5;
+
+                ucs += consumed;
+                bos += consumed;
+                n -= consumed;
+            }
+        }
+    }
+
+    t0 = get_curr_ns();
+    free_glyph_buffers(&bufs);
+    result->alloc_ns += get_curr_ns() - t0;
+    result->total_ns = get_curr_ns() - start_ns;
+
+    if (lf_sw)
+        DestroyLogFont(lf_sw);
+}
+
+static void bench_glyphs(int nr_loops)
+{
+    BENCH_PARAGRAPH* parags;
+    int nr_parags;
+    HDC hdc;
+    size_t i;
+    int reuse;
+
+    hdc = CreateMemDC(BENCH_DC_WIDTH, BENCH_DC_HEIGHT, 32,
+            MEMDC_FLAG_SWSURFACE,
+            0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+    if (hdc == HDC_INVALID) {
+        _ERR_PRINTF("%s: CreateMemDC failed\n", __FUNCTION__);
+        exit(1);
+    }
+    SetBkMode(hdc, BM_TRANSPARENT);
+
+    nr_parags = create_bench_paragraphs(&parags);
+
+    _MG_PRINTF("========= START TO BENCH glyphs (%d paragraphs x %d)\n",
+            nr_parags, nr_loops);
+    _MG_PRINTF("%-40s %-7s %12s %10s %10s %10s\n", "font", "arrays",
+            "glyphs/sec", "extent", "draw", "alloc");
+
+    for (i = 0; i < TABLESIZE(_font_cases); i++) {
+        PLOGFONT lf = CreateLogFontByName(_font_cases[i]);
+
+        if (lf == NULL) {
+            _ERR_PRINTF ("%s: Failed to create logfont\n", __FUNCTION__);
+            exit (1);
+        }
+
+        for (reuse = 0; reuse < 2; reuse++) {
+            BENCH_RESULT r;
+            double nr_glyphs;
+
+            bench_glyphs_with_font(hdc, lf, parags, nr_parags, nr_loops,
+                    reuse, &r);
+            nr_glyphs = (double)r.nr_glyphs;
+
+            /* the last three columns are in ns per glyph */
+            _MG_PRINTF("%-40s %-7s %12.0f %10.1f %10.1f %10.1f\n",
+                    _font_cases[i], reuse ? "reused" : "malloc",
+                    nr_glyphs * 1.0E9 / r.total_ns,
+                    r.extent_ns / nr_glyphs, r.draw_ns / nr_glyphs,
+                    r.alloc_ns / nr_glyphs);
+        }
+
+        DestroyLogFont(lf);
+    }
+
+    _MG_PRINTF("========= END OF BENCH glyphs\n");
+
+    for (i = 0; i < (size_t)nr_parags; i++) {
+        free(parags[i].ucs);
+        free(parags[i].bos);
+    }
+    free(parags);
+
+    DeleteMemDC(hdc);
+}
+
 static int _auto_test_runs = 0;
 static int _nr_test_runs = 0;
 
@@ -1046,9 +1306,15 @@ int MiniGUIMain (int argc, const char* argv[])
     MSG Msg;
     MAINWINCREATE CreateInfo;
     HWND hMainWnd;
+    int bench_loops = 0;
 
     srandom(time(NULL));
-    if (argc > 1)
+    if (argc > 1 && strcmp(argv[1], "-bench") == 0) {
+        bench_loops = (argc > 2) ? atoi(argv[2]) : 10;
+        if (bench_loops <= 0)
+            bench_loops = 1;
+    }
+    else if (argc > 1)
         _auto_test_runs = atoi(argv[1]);
 
 #ifdef _MGRM_PROCESSES
@@ -1083,6 +1349,11 @@ int MiniGUIMain (int argc, const char* argv[])
         }
     }
 
+    if (bench_loops > 0) {
+        bench_glyphs(bench_loops);
+        exit(0);
+    }
+
     create_logfonts();
 
     InitCreateInfo (&CreateInfo);
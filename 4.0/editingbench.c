@@ -0,0 +1,574 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//                        IMPORTANT LEGAL NOTICE
+//
+// The following open source license statement does not apply to any
+// entity in the Exception List published by FMSoft.
+//
+// For more information, please visit:
+//
+// https://www.fmsoft.cn/exception-list
+//
+//////////////////////////////////////////////////////////////////////////////
+/*
+** editingbench.c:
+**
+**  Editing simulation for the text APIs of MiniGUI 4.0.0: a seeded trace
+**  of keystrokes (typing, pasting, backspaces, joining lines and deleting
+**  selections at random positions) is replayed against a large paragraph.
+**  After every keystroke, the break opportunities and the layout are
+**  computed in two ways:
+**
+**      - full: UStrGetBreaks, CreateTextRuns and CreateLayout for the
+**        whole paragraph, as ustrgetbreaks.c and createlayout.c do;
+**      - incremental: UStrGetBreaks only for a window around the edit,
+**        bounded by the nearest mandatory breaks or cut at grapheme
+**        boundaries, and the layout only for the hard line edited.
+**
+**  The flags got by the incremental way must be the same as the full ones.
+**  The latency per keystroke of both ways is reported.
+**
+**  The following APIs are covered:
+**
+**      UStrGetBreaks
+**      CreateTextRuns
+**      InitBasicShapingEngine
+**      CreateLayout
+**      LayoutNextLine
+**
+**  Usage: editingbench [-synth <spec>] [-seed <seed>] [nr_chars] [nr_edits]
+**
+** Copyright (C) 2019 FMSoft (http://www.fmsoft.cn).
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <minigui/common.h>
+#include <minigui/minigui.h>
+#include <minigui/gdi.h>
+#include <minigui/window.h>
+
+#if (_MINIGUI_VERSION_CODE >= _VERSION_CODE(4,0,0)) \
+        && defined(_MGCHARSET_UNICODE)
+
+#include "helpers.h"
+
+#define DEF_NR_CHARS        (1024 * 16)
+#define DEF_NR_EDITS        500
+#define MIN_CHARS           64
+
+/* average length of the hard lines (ended by LF) in the paragraph */
+#define HARD_LINE_LEN       400
+
+#define DELETE_PERCENT      35
+#define MAX_INS_CHARS       16      // a paste
+#define MAX_DEL_CHARS       24      // deleting a selection
+#define ENTER_PER_CHARS     60      // one LF typed in so many characters
+#define JOIN_PER_DELETES    8       // one line joined in so many deletes
+#define POOL_SIZE           4096
+
+/*
+ * The characters out of the window at both sides give the context for
+ * the flags near the edges of the window; the flags of NR_STABLE_FLAGS
+ * positions at the edges must be the same as the old ones, or the window
+ * is doubled.
+ */
+#define NR_GUARD_CHARS      32
+#define NR_STABLE_FLAGS     16
+#define MIN_MARGIN          (NR_STABLE_FLAGS * 2)
+
+#define LINE_WIDTH          320
+#define LAYOUT_FONT  "ttf-Courier,宋体,Naskh,SansSerif-rrncns-U-16-UTF-8"
+
+#define IS_MANDATORY(bo)    (((bo) & BOV_LB_MASK) == BOV_LB_MANDATORY)
+
+struct keystroke {
+    int         pos;
+    BOOL        join;       // deletes the LF nearest to pos
+    int         nr_del;
+    int         nr_ins;
+    Uchar32     ins[MAX_INS_CHARS];
+};
+
+struct paragraph {
+    Uchar32*    ucs;
+    int         nr_ucs;
+    BreakOppo*  bos;        // the flags of the current text
+    BreakOppo*  new_bos;    // the buffer for the spliced flags
+};
+
+struct window_stat {
+    Uint64      nr_chars;
+    int         nr_retries;
+};
+
+enum {
+    COST_FULL_BREAKS = 0,
+    COST_FULL_LAYOUT,
+    COST_INC_BREAKS,
+    COST_INC_LAYOUT,
+    NR_COSTS,
+};
+
+static BOOL count_glyph(GHANDLE ctxt, Glyph32 gv,
+        const GLYPHPOS* pos, const RENDERDATA* data)
+{
+    (*(int*)ctxt)++;
+    return TRUE;
+}
+
+static BreakOppo* get_breaks(const Uchar32* ucs, int n)
+{
+    BreakOppo* bos = NULL;
+
+    if (UStrGetBreaks(LANGCODE_unknown, CTR_NONE, WBR_NORMAL, LBP_NORMAL,
+            ucs, n, &bos) <= 0) {
+        _ERR_PRINTF("%s: UStrGetBreaks failed\n", __FUNCTION__);
+        exit(1);
+    }
+
+    return bos;
+}
+
+/* creates the text runs and lays out all lines; returns the glyphs got */
+static int layout_text(const Uchar32* ucs, int n, const BreakOppo* bos)
+{
+    TEXTRUNS* runs;
+    LAYOUT* layout;
+    LAYOUTLINE* line = NULL;
+    int nr_glyphs = 0;
+
+    runs = CreateTextRuns(ucs, n, LANGCODE_unknown, BIDI_PGDIR_WLTR,
+            LAYOUT_FONT, MakeRGB(0, 0, 0), 0, NULL);
+    if (runs == NULL) {
+        _ERR_PRINTF("%s: CreateTextRuns returns NULL\n", __FUNCTION__);
+        exit(1);
+    }
+
+    if (!InitBasicShapingEngine(runs)) {
+        _ERR_PRINTF("%s: InitBasicShapingEngine returns FALSE\n",
+                __FUNCTION__);
+        exit(1);
+    }
+
+    layout = CreateLayout(runs, GRF_LINE_EXTENT_VARIABLE, bos + 1, FALSE,
+            0, 0, 0, 0, 10, NULL, 0);
+    if (layout == NULL) {
+        _ERR_PRINTF("%s: CreateLayout returns NULL\n", __FUNCTION__);
+        exit(1);
+    }
+
+    while ((line = LayoutNextLine(layout, line, LINE_WIDTH, FALSE,
+            count_glyph, (GHANDLE)&nr_glyphs))) {
+    }
+
+    DestroyLayout(layout);
+    DestroyTextRuns(runs);
+    return nr_glyphs;
+}
+
+static void create_paragraph(struct paragraph* para, unsigned int seed,
+        const struct synth_mix* mix, int nr_ucs, int max_ucs)
+{
+    BreakOppo* bos;
+    int pos;
+
+    para->ucs = malloc(sizeof(Uchar32) * max_ucs);
+    para->nr_ucs = generate_synth_text(seed, mix, para->ucs, nr_ucs);
+
+    /* break the paragraph into hard lines */
+    for (pos = random() % HARD_LINE_LEN; pos < para->nr_ucs;
+            pos += HARD_LINE_LEN / 2 + random() % HARD_LINE_LEN) {
+        para->ucs[pos] = '\n';
+    }
+
+    para->bos = malloc(sizeof(BreakOppo) * (max_ucs + 1));
+    para->new_bos = malloc(sizeof(BreakOppo) * (max_ucs + 1));
+
+    bos = get_breaks(para->ucs, para->nr_ucs);
+    memcpy(para->bos, bos, sizeof(BreakOppo) * (para->nr_ucs + 1));
+    free(bos);
+}
+
+static void destroy_paragraph(struct paragraph* para)
+{
+    free(para->new_bos);
+    free(para->bos);
+    free(para->ucs);
+}
+
+/*
+ * Generates the keystrokes in advance, so the trace is the same for
+ * a seed; returns the maximal length of the paragraph while replaying.
+ */
+static int create_trace(unsigned int seed, const struct synth_mix* mix,
+        int nr_ucs, struct keystroke* trace, int nr_edits)
+{
+    Uchar32 pool[POOL_SIZE];
+    int max_ucs = nr_ucs;
+    BOOL joined = FALSE;
+    int i, j;
+
+    generate_synth_text(seed + 1, mix, pool, POOL_SIZE);
+
+    for (i = 0; i < nr_edits; i++) {
+        struct keystroke* ks = trace + i;
+
+        if (nr_ucs > MIN_CHARS + MAX_DEL_CHARS &&
+                random() % 100 < DELETE_PERCENT) {
+            ks->nr_del = (random() % 8) ? 1 : 1 + random() % MAX_DEL_CHARS;
+            ks->nr_ins = 0;
+
+            /* the first single delete joins two lines in every trace */
+            ks->join = (ks->nr_del == 1 &&
+                    (!joined || random() % JOIN_PER_DELETES == 0));
+            if (ks->join)
+                joined = TRUE;
+        }
+        else {
+            ks->join = FALSE;
+            ks->nr_del = 0;
+            ks->nr_ins = (random() % 8) ? 1 : 1 + random() % MAX_INS_CHARS;
+            for (j = 0; j < ks->nr_ins; j++) {
+                if (random() % ENTER_PER_CHARS == 0)
+                    ks->ins[j] = '\n';
+                else
+                    ks->ins[j] = pool[random() % POOL_SIZE];
+            }
+        }
+
+        ks->pos = random() % (nr_ucs - ks->nr_del + 1);
+        nr_ucs += ks->nr_ins - ks->nr_del;
+        if (nr_ucs > max_ucs)
+            max_ucs = nr_ucs;
+    }
+
+    return max_ucs;
+}
+
+/* moves a joining keystroke onto the nearest LF, as a backspace does
+   at the start of a line */
+static void locate_join(const struct paragraph* para, struct keystroke* ks)
+{
+    int p;
+
+    for (p = ks->pos; p < para->nr_ucs; p++) {
+        if (para->ucs[p] == '\n') {
+            ks->pos = p;
+            return;
+        }
+    }
+
+    for (p = ks->pos - 1; p >= 0; p--) {
+        if (para->ucs[p] == '\n') {
+            ks->pos = p;
+            return;
+        }
+    }
+}
+
+static void apply_keystroke(struct paragraph* para, const struct keystroke* ks)
+{
+    memmove(para->ucs + ks->pos + ks->nr_ins,
+            para->ucs + ks->pos + ks->nr_del,
+            sizeof(Uchar32) * (para->nr_ucs - ks->pos - ks->nr_del));
+    memcpy(para->ucs + ks->pos, ks->ins, sizeof(Uchar32) * ks->nr_ins);
+    para->nr_ucs += ks->nr_ins - ks->nr_del;
+}
+
+/*
+ * Re-computes the flags after the keystroke into para->new_bos, passing
+ * only a window of the text to UStrGetBreaks. The core of the window
+ * spans the edit and `margin` characters at both sides, but does not go
+ * over the nearest mandatory breaks, whose flags do not depend on the text
+ * before them. The guard characters around the core are cut at grapheme
+ * boundaries. Only the flags of the core are taken from the window.
+ */
+static void rebreak_window(struct paragraph* para, const struct keystroke* ks,
+        struct window_stat* stat)
+{
+    const BreakOppo* old = para->bos;
+    int n = para->nr_ucs;
+    int pos = ks->pos;
+    int end = ks->pos + ks->nr_ins;         // the end of the edit in new text
+    int delta = ks->nr_ins - ks->nr_del;    // new position - old position
+    int margin = MIN_MARGIN;
+    int line_start, line_end;
+
+    line_start = pos;
+    while (line_start > 0 && !IS_MANDATORY(old[line_start]))
+        line_start--;
+
+    /*
+     * The old flag at the end of the edit belongs to the last character
+     * deleted (maybe an LF joined) or to the one before the insertion,
+     * so it does not tell the end of the new line.
+     */
+    line_end = MIN(end + 1, n);
+    while (line_end < n && !IS_MANDATORY(old[line_end - delta]))
+        line_end++;
+
+    for (;;) {
+        int core_start = MAX(line_start, pos - margin);
+        int core_end = MIN(line_end, end + margin);
+        int ws = core_start - NR_GUARD_CHARS;
+        int we = core_end + NR_GUARD_CHARS;
+        BreakOppo* wbos;
+        BOOL stable = TRUE;
+        int p;
+
+        if (ws <= 0)
+            ws = 0;
+        else while (ws > 0 && !(old[ws] & BOV_GB_CHAR_BREAK))
+            ws--;
+
+        if (we >= n)
+            we = n;
+        else while (we < n && !(old[we - delta] & BOV_GB_CHAR_BREAK))
+            we++;
+
+        wbos = get_breaks(para->ucs + ws, we - ws);
+
+        /* the edges of the core need checking unless they are exact */
+        if (ws > 0 && core_start > line_start) {
+            for (p = core_start; p < core_start + NR_STABLE_FLAGS; p++) {
+                if (wbos[p - ws] != old[p]) {
+                    stable = FALSE;
+                    break;
+                }
+            }
+        }
+
+        if (stable && we < n && core_end < line_end) {
+            for (p = core_end - NR_STABLE_FLAGS + 1; p <= core_end; p++) {
+                if (wbos[p - ws] != old[p - delta]) {
+                    stable = FALSE;
+                    break;
+                }
+            }
+        }
+
+        stat->nr_chars += we - ws;
+        if (!stable) {
+            free(wbos);
+            margin *= 2;
+            stat->nr_retries++;
+            continue;
+        }
+
+        memcpy(para->new_bos, old, sizeof(BreakOppo) * core_start);
+        memcpy(para->new_bos + core_start, wbos + core_start - ws,
+                sizeof(BreakOppo) * (core_end - core_start + 1));
+        memcpy(para->new_bos + core_end + 1, old + core_end + 1 - delta,
+                sizeof(BreakOppo) * (n - core_end));
+        free(wbos);
+        break;
+    }
+}
+
+/* lays out the hard line(s) containing the edit with the new flags */
+static void relayout_lines(struct paragraph* para, const struct keystroke* ks)
+{
+    const BreakOppo* bos = para->new_bos;
+    int n = para->nr_ucs;
+    int end = ks->pos + ks->nr_ins;
+    int line_start, line_end;
+
+    line_start = ks->pos;
+    while (line_start > 0 && !IS_MANDATORY(bos[line_start]))
+        line_start--;
+
+    line_end = (end > line_start) ? end : line_start + 1;
+    while (line_end < n && !IS_MANDATORY(bos[line_end]))
+        line_end++;
+    if (line_end > n)
+        line_end = n;
+
+    if (line_end > line_start)
+        layout_text(para->ucs + line_start, line_end - line_start,
+                bos + line_start);
+}
+
+static void check_flags(const struct paragraph* para, const BreakOppo* bos,
+        int edit)
+{
+    int i;
+
+    for (i = 0; i <= para->nr_ucs; i++) {
+        if (para->new_bos[i] != bos[i]) {
+            _ERR_PRINTF("%s: edit %d: flags differ at %d: 0x%04x (window) vs 0x%04x (full)\n",
+                    __FUNCTION__, edit, i, para->new_bos[i], bos[i]);
+            exit(1);
+        }
+    }
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+    double d = *(const double*)a - *(const double*)b;
+
+    if (d < 0)
+        return -1;
+    return (d > 0) ? 1 : 0;
+}
+
+/* costs are in ns; prints them per keystroke in us */
+static void report_latency(const char* name, double* costs, int nr)
+{
+    double sum = 0;
+    int i;
+
+    for (i = 0; i < nr; i++)
+        sum += costs[i];
+
+    qsort(costs, nr, sizeof(double), cmp_double);
+    _MG_PRINTF("%-12s avg %9.1f  p50 %9.1f  p99 %9.1f  max %9.1f (us)\n",
+            name, sum / nr / 1000, costs[nr / 2] / 1000,
+            costs[nr * 99 / 100] / 1000, costs[nr - 1] / 1000);
+}
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    static const char* cost_names[NR_COSTS] = {
+        "full breaks", "full layout", "win breaks", "line layout",
+    };
+    struct paragraph para;
+    struct keystroke* trace;
+    struct window_stat stat = { 0, 0 };
+    struct synth_mix mix;
+    double* costs[NR_COSTS];
+    double* full_costs;
+    double* inc_costs;
+    double sums[NR_COSTS] = { 0 };
+    const char* spec = "mixed";
+    unsigned int seed = 1;
+    int nr_chars = DEF_NR_CHARS;
+    int nr_edits = DEF_NR_EDITS;
+    int nr_args = 0;
+    int max_ucs, i, j;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-synth") == 0 && i + 1 < argc) {
+            spec = argv[++i];
+        }
+        else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+            seed = (unsigned int)strtoul(argv[++i], NULL, 0);
+        }
+        else if (nr_args == 0) {
+            nr_chars = atoi(argv[i]);
+            nr_args++;
+        }
+        else {
+            nr_edits = atoi(argv[i]);
+        }
+    }
+
+    if (!parse_synth_spec(spec, &mix)) {
+        _ERR_PRINTF("%s: bad synthetic text spec: %s\n", __FUNCTION__, spec);
+        exit(1);
+    }
+
+    if (nr_chars < MIN_CHARS)
+        nr_chars = MIN_CHARS;
+    if (nr_edits <= 0)
+        nr_edits = DEF_NR_EDITS;
+
+    srandom(seed);
+
+    trace = malloc(sizeof(struct keystroke) * nr_edits);
+    max_ucs = create_trace(seed, &mix, nr_chars, trace, nr_edits);
+    create_paragraph(&para, seed, &mix, nr_chars, max_ucs);
+
+    for (i = 0; i < NR_COSTS; i++)
+        costs[i] = malloc(sizeof(double) * nr_edits);
+    full_costs = malloc(sizeof(double) * nr_edits);
+    inc_costs = malloc(sizeof(double) * nr_edits);
+
+    _MG_PRINTF("========= START TO BENCH editing a paragraph of %d chars (%d edits, %s, seed %u)\n",
+            nr_chars, nr_edits, spec, seed);
+
+    for (i = 0; i < nr_edits; i++) {
+        struct keystroke* ks = trace + i;
+        BreakOppo* full_bos;
+        BreakOppo* tmp;
+        Uint64 t0, t1, t2;
+
+        if (ks->join)
+            locate_join(&para, ks);
+        apply_keystroke(&para, ks);
+
+        t0 = get_curr_ns();
+        full_bos = get_breaks(para.ucs, para.nr_ucs);
+        t1 = get_curr_ns();
+        if (layout_text(para.ucs, para.nr_ucs, full_bos) == 0) {
+            _ERR_PRINTF("%s: no glyph laid out\n", __FUNCTION__);
+            exit(1);
+        }
+        t2 = get_curr_ns();
+        costs[COST_FULL_BREAKS][i] = (double)(t1 - t0);
+        costs[COST_FULL_LAYOUT][i] = (double)(t2 - t1);
+
+        t0 = get_curr_ns();
+        rebreak_window(&para, ks, &stat);
+        t1 = get_curr_ns();
+        relayout_lines(&para, ks);
+        t2 = get_curr_ns();
+        costs[COST_INC_BREAKS][i] = (double)(t1 - t0);
+        costs[COST_INC_LAYOUT][i] = (double)(t2 - t1);
+
+        check_flags(&para, full_bos, i);
+        free(full_bos);
+
+        tmp = para.bos;
+        para.bos = para.new_bos;
+        para.new_bos = tmp;
+
+        full_costs[i] = costs[COST_FULL_BREAKS][i] + costs[COST_FULL_LAYOUT][i];
+        inc_costs[i] = costs[COST_INC_BREAKS][i] + costs[COST_INC_LAYOUT][i];
+        for (j = 0; j < NR_COSTS; j++)
+            sums[j] += costs[j][i];
+    }
+
+    for (j = 0; j < NR_COSTS; j++) {
+        _MG_PRINTF("%-12s avg %9.1f us\n", cost_names[j],
+                sums[j] / nr_edits / 1000);
+    }
+
+    report_latency("full", full_costs, nr_edits);
+    report_latency("incremental", inc_costs, nr_edits);
+    _MG_PRINTF("window: %.1f chars per edit, %d retries; breaks %.1fx, total %.1fx faster\n",
+            (double)stat.nr_chars / nr_edits, stat.nr_retries,
+            sums[COST_FULL_BREAKS] / sums[COST_INC_BREAKS],
+            (sums[COST_FULL_BREAKS] + sums[COST_FULL_LAYOUT]) /
+            (sums[COST_INC_BREAKS] + sums[COST_INC_LAYOUT]));
+
+    _MG_PRINTF("========= END OF BENCH editing a paragraph\n");
+
+    for (i = 0; i < NR_COSTS; i++)
+        free(costs[i]);
+    free(full_costs);
+    free(inc_costs);
+    free(trace);
+    destroy_paragraph(&para);
+
+    exit(0);
+    return 0;
+}
+
+#else
+#error "To bench editing a paragraph, please use MiniGUI 4.0.0 and enable support for UNICODE"
+#endif /* checking version and features */
@@ -0,0 +1,388 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//                        IMPORTANT LEGAL NOTICE
+//
+// The following open source license statement does not apply to any
+// entity in the Exception List published by FMSoft.
+//
+// For more information, please visit:
+//
+// https://www.fmsoft.cn/exception-list
+//
+//////////////////////////////////////////////////////////////////////////////
+/*
+** ellipsizebench.c:
+**
+**  Benchmark for ellipsizing a large set of single-line labels, as a list
+**  view does when it scrolls. Every label is laid out in the start, middle
+**  and end ellipsize modes for several widths, and the throughput is
+**  compared with laying out the full line and truncating it by hand.
+**
+**  The following APIs are covered:
+**
+**      CreateTextRuns
+**      InitBasicShapingEngine
+**      UStrGetBreaks
+**      CreateLayout (GRF_OVERFLOW_ELLIPSIZE_*)
+**      LayoutNextLine
+**      DestroyLayout
+**      DestroyTextRuns
+**
+**  Usage: ellipsizebench [-synth <spec>] [-seed <seed>] [nr_labels] [nr_loops]
+**
+**  With -synth, the labels are synthetic text (see parse_synth_spec()
+**  in helpers.c) instead of random picks from a small word list.
+**
+** Copyright (C) 2019 FMSoft (http://www.fmsoft.cn).
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <minigui/common.h>
+#include <minigui/minigui.h>
+#include <minigui/gdi.h>
+#include <minigui/window.h>
+
+#if (_MINIGUI_VERSION_CODE >= _VERSION_CODE(4,0,0)) \
+        && defined(_MGCHARSET_UNICODE)
+
+#include "helpers.h"
+
+#define DEF_NR_LABELS       2000
+#define DEF_NR_LOOPS        5
+
+#define MIN_LABEL_WORDS     3
+#define MAX_LABEL_WORDS     24
+#define MAX_LABEL_LEN       1024
+
+#define MIN_SYNTH_LABEL_LEN 10
+#define MAX_SYNTH_LABEL_LEN 120
+
+#define LABEL_FONT  "ttf-Courier,宋体,Naskh,SansSerif-rrncns-U-16-UTF-8"
+
+static const char* _words[] = {
+    "Settings", "Download", "complete", "network", "folder", "Documents",
+    "screenshot", "2019-06-18", "photo_0042.jpg", "report", "(draft)",
+    "设置", "下载完成", "网络连接", "我的文档", "屏幕截图", "照片",
+    "Привет", "мир", "Ελληνικά", "한국어", "日本語",
+    "مرحبا", "بالعالم", "שלום", "עולם",
+};
+
+static struct _ellipsize_mode {
+    const char* name;
+    Uint32      flag;
+} _modes[] = {
+    { "START", GRF_OVERFLOW_ELLIPSIZE_START },
+    { "MIDDLE", GRF_OVERFLOW_ELLIPSIZE_MIDDLE },
+    { "END", GRF_OVERFLOW_ELLIPSIZE_END },
+};
+
+static int _widths[] = { 40, 80, 160, 320 };
+
+struct label {
+    Uchar32*    ucs;
+    int         nr_ucs;
+    BreakOppo*  bos;
+    TEXTRUNS*   runs;
+};
+
+struct line_info {
+    int         max_extent;
+    int         width;
+    int         nr_glyphs;
+    int         nr_fit;     // number of glyphs fit in max_extent
+    int         fit_width;  // the extent of the glyphs fit
+    BOOL        ellipsis;
+};
+
+static BOOL on_glyph_laid_out(GHANDLE ctxt, Glyph32 gv,
+        const GLYPHPOS* pos, const RENDERDATA* data)
+{
+    struct line_info* info = (struct line_info*)ctxt;
+
+    if (pos->ellipsis)
+        info->ellipsis = TRUE;
+
+    info->width += pos->advance;
+    if (info->width <= info->max_extent) {
+        info->nr_fit++;
+        info->fit_width = info->width;
+    }
+    info->nr_glyphs++;
+    return TRUE;
+}
+
+/* gets the breaks and the shaped text runs of the label text */
+static void init_label_runs(struct label* label)
+{
+    label->bos = NULL;
+    if (UStrGetBreaks(LANGCODE_unknown, CTR_NONE, WBR_NORMAL, LBP_NORMAL,
+            label->ucs, label->nr_ucs, &label->bos) <= 0) {
+        _ERR_PRINTF("%s: UStrGetBreaks failed\n", __FUNCTION__);
+        exit(1);
+    }
+
+    label->runs = CreateTextRuns(label->ucs, label->nr_ucs, LANGCODE_unknown,
+            BIDI_PGDIR_WLTR, LABEL_FONT, MakeRGB(0, 0, 0), 0, NULL);
+    if (label->runs == NULL) {
+        _ERR_PRINTF("%s: CreateTextRuns returns NULL\n", __FUNCTION__);
+        exit(1);
+    }
+
+    if (!InitBasicShapingEngine(label->runs)) {
+        _ERR_PRINTF("%s: InitBasicShapingEngine returns FALSE\n",
+                __FUNCTION__);
+        exit(1);
+    }
+}
+
+/* makes a label from the words, or from synthetic text if mix is given */
+static void create_label(struct label* label, const struct synth_mix* mix,
+        unsigned int seed)
+{
+    char utf8[MAX_LABEL_LEN];
+    int len = 0, nr_words, i;
+
+    if (mix) {
+        label->nr_ucs = MIN_SYNTH_LABEL_LEN +
+            random() % (MAX_SYNTH_LABEL_LEN - MIN_SYNTH_LABEL_LEN + 1);
+        label->ucs = malloc(sizeof(Uchar32) * label->nr_ucs);
+        generate_synth_text(seed, mix, label->ucs, label->nr_ucs);
+        init_label_runs(label);
+        return;
+    }
+
+    nr_words = MIN_LABEL_WORDS +
+        random() % (MAX_LABEL_WORDS - MIN_LABEL_WORDS + 1);
+    for (i = 0; i < nr_words; i++) {
+        const char* word = _words[random() % TABLE_SIZE(_words)];
+        int word_len = strlen(word);
+
+        if (len + word_len + 1 >= MAX_LABEL_LEN)
+            break;
+
+        memcpy(utf8 + len, word, word_len);
+        len += word_len;
+        utf8[len++] = ' ';
+    }
+
+    label->ucs = malloc(sizeof(Uchar32) * len);
+    label->nr_ucs = utf8_to_uc32s(utf8, len, label->ucs, len, NULL);
+    if (label->nr_ucs <= 0) {
+        _ERR_PRINTF("%s: bad label text\n", __FUNCTION__);
+        exit(1);
+    }
+
+    init_label_runs(label);
+}
+
+static void destroy_label(struct label* label)
+{
+    DestroyTextRuns(label->runs);
+    free(label->bos);
+    free(label->ucs);
+}
+
+/*
+ * Lay out one label in a single line; returns the number of lines got.
+ * A negative max_extent means to lay out the whole line; fit_extent is
+ * the width used to count the glyphs to keep.
+ */
+static int layout_label(const struct label* label, Uint32 flags,
+        int max_extent, int fit_extent, struct line_info* info)
+{
+    LAYOUT* layout;
+    LAYOUTLINE* line = NULL;
+    int nr_lines = 0;
+
+    memset(info, 0, sizeof(*info));
+    info->max_extent = fit_extent;
+
+    layout = CreateLayout(label->runs, GRF_LINE_EXTENT_VARIABLE | flags,
+            label->bos + 1, FALSE, 0, 0, 0, 0, 10, NULL, 0);
+    if (layout == NULL) {
+        _ERR_PRINTF("%s: CreateLayout returns NULL\n", __FUNCTION__);
+        exit(1);
+    }
+
+    while ((line = LayoutNextLine(layout, line, max_extent, TRUE,
+            on_glyph_laid_out, (GHANDLE)info))) {
+        nr_lines++;
+    }
+
+    DestroyLayout(layout);
+    return nr_lines;
+}
+
+static double bench_ellipsize(struct label* labels, int nr_labels,
+        int nr_loops, Uint32 flag, int max_extent)
+{
+    struct line_info info;
+    double start_time;
+    int i, j;
+
+    start_time = get_curr_time();
+    for (i = 0; i < nr_loops; i++) {
+        for (j = 0; j < nr_labels; j++) {
+            if (layout_label(labels + j, flag, max_extent, max_extent,
+                        &info) > 1) {
+                _ERR_PRINTF("%s: not an ellipsized single line.\n",
+                        __FUNCTION__);
+                exit(1);
+            }
+
+            if (!info.ellipsis && info.width > max_extent) {
+                _ERR_PRINTF("%s: did not find any ellipsis but line_width (%d) > max_extent (%d).\n",
+                        __FUNCTION__, info.width, max_extent);
+                exit(1);
+            }
+        }
+    }
+
+    return get_curr_time() - start_time;
+}
+
+/* the width of the ellipsis (U+2026) appended to a truncated label */
+static int get_ellipsis_width(void)
+{
+    struct label label;
+    struct line_info info;
+
+    label.nr_ucs = 1;
+    label.ucs = malloc(sizeof(Uchar32));
+    label.ucs[0] = 0x2026;
+    init_label_runs(&label);
+
+    layout_label(&label, GRF_OVERFLOW_ELLIPSIZE_NONE, -1, -1, &info);
+    destroy_label(&label);
+    return info.width;
+}
+
+/*
+ * The way without the ellipsize support: lay out the full line,
+ * then keep the glyphs which fit in the width with an ellipsis
+ * (counted in the callback).
+ */
+static double bench_truncate(struct label* labels, int nr_labels,
+        int nr_loops, int max_extent, int ellipsis_width)
+{
+    struct line_info info;
+    double start_time;
+    int fit_extent = max_extent - ellipsis_width;
+    int i, j;
+
+    if (fit_extent < 0)
+        fit_extent = 0;
+
+    start_time = get_curr_time();
+    for (i = 0; i < nr_loops; i++) {
+        for (j = 0; j < nr_labels; j++) {
+            layout_label(labels + j, GRF_OVERFLOW_ELLIPSIZE_NONE, -1,
+                    fit_extent, &info);
+            if (info.width > max_extent && ellipsis_width <= max_extent &&
+                    info.fit_width + ellipsis_width > max_extent) {
+                _ERR_PRINTF("%s: the glyphs kept (%d) and the ellipsis (%d) "
+                        "exceed max_extent (%d).\n", __FUNCTION__,
+                        info.fit_width, ellipsis_width, max_extent);
+                exit(1);
+            }
+        }
+    }
+
+    return get_curr_time() - start_time;
+}
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    struct label* labels;
+    struct synth_mix mix;
+    const char* spec = NULL;
+    unsigned int seed = 1;
+    int ellipsis_width;
+    int nr_labels = DEF_NR_LABELS;
+    int nr_loops = DEF_NR_LOOPS;
+    int nr_args = 0;
+    size_t i, j;
+
+    for (i = 1; i < (size_t)argc; i++) {
+        if (strcmp(argv[i], "-synth") == 0 && i + 1 < (size_t)argc) {
+            spec = argv[++i];
+        }
+        else if (strcmp(argv[i], "-seed") == 0 && i + 1 < (size_t)argc) {
+            seed = (unsigned int)strtoul(argv[++i], NULL, 0);
+        }
+        else if (nr_args == 0) {
+            nr_labels = atoi(argv[i]);
+            nr_args++;
+        }
+        else {
+            nr_loops = atoi(argv[i]);
+        }
+    }
+
+    if (spec && !parse_synth_spec(spec, &mix)) {
+        _ERR_PRINTF("%s: bad synthetic text spec: %s\n", __FUNCTION__, spec);
+        exit(1);
+    }
+
+    if (nr_labels <= 0)
+        nr_labels = DEF_NR_LABELS;
+    if (nr_loops <= 0)
+        nr_loops = DEF_NR_LOOPS;
+
+    srandom(seed);
+
+    labels = calloc(nr_labels, sizeof(struct label));
+    for (i = 0; i < (size_t)nr_labels; i++) {
+        create_label(labels + i, spec ? &mix : NULL, seed + i);
+    }
+    ellipsis_width = get_ellipsis_width();
+
+    _MG_PRINTF("========= START TO BENCH ellipsizing %d labels (x %d)\n",
+            nr_labels, nr_loops);
+
+    for (i = 0; i < TABLE_SIZE(_widths); i++) {
+        double elapsed;
+        double total = (double)nr_labels * nr_loops;
+
+        elapsed = bench_truncate(labels, nr_labels, nr_loops, _widths[i],
+                ellipsis_width);
+        _MG_PRINTF("width %4d: %-10s %12.0f labels/sec\n", _widths[i],
+                "TRUNCATE", total / elapsed);
+
+        for (j = 0; j < TABLE_SIZE(_modes); j++) {
+            elapsed = bench_ellipsize(labels, nr_labels, nr_loops,
+                    _modes[j].flag, _widths[i]);
+            _MG_PRINTF("width %4d: %-10s %12.0f labels/sec\n", _widths[i],
+                    _modes[j].name, total / elapsed);
+        }
+    }
+
+    _MG_PRINTF("========= END OF BENCH ellipsizing labels\n");
+
+    for (i = 0; i < (size_t)nr_labels; i++) {
+        destroy_label(labels + i);
+    }
+    free(labels);
+
+    exit(0);
+    return 0;
+}
+
+#else
+#error "To bench ellipsizing labels, please use MiniGUI 4.0.0 and enable support for UNICODE"
+#endif /* checking version and features */
@@ -33,12 +33,22 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <strings.h>
+#include <assert.h>
+#include <unistd.h>
 #include <sys/time.h>
+#include <time.h>
 
 #include <minigui/common.h>
 #include <minigui/minigui.h>
 #include <minigui/gdi.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "helpers.h"
 
 int uc32_to_utf8(Uchar32 c, char* outbuf)
@@ -83,6 +93,602 @@ int uc32_to_utf8(Uchar32 c, char* outbuf)
     return len;
 }
 
+/* decode one UTF-8 sequence; returns the length or 0 if it is invalid */
+static inline int decode_one_utf8(const Uint8* s, int left, Uchar32* uc)
+{
+    Uchar32 c = s[0];
+
+    if (c < 0x80) {
+        *uc = c;
+        return 1;
+    }
+    else if (c < 0xC2) {
+        /* a stray continuation byte or an overlong two-byte form */
+        return 0;
+    }
+    else if (c < 0xE0) {
+        if (left < 2 || (s[1] & 0xC0) != 0x80)
+            return 0;
+
+        *uc = ((c & 0x1F) << 6) | (s[1] & 0x3F);
+        return 2;
+    }
+    else if (c < 0xF0) {
+        if (left < 3 || (s[1] & 0xC0) != 0x80 || (s[2] & 0xC0) != 0x80)
+            return 0;
+
+        c = ((c & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+        if (c < 0x800 || (c >= 0xD800 && c <= 0xDFFF))
+            return 0;
+
+        *uc = c;
+        return 3;
+    }
+    else if (c < 0xF5) {
+        if (left < 4 || (s[1] & 0xC0) != 0x80 || (s[2] & 0xC0) != 0x80 ||
+                (s[3] & 0xC0) != 0x80)
+            return 0;
+
+        c = ((c & 0x07) << 18) | ((s[1] & 0x3F) << 12) |
+            ((s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+        if (c < 0x10000 || c > 0x10FFFF)
+            return 0;
+
+        *uc = c;
+        return 4;
+    }
+
+    return 0;
+}
+
+/* encode one character; returns the length, 0 if no room, or -1 if invalid */
+static inline int encode_one_utf8(Uchar32 c, Uint8* d, int left)
+{
+    if (c < 0x80) {
+        if (left < 1)
+            return 0;
+        d[0] = (Uint8)c;
+        return 1;
+    }
+    else if (c < 0x800) {
+        if (left < 2)
+            return 0;
+        d[0] = 0xC0 | (c >> 6);
+        d[1] = 0x80 | (c & 0x3F);
+        return 2;
+    }
+    else if (c < 0x10000) {
+        if (c >= 0xD800 && c <= 0xDFFF)
+            return -1;
+        if (left < 3)
+            return 0;
+        d[0] = 0xE0 | (c >> 12);
+        d[1] = 0x80 | ((c >> 6) & 0x3F);
+        d[2] = 0x80 | (c & 0x3F);
+        return 3;
+    }
+    else if (c <= 0x10FFFF) {
+        if (left < 4)
+            return 0;
+        d[0] = 0xF0 | (c >> 18);
+        d[1] = 0x80 | ((c >> 12) & 0x3F);
+        d[2] = 0x80 | ((c >> 6) & 0x3F);
+        d[3] = 0x80 | (c & 0x3F);
+        return 4;
+    }
+
+    return -1;
+}
+
+int utf8_to_uc32s_scalar(const char* utf8, int len, Uchar32* ucs, int max_ucs,
+        int* consumed)
+{
+    const Uint8* s = (const Uint8*)utf8;
+    int pos = 0, n = 0;
+
+    while (pos < len && n < max_ucs) {
+        int l = decode_one_utf8(s + pos, len - pos, ucs + n);
+        if (l == 0)
+            goto invalid;
+
+        pos += l;
+        n++;
+    }
+
+    if (consumed) *consumed = pos;
+    return n;
+
+invalid:
+    if (consumed) *consumed = pos;
+    return -1;
+}
+
+int uc32s_to_utf8_scalar(const Uchar32* ucs, int nr_ucs, char* utf8,
+        int max_len, int* consumed)
+{
+    Uint8* d = (Uint8*)utf8;
+    int pos = 0, i = 0;
+
+    while (i < nr_ucs) {
+        int l = encode_one_utf8(ucs[i], d + pos, max_len - pos);
+        if (l < 0)
+            goto invalid;
+        else if (l == 0)
+            break;
+
+        pos += l;
+        i++;
+    }
+
+    if (consumed) *consumed = i;
+    return pos;
+
+invalid:
+    if (consumed) *consumed = i;
+    return -1;
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+#if defined(__AVX2__)
+#   define SIMD_BLOCK      32
+#else
+#   define SIMD_BLOCK      16
+#endif
+
+/*
+ * Whole blocks of ASCII bytes are widened to UCS-4 with SIMD. A block with
+ * any non-ASCII byte is decoded by the scalar code till its end, so mixed
+ * text does not pay for a vector load on every character.
+ */
+int utf8_to_uc32s(const char* utf8, int len, Uchar32* ucs, int max_ucs,
+        int* consumed)
+{
+    const Uint8* s = (const Uint8*)utf8;
+    int pos = 0, n = 0;
+
+    while (len - pos >= SIMD_BLOCK && max_ucs - n >= SIMD_BLOCK) {
+        int block_end;
+
+#if defined(__AVX2__)
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + pos));
+
+        if (_mm256_movemask_epi8(v) == 0) {
+            for (int i = 0; i < 32; i += 8) {
+                __m128i b = _mm_loadl_epi64((const __m128i*)(s + pos + i));
+                _mm256_storeu_si256((__m256i*)(ucs + n + i),
+                        _mm256_cvtepu8_epi32(b));
+            }
+            pos += 32;
+            n += 32;
+            continue;
+        }
+#else
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + pos));
+
+        if (_mm_movemask_epi8(v) == 0) {
+            __m128i zero = _mm_setzero_si128();
+            __m128i lo = _mm_unpacklo_epi8(v, zero);
+            __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+            _mm_storeu_si128((__m128i*)(ucs + n),
+                    _mm_unpacklo_epi16(lo, zero));
+            _mm_storeu_si128((__m128i*)(ucs + n + 4),
+                    _mm_unpackhi_epi16(lo, zero));
+            _mm_storeu_si128((__m128i*)(ucs + n + 8),
+                    _mm_unpacklo_epi16(hi, zero));
+            _mm_storeu_si128((__m128i*)(ucs + n + 12),
+                    _mm_unpackhi_epi16(hi, zero));
+            pos += 16;
+            n += 16;
+            continue;
+        }
+#endif
+        block_end = pos + SIMD_BLOCK;
+
+        /* every sequence takes one byte at least, so n stays in range */
+        do {
+            int l = decode_one_utf8(s + pos, len - pos, ucs + n);
+            if (l == 0)
+                goto invalid;
+
+            pos += l;
+            n++;
+        } while (pos < block_end);
+    }
+
+    /* the tail */
+    while (pos < len && n < max_ucs) {
+        int l = decode_one_utf8(s + pos, len - pos, ucs + n);
+        if (l == 0)
+            goto invalid;
+
+        pos += l;
+        n++;
+    }
+
+    if (consumed) *consumed = pos;
+    return n;
+
+invalid:
+    if (consumed) *consumed = pos;
+    return -1;
+}
+
+/*
+ * Blocks of ASCII characters are narrowed to bytes with saturated packing;
+ * the values are known to be less than 0x80, so the saturation never bites.
+ */
+int uc32s_to_utf8(const Uchar32* ucs, int nr_ucs, char* utf8, int max_len,
+        int* consumed)
+{
+    Uint8* d = (Uint8*)utf8;
+    int pos = 0, i = 0;
+
+    while (nr_ucs - i >= SIMD_BLOCK && max_len - pos >= SIMD_BLOCK) {
+        int block_end;
+
+#if defined(__AVX2__)
+        const __m256i* p = (const __m256i*)(ucs + i);
+        __m256i a = _mm256_loadu_si256(p);
+        __m256i b = _mm256_loadu_si256(p + 1);
+        __m256i c = _mm256_loadu_si256(p + 2);
+        __m256i e = _mm256_loadu_si256(p + 3);
+        __m256i t = _mm256_or_si256(_mm256_or_si256(a, b),
+                _mm256_or_si256(c, e));
+
+        if (_mm256_testz_si256(t, _mm256_set1_epi32(~0x7F))) {
+            /* the packs work in 128-bit lanes; restore the order */
+            __m256i ab = _mm256_packs_epi32(a, b);
+            __m256i ce = _mm256_packs_epi32(c, e);
+            __m256i bytes = _mm256_packus_epi16(ab, ce);
+            bytes = _mm256_permutevar8x32_epi32(bytes,
+                    _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+            _mm256_storeu_si256((__m256i*)(d + pos), bytes);
+            i += 32;
+            pos += 32;
+            continue;
+        }
+#else
+        const __m128i* p = (const __m128i*)(ucs + i);
+        __m128i a = _mm_loadu_si128(p);
+        __m128i b = _mm_loadu_si128(p + 1);
+        __m128i c = _mm_loadu_si128(p + 2);
+        __m128i e = _mm_loadu_si128(p + 3);
+        __m128i t = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, e));
+
+        t = _mm_and_si128(t, _mm_set1_epi32(~0x7F));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(t,
+                        _mm_setzero_si128())) == 0xFFFF) {
+            __m128i ab = _mm_packs_epi32(a, b);
+            __m128i ce = _mm_packs_epi32(c, e);
+            _mm_storeu_si128((__m128i*)(d + pos), _mm_packus_epi16(ab, ce));
+            i += 16;
+            pos += 16;
+            continue;
+        }
+#endif
+        block_end = i + SIMD_BLOCK;
+
+        do {
+            int l = encode_one_utf8(ucs[i], d + pos, max_len - pos);
+            if (l < 0)
+                goto invalid;
+            else if (l == 0)
+                goto done;
+
+            pos += l;
+            i++;
+        } while (i < block_end);
+    }
+
+    /* the tail */
+    while (i < nr_ucs) {
+        int l = encode_one_utf8(ucs[i], d + pos, max_len - pos);
+        if (l < 0)
+            goto invalid;
+        else if (l == 0)
+            break;
+
+        pos += l;
+        i++;
+    }
+
+done:
+    if (consumed) *consumed = i;
+    return pos;
+
+invalid:
+    if (consumed) *consumed = i;
+    return -1;
+}
+
+const char* get_transcoder_name(void)
+{
+#if defined(__AVX2__)
+    return "AVX2";
+#else
+    return "SSE2";
+#endif
+}
+
+#else   /* no SIMD */
+
+int utf8_to_uc32s(const char* utf8, int len, Uchar32* ucs, int max_ucs,
+        int* consumed)
+{
+    return utf8_to_uc32s_scalar(utf8, len, ucs, max_ucs, consumed);
+}
+
+int uc32s_to_utf8(const Uchar32* ucs, int nr_ucs, char* utf8, int max_len,
+        int* consumed)
+{
+    return uc32s_to_utf8_scalar(ucs, nr_ucs, utf8, max_len, consumed);
+}
+
+const char* get_transcoder_name(void)
+{
+    return "scalar";
+}
+
+#endif  /* SIMD */
+
+/* xorshift64*; the generator must not touch the state of random() */
+static inline Uint32 synth_random(Uint64* state)
+{
+    Uint64 x = *state;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return (Uint32)((x * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+#define SYNTH_RANGE(st, min, max) \
+    ((min) + synth_random(st) % ((max) - (min) + 1))
+
+#define MAX_SYNTH_WORD_LEN  32
+
+static const char* _synth_kind_names[SYNTH_NR_KINDS] = {
+    "latin",
+    "cjk",
+    "arabic",
+    "hebrew",
+    "combining",
+    "emoji",
+    "space",
+};
+
+static const struct synth_preset {
+    const char* name;
+    int         weights[SYNTH_NR_KINDS];
+} _synth_presets[] = {
+    { "mixed",  { 8, 4, 2, 2, 1, 1, 1 } },
+    { "bidi",   { 4, 0, 4, 4, 0, 0, 1 } },
+    { "all",    { 1, 1, 1, 1, 1, 1, 1 } },
+};
+
+BOOL parse_synth_spec(const char* spec, struct synth_mix* mix)
+{
+    char token[64];
+    int total = 0;
+    size_t i;
+
+    memset(mix, 0, sizeof(*mix));
+
+    while (*spec) {
+        const char* end = strchr(spec, ',');
+        size_t len = end ? (size_t)(end - spec) : strlen(spec);
+        char* value;
+        int weight = 1;
+        BOOL found = FALSE;
+
+        if (len == 0 || len >= sizeof(token))
+            return FALSE;
+
+        strncpy(token, spec, len);
+        token[len] = '\0';
+
+        value = strchr(token, '=');
+        if (value) {
+            *value++ = '\0';
+            weight = atoi(value);
+            if (weight < 0)
+                return FALSE;
+        }
+        else {
+            for (i = 0; i < TABLE_SIZE(_synth_presets); i++) {
+                if (strcasecmp(token, _synth_presets[i].name) == 0) {
+                    memcpy(mix->weights, _synth_presets[i].weights,
+                            sizeof(mix->weights));
+                    found = TRUE;
+                    break;
+                }
+            }
+        }
+
+        for (i = 0; !found && i < SYNTH_NR_KINDS; i++) {
+            if (strcasecmp(token, _synth_kind_names[i]) == 0) {
+                mix->weights[i] = weight;
+                found = TRUE;
+            }
+        }
+
+        if (!found)
+            return FALSE;
+
+        spec += len;
+        if (*spec == ',')
+            spec++;
+    }
+
+    for (i = 0; i < SYNTH_NR_KINDS; i++)
+        total += mix->weights[i];
+
+    return total > 0;
+}
+
+/* generates one word of the given kind; returns the length */
+static int synth_word(Uint64* st, int kind, Uchar32* word)
+{
+    int len = 0, i, n;
+
+    switch (kind) {
+    case SYNTH_LATIN:
+        n = SYNTH_RANGE(st, 2, 10);
+        for (i = 0; i < n; i++) {
+            Uchar32 uc = SYNTH_RANGE(st, 'a', 'z');
+
+            if (i == 0 && synth_random(st) % 4 == 0)
+                uc = SYNTH_RANGE(st, 'A', 'Z');
+            else if (synth_random(st) % 16 == 0)
+                uc = SYNTH_RANGE(st, 0x00E0, 0x00F6);
+            word[len++] = uc;
+        }
+        break;
+
+    case SYNTH_CJK:
+        n = SYNTH_RANGE(st, 1, 6);
+        for (i = 0; i < n; i++)
+            word[len++] = SYNTH_RANGE(st, 0x4E00, 0x9FA5);
+        if (synth_random(st) % 4 == 0)
+            word[len++] = (synth_random(st) % 2) ? 0x3002 : 0xFF0C;
+        break;
+
+    case SYNTH_ARABIC: {
+        BOOL isolated = (synth_random(st) % 4 == 0);
+
+        if (isolated)
+            word[len++] = 0x2067;   // RLI
+        n = SYNTH_RANGE(st, 2, 8);
+        for (i = 0; i < n; i++) {
+            if (synth_random(st) % 2)
+                word[len++] = SYNTH_RANGE(st, 0x0621, 0x063A);
+            else
+                word[len++] = SYNTH_RANGE(st, 0x0641, 0x064A);
+        }
+        if (synth_random(st) % 8 == 0) {
+            word[len++] = ' ';
+            n = SYNTH_RANGE(st, 1, 4);
+            for (i = 0; i < n; i++)
+                word[len++] = SYNTH_RANGE(st, 0x0660, 0x0669);
+        }
+        if (isolated)
+            word[len++] = 0x2069;   // PDI
+        break;
+    }
+
+    case SYNTH_HEBREW: {
+        BOOL embedded = (synth_random(st) % 4 == 0);
+
+        if (embedded)
+            word[len++] = 0x202B;   // RLE
+        n = SYNTH_RANGE(st, 2, 7);
+        for (i = 0; i < n; i++)
+            word[len++] = SYNTH_RANGE(st, 0x05D0, 0x05EA);
+        if (embedded)
+            word[len++] = 0x202C;   // PDF
+        if (synth_random(st) % 8 == 0)
+            word[len++] = 0x200F;   // RLM
+        break;
+    }
+
+    case SYNTH_COMBINING:
+        n = SYNTH_RANGE(st, 1, 4);
+        for (i = 0; i < n; i++) {
+            int nr_marks = SYNTH_RANGE(st, 1, 3);
+
+            word[len++] = SYNTH_RANGE(st, 'a', 'z');
+            while (nr_marks--)
+                word[len++] = SYNTH_RANGE(st, 0x0300, 0x036F);
+        }
+        break;
+
+    case SYNTH_EMOJI:
+        switch (synth_random(st) % 5) {
+        case 0:
+            word[len++] = SYNTH_RANGE(st, 0x1F600, 0x1F64F);
+            break;
+        case 1:     // with a skin tone modifier
+            word[len++] = SYNTH_RANGE(st, 0x1F466, 0x1F469);
+            word[len++] = SYNTH_RANGE(st, 0x1F3FB, 0x1F3FF);
+            break;
+        case 2:     // family: man ZWJ woman ZWJ girl [ZWJ boy]
+            word[len++] = 0x1F468;
+            word[len++] = 0x200D;
+            word[len++] = 0x1F469;
+            word[len++] = 0x200D;
+            word[len++] = 0x1F467;
+            if (synth_random(st) % 2) {
+                word[len++] = 0x200D;
+                word[len++] = 0x1F466;
+            }
+            break;
+        case 3:     // flag
+            word[len++] = SYNTH_RANGE(st, 0x1F1E6, 0x1F1FF);
+            word[len++] = SYNTH_RANGE(st, 0x1F1E6, 0x1F1FF);
+            break;
+        default:    // heart with variation selector
+            word[len++] = 0x2764;
+            word[len++] = 0xFE0F;
+            break;
+        }
+        break;
+
+    case SYNTH_SPACE:
+    default: {
+        static const Uchar32 spaces[] = { 0x20, 0x20, 0x09, 0xA0, 0x3000 };
+
+        n = SYNTH_RANGE(st, 1, 3);
+        for (i = 0; i < n; i++)
+            word[len++] = spaces[synth_random(st) % TABLE_SIZE(spaces)];
+        break;
+    }
+    }
+
+    return len;
+}
+
+int generate_synth_text(unsigned int seed, const struct synth_mix* mix,
+        Uchar32* ucs, int nr_ucs)
+{
+    Uchar32 word[MAX_SYNTH_WORD_LEN];
+    Uint64 state = ((Uint64)seed << 1) | 1;
+    int total = 0, pos = 0, i;
+
+    for (i = 0; i < SYNTH_NR_KINDS; i++)
+        total += mix->weights[i];
+    assert(total > 0);
+
+    while (pos < nr_ucs) {
+        int pick = synth_random(&state) % total;
+        int kind, len;
+
+        for (kind = 0; kind < SYNTH_NR_KINDS - 1; kind++) {
+            if (pick < mix->weights[kind])
+                break;
+            pick -= mix->weights[kind];
+        }
+
+        len = synth_word(&state, kind, word);
+        if (kind != SYNTH_SPACE)
+            word[len++] = ' ';
+
+        if (pos + len > nr_ucs) {
+            /* no room for the whole word; pad with Latin letters */
+            while (pos < nr_ucs)
+                ucs[pos++] = SYNTH_RANGE(&state, 'a', 'z');
+            break;
+        }
+
+        memcpy(ucs + pos, word, sizeof(Uchar32) * len);
+        pos += len;
+    }
+
+    return nr_ucs;
+}
+
 double get_curr_time(void)
 {
     double seconds;
@@ -95,6 +701,175 @@ double get_curr_time(void)
     return seconds;
 }
 
+Uint64 get_curr_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (Uint64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#define MAX_TRACE_PHASES    32
+#define TRACE_BAR_WIDTH     40
+
+enum {
+    TRACE_IDLE = 0,
+    TRACE_RUNNING,
+    TRACE_DONE,
+};
+
+struct trace_phase {
+    const char* name;
+    Uint64      start_ns;   // the start of the first occurrence
+    Uint64      total_ns;
+    int         count;
+};
+
+static struct {
+    int         state;
+    Uint64      begin_ns;
+    Uint64      last_ns;
+    double      pre_main_ms;    // exec to MiniGUIMain, in milliseconds
+    int         nr_phases;
+    struct trace_phase phases[MAX_TRACE_PHASES];
+} _startup_trace;
+
+/*
+ * The time from the exec of the process to now, which covers InitGUI;
+ * the start time in /proc/self/stat is in clock ticks, so this is coarse.
+ */
+static double get_ms_since_exec(void)
+{
+    char buff[1024];
+    unsigned long long start_ticks;
+    struct timespec ts;
+    const char* p;
+    FILE* fp;
+    size_t n;
+    int i;
+
+    if ((fp = fopen("/proc/self/stat", "r")) == NULL)
+        return -1;
+    n = fread(buff, 1, sizeof(buff) - 1, fp);
+    fclose(fp);
+    buff[n] = '\0';
+
+    /* the command may contain spaces; skip it, then the fields 3 to 21 */
+    if ((p = strrchr(buff, ')')) == NULL)
+        return -1;
+    for (i = 0; i < 20; i++) {
+        if ((p = strchr(p + 1, ' ')) == NULL)
+            return -1;
+    }
+    if (sscanf(p + 1, "%llu", &start_ticks) != 1)
+        return -1;
+
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0 -
+        start_ticks * 1000.0 / sysconf(_SC_CLK_TCK);
+}
+
+void startup_trace_begin(void)
+{
+    if (_startup_trace.state != TRACE_IDLE)
+        return;
+
+    if (getenv("MG_STARTUP_TRACE") == NULL) {
+        _startup_trace.state = TRACE_DONE;
+        return;
+    }
+
+    _startup_trace.state = TRACE_RUNNING;
+    _startup_trace.begin_ns = get_curr_ns();
+    _startup_trace.last_ns = _startup_trace.begin_ns;
+    _startup_trace.pre_main_ms = get_ms_since_exec();
+}
+
+void startup_trace_mark(const char* phase)
+{
+    struct trace_phase* tp;
+    Uint64 now;
+    int i;
+
+    if (_startup_trace.state != TRACE_RUNNING)
+        return;
+
+    now = get_curr_ns();
+    for (i = 0; i < _startup_trace.nr_phases; i++) {
+        if (strcmp(_startup_trace.phases[i].name, phase) == 0)
+            break;
+    }
+
+    tp = _startup_trace.phases + i;
+    if (i == _startup_trace.nr_phases) {
+        if (i == MAX_TRACE_PHASES) {
+            _WRN_PRINTF("too many startup phases; %s ignored\n", phase);
+            _startup_trace.last_ns = now;
+            return;
+        }
+
+        tp->name = phase;
+        tp->start_ns = _startup_trace.last_ns;
+        _startup_trace.nr_phases++;
+    }
+
+    tp->total_ns += now - _startup_trace.last_ns;
+    tp->count++;
+    _startup_trace.last_ns = now;
+}
+
+/* the lines start with "startup:" and the name has no space for awk */
+BOOL startup_trace_end(const char* prog)
+{
+    double total_ms, ms_per_col;
+    int i, j;
+
+    if (_startup_trace.state != TRACE_RUNNING)
+        return FALSE;
+
+    _startup_trace.state = TRACE_DONE;
+    total_ms = (_startup_trace.last_ns - _startup_trace.begin_ns) / 1000000.0;
+    ms_per_col = total_ms / TRACE_BAR_WIDTH;
+
+    printf("startup: ===== %s: from MiniGUIMain to the end of first paint\n",
+            prog);
+    printf("startup: %-24s %10s %10s %5s\n",
+            "phase", "start(ms)", "dur(ms)", "times");
+    if (_startup_trace.pre_main_ms >= 0) {
+        printf("startup: %-24s %10.3f %10.3f %5d\n", "exec-to-main",
+                -_startup_trace.pre_main_ms, _startup_trace.pre_main_ms, 1);
+    }
+
+    for (i = 0; i < _startup_trace.nr_phases; i++) {
+        const struct trace_phase* tp = _startup_trace.phases + i;
+        double start_ms = (tp->start_ns - _startup_trace.begin_ns) / 1000000.0;
+        double dur_ms = tp->total_ns / 1000000.0;
+        int col = 0;
+
+        printf("startup: %-24s %10.3f %10.3f %5d |", tp->name,
+                start_ms, dur_ms, tp->count);
+        if (ms_per_col > 0) {
+            col = (int)(start_ms / ms_per_col);
+            for (j = 0; j < col && j < TRACE_BAR_WIDTH; j++)
+                putchar(' ');
+            for (j = 0; j == 0 || j < (int)(dur_ms / ms_per_col); j++)
+                putchar('#');
+        }
+        putchar('\n');
+    }
+
+    printf("startup: %-24s %10.3f %10.3f %5d\n", "to-first-paint",
+            0.0, total_ms, 1);
+    if (_startup_trace.pre_main_ms >= 0) {
+        printf("startup: %-24s %10.3f %10.3f %5d\n", "exec-to-first-paint",
+                -_startup_trace.pre_main_ms,
+                _startup_trace.pre_main_ms + total_ms, 1);
+    }
+
+    fflush(stdout);
+    return TRUE;
+}
+
 const char* get_text_case(const char* text, char* read_buff, size_t n)
 {
     if (strncmp(text, "file:", 5) == 0) {
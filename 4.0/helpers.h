@@ -38,10 +38,79 @@ extern "C" {
 
 int uc32_to_utf8(Uchar32 c, char* outbuf);
 
+/*
+ * Bulk UTF-8 <-> UCS-4 transcoders with strict validation (no overlong
+ * forms, no surrogates, nothing above U+10FFFF). ASCII runs are handled
+ * with SSE2 or AVX2 when the compiler targets them.
+ *
+ * utf8_to_uc32s returns the number of characters decoded, or -1 if an
+ * invalid or truncated sequence was found; *consumed gets the number of
+ * bytes decoded successfully in both cases.
+ *
+ * uc32s_to_utf8 returns the number of bytes written, or -1 if an invalid
+ * code point was found; *consumed gets the number of characters encoded.
+ * Both functions stop early when the output buffer is full.
+ */
+int utf8_to_uc32s(const char* utf8, int len, Uchar32* ucs, int max_ucs,
+        int* consumed);
+int uc32s_to_utf8(const Uchar32* ucs, int nr_ucs, char* utf8, int max_len,
+        int* consumed);
+
+/* the scalar versions, always available; used as the baseline */
+int utf8_to_uc32s_scalar(const char* utf8, int len, Uchar32* ucs, int max_ucs,
+        int* consumed);
+int uc32s_to_utf8_scalar(const Uchar32* ucs, int nr_ucs, char* utf8,
+        int max_len, int* consumed);
+
+const char* get_transcoder_name(void);
+
+/*
+ * Seeded generator of synthetic multilingual paragraphs, for plotting the
+ * cost of text APIs against the input size. The mix gives the relative
+ * weights of the kinds of words to generate; parse_synth_spec() builds it
+ * from a spec like "latin=4,cjk=2,arabic=1" or a preset ("mixed", "bidi").
+ * A bare kind name stands for a weight of 1.
+ */
+enum {
+    SYNTH_LATIN = 0,
+    SYNTH_CJK,
+    SYNTH_ARABIC,       // may be wrapped in RLI/PDI
+    SYNTH_HEBREW,       // may be wrapped in RLE/PDF
+    SYNTH_COMBINING,    // Latin letters with combining marks
+    SYNTH_EMOJI,        // including ZWJ sequences and flags
+    SYNTH_SPACE,        // runs of spaces, tabs, NBSP and U+3000
+    SYNTH_NR_KINDS,
+};
+
+struct synth_mix {
+    int weights[SYNTH_NR_KINDS];
+};
+
+BOOL parse_synth_spec(const char* spec, struct synth_mix* mix);
+
+/* fills exactly nr_ucs characters; the same seed gives the same text */
+int generate_synth_text(unsigned int seed, const struct synth_mix* mix,
+        Uchar32* ucs, int nr_ucs);
+
 const char* get_text_case(const char* text, char* read_buff, size_t n);
 BOOL get_charset_from_filename(const char* pattern, char* buff);
 
 double get_curr_time(void);
+/* monotonic clock in nanoseconds, for timing short calls */
+Uint64 get_curr_ns(void);
+
+/*
+ * Startup tracer, enabled by setting the environment variable
+ * MG_STARTUP_TRACE. startup_trace_begin() is called at the entry of
+ * MiniGUIMain; every startup_trace_mark() ends a phase which began at
+ * the previous mark, and the phases with the same name are summed up.
+ * startup_trace_end() prints the waterfall; it returns TRUE if the
+ * tracer is enabled, and the caller should exit then, so that
+ * startup-profile.sh can launch the program again cold.
+ */
+void startup_trace_begin(void);
+void startup_trace_mark(const char* phase);
+BOOL startup_trace_end(const char* prog);
 
 const char* get_general_category_name(UCharGeneralCategory gc);
 const char* get_break_type_name(UCharBreakType bt);
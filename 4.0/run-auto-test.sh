@@ -17,6 +17,12 @@ if test ! $? -eq 0; then
     exit 1
 fi
 
+./utf8transcoder 10
+if test ! $? -eq 0; then
+    echo "utf8transcoder 10 not passed"
+    exit 1
+fi
+
 ./biditest
 if test ! $? -eq 0; then
     echo "biditest not passed"
@@ -41,6 +47,12 @@ if test ! $? -eq 0; then
     exit 1
 fi
 
+./drawglyphstringex -bench 1
+if test ! $? -eq 0; then
+    echo "drawglyphstringex -bench 1 not passed"
+    exit 1
+fi
+
 ./createtextruns 1
 if test ! $? -eq 0; then
     echo "createtextruns 1 not passed"
@@ -77,6 +89,30 @@ if test ! $? -eq 0; then
     exit 1
 fi
 
+./ellipsizebench 200 1
+if test ! $? -eq 0; then
+    echo "ellipsizebench 200 1 not passed"
+    exit 1
+fi
+
+./concurrentlayout 4 1
+if test ! $? -eq 0; then
+    echo "concurrentlayout 4 1 not passed"
+    exit 1
+fi
+
+./textscaling -synth all 1024
+if test ! $? -eq 0; then
+    echo "textscaling -synth all 1024 not passed"
+    exit 1
+fi
+
+./editingbench 4096 200
+if test ! $? -eq 0; then
+    echo "editingbench 4096 200 not passed"
+    exit 1
+fi
+
 ./basicshapingengine 3600
 if test ! $? -eq 0; then
     echo "basicshapingengine 3600 not passed"
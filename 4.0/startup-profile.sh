@@ -0,0 +1,75 @@
+#!/bin/bash
+
+# Launches a program which calls startup_trace_begin() and friends
+# several times, and summarizes the waterfalls printed by the runs:
+#
+#   ./startup-profile.sh [-n <runs>] [-drop-caches] <program> [args...]
+#
+# Every run is a new process, so the time of InitGUI, loading fonts and
+# the first paint is measured in every run. With -drop-caches (needs root),
+# the page cache is dropped before every run to measure cold starts.
+
+runs=10
+drop_caches=0
+
+while test $# -gt 0; do
+    case $1 in
+    -n)
+        runs=$2
+        shift 2
+        ;;
+    -drop-caches)
+        drop_caches=1
+        shift
+        ;;
+    *)
+        break
+        ;;
+    esac
+done
+
+if test $# -eq 0; then
+    echo "Usage: $0 [-n <runs>] [-drop-caches] <program> [args...]"
+    exit 1
+fi
+
+export MG_STARTUP_TRACE=1
+
+log=$(mktemp)
+trap 'rm -f $log' EXIT
+
+for i in $(seq 1 $runs); do
+    if test $drop_caches -eq 1; then
+        sync
+        echo 3 > /proc/sys/vm/drop_caches
+    fi
+
+    "$@" | grep '^startup: ' | grep -v '=====\| phase ' >> $log
+    if test ! ${PIPESTATUS[0]} -eq 0; then
+        echo "$* failed in run $i"
+        exit 1
+    fi
+done
+
+echo "===== startup of $1 in $runs runs (ms)"
+awk '
+{
+    name = $2; dur = $4;
+    if (!(name in n)) {
+        order[nr++] = name;
+        min[name] = dur;
+        max[name] = dur;
+    }
+    n[name]++;
+    sum[name] += dur;
+    if (dur < min[name]) min[name] = dur;
+    if (dur > max[name]) max[name] = dur;
+}
+END {
+    printf("%-24s %10s %10s %10s\n", "phase", "mean", "min", "max");
+    for (i = 0; i < nr; i++) {
+        name = order[i];
+        printf("%-24s %10.3f %10.3f %10.3f\n", name,
+                sum[name] / n[name], min[name], max[name]);
+    }
+}' $log
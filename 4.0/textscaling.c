@@ -0,0 +1,290 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//                        IMPORTANT LEGAL NOTICE
+//
+// The following open source license statement does not apply to any
+// entity in the Exception List published by FMSoft.
+//
+// For more information, please visit:
+//
+// https://www.fmsoft.cn/exception-list
+//
+//////////////////////////////////////////////////////////////////////////////
+/*
+** textscaling.c:
+**
+**  Scaling curves of the text APIs of MiniGUI 4.0.0: the cost per
+**  character of breaking, bidi resolving, creating text runs and laying
+**  out a synthetic paragraph, as the paragraph grows from 64 characters
+**  to max_chars. A linear API shows a flat ns/char column.
+**
+**  The following APIs are covered:
+**
+**      UStrGetBreaks
+**      UBidiGetParagraphEmbeddingLevelsAlt
+**      CreateTextRuns
+**      InitBasicShapingEngine
+**      CreateLayout
+**      LayoutNextLine
+**
+**  Usage: textscaling [-synth <spec>] [-seed <seed>] [max_chars]
+**
+**  The spec is a list of weights like "latin=4,cjk=2,arabic=1,emoji=1",
+**  or one of the presets "mixed" (the default), "bidi" and "all".
+**
+** Copyright (C) 2019 FMSoft (http://www.fmsoft.cn).
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <minigui/common.h>
+#include <minigui/minigui.h>
+#include <minigui/gdi.h>
+#include <minigui/window.h>
+
+#if (_MINIGUI_VERSION_CODE >= _VERSION_CODE(4,0,0)) \
+        && defined(_MGCHARSET_UNICODE)
+
+#include "helpers.h"
+
+#define MIN_CHARS           64
+#define DEF_MAX_CHARS       (1024 * 64)
+
+/* every measurement handles this many characters at least */
+#define TARGET_CHARS        (1024 * 256)
+
+#define LINE_WIDTH          320
+#define LAYOUT_FONT  "ttf-Courier,宋体,Naskh,SansSerif-rrncns-U-16-UTF-8"
+
+enum {
+    OP_BREAKS = 0,
+    OP_BIDI,
+    OP_TEXTRUNS,
+    OP_LAYOUT,
+    NR_OPS,
+};
+
+static const char* _op_names[NR_OPS] = {
+    "breaks",
+    "bidi",
+    "textruns",
+    "layout",
+};
+
+static BOOL count_glyph(GHANDLE ctxt, Glyph32 gv,
+        const GLYPHPOS* pos, const RENDERDATA* data)
+{
+    (*(int*)ctxt)++;
+    return TRUE;
+}
+
+static double time_breaks(const Uchar32* ucs, int n, int nr_loops)
+{
+    double start_time = get_curr_time();
+    int i;
+
+    for (i = 0; i < nr_loops; i++) {
+        BreakOppo* bos = NULL;
+
+        if (UStrGetBreaks(LANGCODE_unknown, CTR_NONE, WBR_NORMAL, LBP_NORMAL,
+                ucs, n, &bos) <= 0) {
+            _ERR_PRINTF("%s: UStrGetBreaks failed\n", __FUNCTION__);
+            exit(1);
+        }
+        free(bos);
+    }
+
+    return get_curr_time() - start_time;
+}
+
+static double time_bidi(const Uchar32* ucs, int n, int nr_loops)
+{
+    BidiLevel* levels = malloc(sizeof(BidiLevel) * n);
+    double start_time = get_curr_time();
+    int i;
+
+    for (i = 0; i < nr_loops; i++) {
+        BidiType base_dir = BIDI_PGDIR_WLTR;
+
+        if (UBidiGetParagraphEmbeddingLevelsAlt(ucs, n,
+                    &base_dir, levels) == 0) {
+            _ERR_PRINTF("%s: Failed to call UBidiGetParagraphEmbeddingLevelsAlt\n",
+                    __FUNCTION__);
+            exit(1);
+        }
+    }
+
+    start_time = get_curr_time() - start_time;
+    free(levels);
+    return start_time;
+}
+
+static TEXTRUNS* create_text_runs(const Uchar32* ucs, int n)
+{
+    TEXTRUNS* runs;
+
+    runs = CreateTextRuns(ucs, n, LANGCODE_unknown, BIDI_PGDIR_WLTR,
+            LAYOUT_FONT, MakeRGB(0, 0, 0), 0, NULL);
+    if (runs == NULL) {
+        _ERR_PRINTF("%s: CreateTextRuns returns NULL\n", __FUNCTION__);
+        exit(1);
+    }
+
+    if (!InitBasicShapingEngine(runs)) {
+        _ERR_PRINTF("%s: InitBasicShapingEngine returns FALSE\n",
+                __FUNCTION__);
+        exit(1);
+    }
+
+    return runs;
+}
+
+static double time_textruns(const Uchar32* ucs, int n, int nr_loops)
+{
+    double start_time = get_curr_time();
+    int i;
+
+    for (i = 0; i < nr_loops; i++) {
+        DestroyTextRuns(create_text_runs(ucs, n));
+    }
+
+    return get_curr_time() - start_time;
+}
+
+/* lays out the whole paragraph; the text runs and breaks are reused */
+static double time_layout(const Uchar32* ucs, int n, int nr_loops)
+{
+    TEXTRUNS* runs = create_text_runs(ucs, n);
+    BreakOppo* bos = NULL;
+    double start_time;
+    int i;
+
+    if (UStrGetBreaks(LANGCODE_unknown, CTR_NONE, WBR_NORMAL, LBP_NORMAL,
+            ucs, n, &bos) <= 0) {
+        _ERR_PRINTF("%s: UStrGetBreaks failed\n", __FUNCTION__);
+        exit(1);
+    }
+
+    start_time = get_curr_time();
+    for (i = 0; i < nr_loops; i++) {
+        LAYOUT* layout;
+        LAYOUTLINE* line = NULL;
+        int nr_glyphs = 0;
+
+        layout = CreateLayout(runs, GRF_LINE_EXTENT_VARIABLE, bos + 1, FALSE,
+                0, 0, 0, 0, 10, NULL, 0);
+        if (layout == NULL) {
+            _ERR_PRINTF("%s: CreateLayout returns NULL\n", __FUNCTION__);
+            exit(1);
+        }
+
+        while ((line = LayoutNextLine(layout, line, LINE_WIDTH, FALSE,
+                count_glyph, (GHANDLE)&nr_glyphs))) {
+        }
+
+        DestroyLayout(layout);
+
+        if (nr_glyphs == 0) {
+            _ERR_PRINTF("%s: no glyph laid out\n", __FUNCTION__);
+            exit(1);
+        }
+    }
+    start_time = get_curr_time() - start_time;
+
+    DestroyTextRuns(runs);
+    free(bos);
+    return start_time;
+}
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    double (*timers[NR_OPS])(const Uchar32*, int, int) = {
+        time_breaks, time_bidi, time_textruns, time_layout,
+    };
+    double first_ns[NR_OPS], last_ns[NR_OPS];
+    struct synth_mix mix;
+    const char* spec = "mixed";
+    unsigned int seed = 1;
+    int max_chars = DEF_MAX_CHARS;
+    Uchar32* ucs;
+    int n, op, i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-synth") == 0 && i + 1 < argc) {
+            spec = argv[++i];
+        }
+        else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+            seed = (unsigned int)strtoul(argv[++i], NULL, 0);
+        }
+        else {
+            max_chars = atoi(argv[i]);
+        }
+    }
+
+    if (!parse_synth_spec(spec, &mix)) {
+        _ERR_PRINTF("%s: bad synthetic text spec: %s\n", __FUNCTION__, spec);
+        exit(1);
+    }
+
+    if (max_chars < MIN_CHARS)
+        max_chars = MIN_CHARS;
+
+    ucs = malloc(sizeof(Uchar32) * max_chars);
+
+    _MG_PRINTF("========= START TO BENCH text scaling (%s, seed %u)\n",
+            spec, seed);
+    _MG_PRINTF("%8s", "chars");
+    for (op = 0; op < NR_OPS; op++)
+        _MG_PRINTF(" %10s", _op_names[op]);
+    _MG_PRINTF("   (ns/char)\n");
+
+    for (n = MIN_CHARS; n <= max_chars; n *= 2) {
+        int nr_loops = TARGET_CHARS / n;
+
+        if (nr_loops < 1)
+            nr_loops = 1;
+
+        generate_synth_text(seed, &mix, ucs, n);
+
+        _MG_PRINTF("%8d", n);
+        for (op = 0; op < NR_OPS; op++) {
+            double ns = timers[op](ucs, n, nr_loops) * 1.0E9 / n / nr_loops;
+
+            if (n == MIN_CHARS)
+                first_ns[op] = ns;
+            last_ns[op] = ns;
+            _MG_PRINTF(" %10.1f", ns);
+        }
+        _MG_PRINTF("\n");
+    }
+
+    /* the ratio is near 1 for an O(n) API, and near n / MIN_CHARS for O(n^2) */
+    _MG_PRINTF("%8s", "growth");
+    for (op = 0; op < NR_OPS; op++)
+        _MG_PRINTF(" %9.1fx", last_ns[op] / first_ns[op]);
+    _MG_PRINTF("\n");
+
+    _MG_PRINTF("========= END OF BENCH text scaling\n");
+
+    free(ucs);
+    exit(0);
+    return 0;
+}
+
+#else
+#error "To bench text scaling, please use MiniGUI 4.0.0 and enable support for UNICODE"
+#endif /* checking version and features */
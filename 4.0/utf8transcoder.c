@@ -0,0 +1,537 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//                        IMPORTANT LEGAL NOTICE
+//
+// The following open source license statement does not apply to any
+// entity in the Exception List published by FMSoft.
+//
+// For more information, please visit:
+//
+// https://www.fmsoft.cn/exception-list
+//
+//////////////////////////////////////////////////////////////////////////////
+/*
+** utf8transcoder.c:
+**
+**  Test code and throughput benchmark for the bulk UTF-8 <-> UCS-4
+**  transcoders in helpers.c. The results are checked against and
+**  compared with the following APIs of MiniGUI 4.0.0:
+**
+**      CreateLogFontForMChar2UChar
+**      MBS2WCSEx
+**      WCS2MBSEx
+**      GetUCharsUntilParagraphBoundary
+**
+**  Usage: utf8transcoder [nr_loops] [file1.txt file2.txt ...]
+**
+** Copyright (C) 2019 FMSoft (http://www.fmsoft.cn).
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <minigui/common.h>
+#include <minigui/minigui.h>
+#include <minigui/gdi.h>
+#include <minigui/window.h>
+
+#if (_MINIGUI_VERSION_CODE >= _VERSION_CODE(4,0,0)) \
+        && defined(_MGCHARSET_UNICODE)
+
+#include "helpers.h"
+
+#define CORPUS_SIZE         (1024 * 64)
+#define MAX_FILE_SIZE       (1024 * 1024 * 4)
+
+static const char* _samples[] = {
+    "The quick brown fox jumps over the lazy dog. "
+    "Pack my box with five dozen liquor jugs! 0123456789 ",
+
+    "人之初，性本善。性相近，习相远。苟不教，性乃迁。"
+    "教之道，贵以专。昔孟母，择邻处。子不学，断机杼。",
+
+    "MiniGUI 4.0: 中文 English Русский Ελληνικά العربية עברית "
+    "ภาษาไทย 한국어 日本語 😀👍🏽 ",
+};
+
+static const char* _sample_names[] = {
+    "ASCII",
+    "CJK",
+    "mixed",
+};
+
+struct corpus {
+    const char* name;
+    char*       utf8;
+    int         len;
+    Uchar32*    ucs;
+    int         nr_ucs;
+};
+
+static PLOGFONT _lf_utf8;
+
+static void check_invalid_sequences(void)
+{
+    static const char* invalid[] = {
+        "\xC0\xAF",                 // overlong '/'
+        "\xC1\xBF",                 // overlong two-byte form
+        "\xE0\x80\xAF",             // overlong three-byte form
+        "\xF0\x80\x80\xAF",         // overlong four-byte form
+        "\xED\xA0\x80",             // high surrogate
+        "\xED\xBF\xBF",             // low surrogate
+        "\xF4\x90\x80\x80",         // U+110000
+        "\xF8\x88\x80\x80\x80",     // five-byte form
+        "\x80",                     // stray continuation byte
+        "\xE4\xB8",                 // truncated
+        "abc\xE4\xB8\x41",          // bad continuation byte
+    };
+    static const Uchar32 invalid_ucs[] = {
+        0xD800, 0xDBFF, 0xDC00, 0xDFFF, 0x110000, 0xFFFFFFFF,
+    };
+    Uchar32 ucs[16];
+    char utf8[16];
+    size_t i;
+
+    for (i = 0; i < TABLE_SIZE(invalid); i++) {
+        int consumed;
+        int len = strlen(invalid[i]);
+
+        if (utf8_to_uc32s(invalid[i], len, ucs, 16, &consumed) != -1 ||
+                utf8_to_uc32s_scalar(invalid[i], len, ucs, 16, &consumed) != -1) {
+            _ERR_PRINTF("%s: invalid sequence #%d accepted\n",
+                    __FUNCTION__, (int)i);
+            exit(1);
+        }
+    }
+
+    for (i = 0; i < TABLE_SIZE(invalid_ucs); i++) {
+        int consumed;
+
+        if (uc32s_to_utf8(invalid_ucs + i, 1, utf8, 16, &consumed) != -1 ||
+                uc32s_to_utf8_scalar(invalid_ucs + i, 1, utf8, 16,
+                    &consumed) != -1) {
+            _ERR_PRINTF("%s: invalid code point 0x%X accepted\n",
+                    __FUNCTION__, invalid_ucs[i]);
+            exit(1);
+        }
+    }
+}
+
+/*
+ * Long ASCII runs around an invalid or non-ASCII item, which is put in the
+ * middle and at the edges of the 16 and 32-byte blocks of the SIMD paths.
+ */
+#define RUN_LEN             96
+
+static const int _item_offsets[] = {
+    0, 1, 15, 16, 17, 31, 32, 33, 47, 48, 63, 64, 95,
+};
+
+/* puts the item at the offset of an ASCII run; returns the length */
+static int make_ascii_run(char* buff, int offset, const char* item,
+        int item_len)
+{
+    int i;
+
+    for (i = 0; i < RUN_LEN; i++)
+        buff[i] = 'a' + i % 26;
+
+    memcpy(buff + offset, item, item_len);
+    return (offset + item_len > RUN_LEN) ? offset + item_len : RUN_LEN;
+}
+
+static void check_simd_blocks(void)
+{
+    static const char* invalid[] = {
+        "\xC0\xAF",                 // overlong '/'
+        "\xED\xA0\x80",             // high surrogate
+        "\xED\xBF\xBF",             // low surrogate
+        "\xF4\x90\x80\x80",         // U+110000
+        "\x80",                     // stray continuation byte
+        "\xFF",                     // never in UTF-8
+        "\xE4\xB8",                 // truncated, or a bad continuation
+    };
+    static const char* valid[] = {
+        "\xC3\xA9",                 // U+00E9
+        "\xE4\xB8\xAD",             // U+4E2D
+        "\xF0\x9F\x98\x80",         // U+1F600
+    };
+    static const Uchar32 invalid_ucs[] = {
+        0xD800, 0xDFFF, 0x110000,
+    };
+    static const Uchar32 valid_ucs[] = {
+        0x80, 0x7FF, 0xFFFF, 0x10FFFF,
+    };
+    Uchar32 ucs[RUN_LEN + 4], ucs_ref[RUN_LEN + 4];
+    char utf8[RUN_LEN * 4 + 4], utf8_ref[RUN_LEN * 4 + 4];
+    size_t i, j;
+
+    for (i = 0; i < TABLE_SIZE(_item_offsets); i++) {
+        int offset = _item_offsets[i];
+
+        for (j = 0; j < TABLE_SIZE(invalid); j++) {
+            int len = make_ascii_run(utf8, offset, invalid[j],
+                    strlen(invalid[j]));
+
+            if (utf8_to_uc32s(utf8, len, ucs, RUN_LEN + 4, NULL) != -1 ||
+                    utf8_to_uc32s_scalar(utf8, len, ucs, RUN_LEN + 4,
+                        NULL) != -1) {
+                _ERR_PRINTF("%s: invalid sequence #%d at %d accepted\n",
+                        __FUNCTION__, (int)j, offset);
+                exit(1);
+            }
+        }
+
+        for (j = 0; j < TABLE_SIZE(valid); j++) {
+            int len = make_ascii_run(utf8, offset, valid[j], strlen(valid[j]));
+            int n, n_ref;
+
+            n = utf8_to_uc32s(utf8, len, ucs, RUN_LEN + 4, NULL);
+            n_ref = utf8_to_uc32s_scalar(utf8, len, ucs_ref, RUN_LEN + 4,
+                    NULL);
+            if (n <= 0 || n != n_ref ||
+                    memcmp(ucs, ucs_ref, sizeof(Uchar32) * n)) {
+                _ERR_PRINTF("%s: sequence #%d at %d decoded wrongly\n",
+                        __FUNCTION__, (int)j, offset);
+                exit(1);
+            }
+        }
+
+        for (j = 0; j < TABLE_SIZE(invalid_ucs) + TABLE_SIZE(valid_ucs); j++) {
+            BOOL is_valid = (j >= TABLE_SIZE(invalid_ucs));
+            int k, len, len_ref;
+
+            for (k = 0; k < RUN_LEN; k++)
+                ucs[k] = 'a' + k % 26;
+            ucs[offset] = is_valid ? valid_ucs[j - TABLE_SIZE(invalid_ucs)] :
+                invalid_ucs[j];
+
+            len = uc32s_to_utf8(ucs, RUN_LEN, utf8, sizeof(utf8), NULL);
+            len_ref = uc32s_to_utf8_scalar(ucs, RUN_LEN, utf8_ref,
+                    sizeof(utf8_ref), NULL);
+            if (is_valid ? (len <= 0 || len != len_ref ||
+                        memcmp(utf8, utf8_ref, len)) :
+                    (len != -1 || len_ref != -1)) {
+                _ERR_PRINTF("%s: code point 0x%X at %d encoded wrongly\n",
+                        __FUNCTION__, ucs[offset], offset);
+                exit(1);
+            }
+        }
+    }
+}
+
+/* mostly ASCII, so that whole ASCII blocks are common */
+static Uchar32 random_uchar(BOOL mostly_ascii)
+{
+    Uchar32 uc;
+
+    if (mostly_ascii && random() % 64)
+        return 1 + random() % 0x7F;
+
+    switch (random() % 4) {
+    case 0:
+    case 1:
+        /* no NUL; MBS2WCSEx takes it as the end of the string */
+        return 1 + random() % 0x7F;
+    case 2:
+        do {
+            uc = 0x80 + random() % (0x10000 - 0x80);
+        } while (uc >= 0xD800 && uc <= 0xDFFF);
+        return uc;
+    default:
+        return 0x10000 + random() % 0x100000;
+    }
+}
+
+static void check_random_roundtrips(int nr_loops)
+{
+    static Uchar32 ucs[1024], ucs_back[1024];
+    static char utf8[1024 * 4], utf8_ref[1024 * 4];
+    int i, j;
+
+    for (i = 0; i < nr_loops; i++) {
+        int n = random() % 1024;
+        int len, len_ref, nr_back, conved;
+
+        len_ref = 0;
+        for (j = 0; j < n; j++) {
+            ucs[j] = random_uchar(i % 2);
+            len_ref += uc32_to_utf8(ucs[j], utf8_ref + len_ref);
+        }
+
+        len = uc32s_to_utf8(ucs, n, utf8, sizeof(utf8), NULL);
+        if (len != len_ref || memcmp(utf8, utf8_ref, len)) {
+            _ERR_PRINTF("%s: encoded result mismatched with uc32_to_utf8\n",
+                    __FUNCTION__);
+            exit(1);
+        }
+
+        nr_back = utf8_to_uc32s(utf8, len, ucs_back, 1024, NULL);
+        if (nr_back != n || memcmp(ucs, ucs_back, sizeof(Uchar32) * n)) {
+            _ERR_PRINTF("%s: decoded result mismatched with the source\n",
+                    __FUNCTION__);
+            exit(1);
+        }
+
+        nr_back = MBS2WCSEx(_lf_utf8, ucs_back, TRUE,
+                (const unsigned char*)utf8, len, 1024, &conved);
+        if (nr_back != n || memcmp(ucs, ucs_back, sizeof(Uchar32) * n)) {
+            _ERR_PRINTF("%s: decoded result mismatched with MBS2WCSEx\n",
+                    __FUNCTION__);
+            exit(1);
+        }
+    }
+}
+
+static BOOL init_corpus(struct corpus* cp, const char* name,
+        const char* sample, int sample_len, int size)
+{
+    int nr_ucs;
+
+    cp->name = name;
+    cp->utf8 = malloc(size);
+    cp->len = 0;
+    while (cp->len + sample_len <= size) {
+        memcpy(cp->utf8 + cp->len, sample, sample_len);
+        cp->len += sample_len;
+    }
+
+    cp->ucs = malloc(sizeof(Uchar32) * cp->len);
+    nr_ucs = utf8_to_uc32s_scalar(cp->utf8, cp->len, cp->ucs, cp->len, NULL);
+    if (nr_ucs <= 0) {
+        _ERR_PRINTF("%s: corpus %s is not valid UTF-8\n", __FUNCTION__, name);
+        free(cp->utf8);
+        free(cp->ucs);
+        return FALSE;
+    }
+
+    cp->nr_ucs = nr_ucs;
+    return TRUE;
+}
+
+static BOOL load_corpus_from_file(struct corpus* cp, const char* file)
+{
+    FILE* fp;
+    char* buff;
+    long size;
+
+    fp = fopen(file, "rb");
+    if (fp == NULL) {
+        _ERR_PRINTF("%s: failed to open %s\n", __FUNCTION__, file);
+        return FALSE;
+    }
+
+    buff = malloc(MAX_FILE_SIZE);
+    size = fread(buff, 1, MAX_FILE_SIZE, fp);
+    fclose(fp);
+
+    if (size <= 0) {
+        free(buff);
+        return FALSE;
+    }
+
+    if (!init_corpus(cp, file, buff, size, size)) {
+        free(buff);
+        return FALSE;
+    }
+
+    free(buff);
+    return TRUE;
+}
+
+static void destroy_corpus(struct corpus* cp)
+{
+    free(cp->utf8);
+    free(cp->ucs);
+}
+
+static void report(const char* what, const struct corpus* cp,
+        int nr_loops, double elapsed)
+{
+    double mb = (double)cp->len * nr_loops / (1024 * 1024);
+    double mc = (double)cp->nr_ucs * nr_loops / 1000000;
+
+    if (elapsed <= 0)
+        elapsed = 1e-9;
+
+    _MG_PRINTF("    %-40s %10.2f MB/s %10.2f Mchars/s\n", what,
+            mb / elapsed, mc / elapsed);
+}
+
+static void bench_corpus(const struct corpus* cp, int nr_loops)
+{
+    Uchar32* ucs = malloc(sizeof(Uchar32) * cp->nr_ucs);
+    char* utf8 = malloc(cp->len);
+    double start_time;
+    int i, n, conved;
+
+    _MG_PRINTF("%s: %d bytes, %d chars\n", cp->name, cp->len, cp->nr_ucs);
+
+    /* decoding; the output of every way is checked after timing */
+    memset(ucs, 0, sizeof(Uchar32) * cp->nr_ucs);
+    start_time = get_curr_time();
+    for (i = 0; i < nr_loops; i++) {
+        n = utf8_to_uc32s_scalar(cp->utf8, cp->len, ucs, cp->nr_ucs, NULL);
+        if (n != cp->nr_ucs) goto error;
+    }
+    report("utf8_to_uc32s_scalar", cp, nr_loops,
+            get_curr_time() - start_time);
+    if (memcmp(ucs, cp->ucs, sizeof(Uchar32) * cp->nr_ucs)) goto error;
+
+    memset(ucs, 0, sizeof(Uchar32) * cp->nr_ucs);
+    start_time = get_curr_time();
+    for (i = 0; i < nr_loops; i++) {
+        n = utf8_to_uc32s(cp->utf8, cp->len, ucs, cp->nr_ucs, NULL);
+        if (n != cp->nr_ucs) goto error;
+    }
+    report("utf8_to_uc32s", cp, nr_loops, get_curr_time() - start_time);
+    if (memcmp(ucs, cp->ucs, sizeof(Uchar32) * cp->nr_ucs)) goto error;
+
+    memset(ucs, 0, sizeof(Uchar32) * cp->nr_ucs);
+    start_time = get_curr_time();
+    for (i = 0; i < nr_loops; i++) {
+        n = MBS2WCSEx(_lf_utf8, ucs, TRUE, (const unsigned char*)cp->utf8,
+                cp->len, cp->nr_ucs, &conved);
+        if (n != cp->nr_ucs) goto error;
+    }
+    report("MBS2WCSEx", cp, nr_loops, get_curr_time() - start_time);
+    if (memcmp(ucs, cp->ucs, sizeof(Uchar32) * cp->nr_ucs)) goto error;
+
+    start_time = get_curr_time();
+    for (i = 0; i < nr_loops; i++) {
+        Uchar32* parag_ucs = NULL;
+        int left = cp->len;
+        const char* text = cp->utf8;
+
+        while (left > 0) {
+            int consumed = GetUCharsUntilParagraphBoundary(_lf_utf8, text,
+                    left, WSR_PRE_WRAP, &parag_ucs, &n);
+            if (consumed <= 0) goto error;
+
+            free(parag_ucs);
+            parag_ucs = NULL;
+            text += consumed;
+            left -= consumed;
+        }
+    }
+    report("GetUCharsUntilParagraphBoundary", cp, nr_loops,
+            get_curr_time() - start_time);
+
+    /* encoding */
+    memset(utf8, 0, cp->len);
+    start_time = get_curr_time();
+    for (i = 0; i < nr_loops; i++) {
+        int j, len = 0;
+
+        for (j = 0; j < cp->nr_ucs; j++) {
+            len += uc32_to_utf8(cp->ucs[j], utf8 + len);
+        }
+        if (len != cp->len) goto error;
+    }
+    report("uc32_to_utf8 (per character)", cp, nr_loops,
+            get_curr_time() - start_time);
+    if (memcmp(utf8, cp->utf8, cp->len)) goto error;
+
+    memset(utf8, 0, cp->len);
+    start_time = get_curr_time();
+    for (i = 0; i < nr_loops; i++) {
+        n = uc32s_to_utf8_scalar(cp->ucs, cp->nr_ucs, utf8, cp->len, NULL);
+        if (n != cp->len) goto error;
+    }
+    report("uc32s_to_utf8_scalar", cp, nr_loops,
+            get_curr_time() - start_time);
+    if (memcmp(utf8, cp->utf8, cp->len)) goto error;
+
+    memset(utf8, 0, cp->len);
+    start_time = get_curr_time();
+    for (i = 0; i < nr_loops; i++) {
+        n = uc32s_to_utf8(cp->ucs, cp->nr_ucs, utf8, cp->len, NULL);
+        if (n != cp->len) goto error;
+    }
+    report("uc32s_to_utf8", cp, nr_loops, get_curr_time() - start_time);
+    if (memcmp(utf8, cp->utf8, cp->len)) goto error;
+
+    memset(utf8, 0, cp->len);
+    start_time = get_curr_time();
+    for (i = 0; i < nr_loops; i++) {
+        n = WCS2MBSEx(_lf_utf8, (unsigned char*)utf8, TRUE, cp->ucs,
+                cp->nr_ucs, cp->len, &conved);
+        if (n != cp->len) goto error;
+    }
+    report("WCS2MBSEx", cp, nr_loops, get_curr_time() - start_time);
+
+    if (memcmp(utf8, cp->utf8, cp->len)) goto error;
+
+    free(ucs);
+    free(utf8);
+    return;
+
+error:
+    _ERR_PRINTF("%s: unexpected result when transcoding %s\n",
+            __FUNCTION__, cp->name);
+    exit(1);
+}
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    struct corpus cp;
+    int nr_loops = 100;
+    int i;
+
+    if (argc > 1)
+        nr_loops = atoi(argv[1]);
+    if (nr_loops <= 0)
+        nr_loops = 1;
+
+    srandom(time(NULL));
+
+    if (!(_lf_utf8 = CreateLogFontForMChar2UChar("utf-8"))) {
+        _ERR_PRINTF("%s: failed to create logfont for UTF-8\n", __FUNCTION__);
+        exit(1);
+    }
+
+    _MG_PRINTF("========= START TO TEST UTF-8 transcoders (%s)\n",
+            get_transcoder_name());
+    check_invalid_sequences();
+    check_simd_blocks();
+    check_random_roundtrips(nr_loops * 10);
+    _MG_PRINTF("========= END OF TEST UTF-8 transcoders\n");
+
+    for (i = 0; i < (int)TABLE_SIZE(_samples); i++) {
+        if (!init_corpus(&cp, _sample_names[i], _samples[i],
+                    strlen(_samples[i]), CORPUS_SIZE))
+            exit(1);
+        bench_corpus(&cp, nr_loops);
+        destroy_corpus(&cp);
+    }
+
+    for (i = 2; i < argc; i++) {
+        if (load_corpus_from_file(&cp, argv[i])) {
+            bench_corpus(&cp, nr_loops);
+            destroy_corpus(&cp);
+        }
+    }
+
+    DestroyLogFont(_lf_utf8);
+
+    exit(0);
+    return 0;
+}
+
+#else
+#error "To test UTF-8 transcoders, please use MiniGUI 4.0.0 and enable support for UNICODE"
+#endif /* checking version and features */
@@ -0,0 +1,365 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//                        IMPORTANT LEGAL NOTICE
+//
+// The following open source license statement does not apply to any
+// entity in the Exception List published by FMSoft.
+//
+// For more information, please visit:
+//
+// https://www.fmsoft.cn/exception-list
+//
+//////////////////////////////////////////////////////////////////////////////
+/*
+**  Benchmark of the cost of clipping for MiniGUI 5.0.
+**
+**  This program creates a bottom main window, then covers it with windows
+**  in checkerboard patterns from none to fine ones, so the visible region
+**  of the bottom window gets more and more rectangles. For every pattern,
+**  FillBox, BitBlt and DrawText in the bottom window are timed, and the
+**  results are reported against the number of rectangles in the visible
+**  region, which is read back from the client DC with PtVisible. The same
+**  operations on HDC_SCREEN, which is not clipped by windows, are timed as
+**  the baseline.
+**
+**  Note that under the compositing schema every window has its own
+**  surface, so the DC is not clipped by the covers, the visible region has
+**  one rectangle, and the cost should not change with the patterns.
+**
+**  Usage: clipcost [nr_repeats]
+**
+**  The following APIs are covered:
+**
+**      CreateMainWindow
+**      DestroyMainWindow
+**      MainWindowCleanup
+**      GetClientDC
+**      ReleaseDC
+**      CreateCompatibleDCEx
+**      DeleteMemDC
+**      FillBox
+**      BitBlt
+**      DrawText
+**      PtVisible
+**
+** Copyright (C) 2020 FMSoft (http://www.fmsoft.cn).
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <minigui/common.h>
+#include <minigui/minigui.h>
+#include <minigui/gdi.h>
+#include <minigui/window.h>
+
+#include "helpers.h"
+
+#define DEF_NR_REPEATS      200
+
+#define BOTTOM_WIDTH        320
+#define BOTTOM_HEIGHT       240
+
+/* 0 for no cover; the finest pattern has 96 covers */
+static const int cell_sizes [] = { 0, 160, 80, 40, 20 };
+
+#define MAX_COVERS  \
+    ((BOTTOM_WIDTH / 20) * (BOTTOM_HEIGHT / 20) / 2)
+
+static const char *bench_text =
+    "The quick brown fox jumps over the lazy dog. "
+    "The quick brown fox jumps over the lazy dog. "
+    "The quick brown fox jumps over the lazy dog. "
+    "The quick brown fox jumps over the lazy dog.";
+
+typedef struct clip_level {
+    int         cell_size;
+    int         nr_covers;
+    int         nr_rects;       // in the visible region of the bottom window
+    double      fill_ns;
+    double      blit_ns;
+    double      text_ns;
+} clip_level_t;
+
+static struct clip_info {
+    int         nr_repeats;
+
+    HWND        bottom;
+    RECT        rc_bottom;
+    HWND        covers [MAX_COVERS];
+    RECT        rc_covers [MAX_COVERS];
+    int         nr_covers;
+} clip;
+
+static LRESULT
+ClipWinProc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
+{
+    return DefaultMainWinProc (hwnd, message, wparam, lparam);
+}
+
+static HWND create_window (const RECT *rc, const char *caption,
+        gal_pixel bkcolor)
+{
+    MAINWINCREATE create_info;
+
+    // no caption or border, so that the client area is the whole window
+    create_info.dwStyle = WS_VISIBLE;
+    create_info.dwExStyle = WS_EX_NONE;
+    create_info.spCaption = caption;
+    create_info.hMenu = 0;
+    create_info.hCursor = GetSystemCursor (0);
+    create_info.hIcon = 0;
+    create_info.MainWindowProc = ClipWinProc;
+    create_info.lx = rc->left;
+    create_info.ty = rc->top;
+    create_info.rx = rc->right;
+    create_info.by = rc->bottom;
+    create_info.iBkColor = bkcolor;
+    create_info.dwAddData = 0;
+    create_info.hHosting = HWND_DESKTOP;
+
+    return CreateMainWindow (&create_info);
+}
+
+static void handle_messages (void)
+{
+    MSG msg;
+
+    while (PeekMessage (&msg, clip.bottom, 0, 0, PM_REMOVE)) {
+        TranslateMessage (&msg);
+        DispatchMessage (&msg);
+    }
+}
+
+static BOOL cover_bottom_window (int cell_size)
+{
+    if (cell_size == 0)
+        return TRUE;
+
+    for (int y = 0; y * cell_size < BOTTOM_HEIGHT; y++) {
+        for (int x = 0; x * cell_size < BOTTOM_WIDTH; x++) {
+            RECT *rc = clip.rc_covers + clip.nr_covers;
+
+            if ((x + y) % 2)
+                continue;
+
+            rc->left = clip.rc_bottom.left + x * cell_size;
+            rc->top = clip.rc_bottom.top + y * cell_size;
+            rc->right = rc->left + cell_size;
+            rc->bottom = rc->top + cell_size;
+
+            clip.covers [clip.nr_covers] = create_window (rc, "A cover",
+                    PIXEL_blue);
+            if (clip.covers [clip.nr_covers] == HWND_INVALID) {
+                _ERR_PRINTF ("failed to create the cover window #%d\n",
+                        clip.nr_covers);
+                return FALSE;
+            }
+            clip.nr_covers++;
+        }
+    }
+
+    return TRUE;
+}
+
+static void uncover_bottom_window (void)
+{
+    for (int i = 0; i < clip.nr_covers; i++) {
+        DestroyMainWindow (clip.covers [i]);
+        MainWindowCleanup (clip.covers [i]);
+    }
+
+    clip.nr_covers = 0;
+}
+
+/*
+ * Counts the rectangles of the region the DC is clipped by. MiniGUI keeps
+ * a region in y-x bands, and adjacent rows with the same visible spans
+ * share the rectangles of a band, so only a row different from the last
+ * one adds its spans to the count.
+ */
+static int count_visible_rects (HDC hdc)
+{
+    char row [BOTTOM_WIDTH], last_row [BOTTOM_WIDTH];
+    int nr_rects = 0;
+
+    memset (last_row, 0, sizeof (last_row));
+    for (int y = 0; y < BOTTOM_HEIGHT; y++) {
+        int nr_spans = 0;
+
+        for (int x = 0; x < BOTTOM_WIDTH; x++) {
+            row [x] = PtVisible (hdc, x, y) ? 1 : 0;
+            if (row [x] && (x == 0 || !row [x - 1]))
+                nr_spans++;
+        }
+
+        if (memcmp (row, last_row, sizeof (row))) {
+            nr_rects += nr_spans;
+            memcpy (last_row, row, sizeof (row));
+        }
+    }
+
+    return nr_rects;
+}
+
+static double time_fill_box (HDC hdc)
+{
+    Uint64 start_ns = get_curr_ns ();
+
+    for (int i = 0; i < clip.nr_repeats; i++) {
+        SetBrushColor (hdc, (i & 1) ? PIXEL_lightwhite : PIXEL_red);
+        FillBox (hdc, 0, 0, BOTTOM_WIDTH, BOTTOM_HEIGHT);
+    }
+
+    return (double)(get_curr_ns () - start_ns) / clip.nr_repeats;
+}
+
+static double time_bitblt (HDC hdc, HDC memdc)
+{
+    Uint64 start_ns = get_curr_ns ();
+
+    for (int i = 0; i < clip.nr_repeats; i++) {
+        BitBlt (memdc, 0, 0, BOTTOM_WIDTH, BOTTOM_HEIGHT, hdc, 0, 0, 0);
+    }
+
+    return (double)(get_curr_ns () - start_ns) / clip.nr_repeats;
+}
+
+static double time_draw_text (HDC hdc)
+{
+    RECT rc = { 0, 0, BOTTOM_WIDTH, BOTTOM_HEIGHT };
+    Uint64 start_ns = get_curr_ns ();
+
+    for (int i = 0; i < clip.nr_repeats; i++) {
+        DrawText (hdc, bench_text, -1, &rc, DT_LEFT | DT_TOP | DT_WORDBREAK);
+    }
+
+    return (double)(get_curr_ns () - start_ns) / clip.nr_repeats;
+}
+
+static BOOL time_operations (HDC hdc, clip_level_t *level)
+{
+    HDC memdc;
+
+    memdc = CreateCompatibleDCEx (hdc, BOTTOM_WIDTH, BOTTOM_HEIGHT);
+    if (memdc == HDC_INVALID) {
+        _ERR_PRINTF ("FATAL ERROR: failed to create the memory DC\n");
+        return FALSE;
+    }
+
+    SetBrushColor (memdc, PIXEL_green);
+    FillBox (memdc, 0, 0, BOTTOM_WIDTH, BOTTOM_HEIGHT);
+    SetBkMode (hdc, BM_TRANSPARENT);
+
+    level->fill_ns = time_fill_box (hdc);
+    level->blit_ns = time_bitblt (hdc, memdc);
+    level->text_ns = time_draw_text (hdc);
+
+    DeleteMemDC (memdc);
+    return TRUE;
+}
+
+static void print_level (const char *pattern, const clip_level_t *level)
+{
+    _MG_PRINTF ("%-14s %8d %8d %14.0f %14.0f %14.0f\n", pattern,
+            level->nr_covers, level->nr_rects,
+            level->fill_ns, level->blit_ns, level->text_ns);
+}
+
+static int run_levels (void)
+{
+    clip_level_t level;
+    char pattern [32];
+    int retval = 0;
+
+    _MG_PRINTF ("%-14s %8s %8s %14s %14s %14s\n", "pattern", "covers",
+            "rects", "FillBox (ns)", "BitBlt (ns)", "DrawText (ns)");
+
+    // the baseline without any clipping by windows
+    memset (&level, 0, sizeof (level));
+    level.nr_rects = 1;
+    if (!time_operations (HDC_SCREEN, &level))
+        return -1;
+    print_level ("HDC_SCREEN", &level);
+
+    for (int i = 0; i < TABLESIZE (cell_sizes); i++) {
+        HDC hdc;
+
+        memset (&level, 0, sizeof (level));
+        level.cell_size = cell_sizes [i];
+
+        if (!cover_bottom_window (level.cell_size)) {
+            retval = -1;
+            uncover_bottom_window ();
+            break;
+        }
+        handle_messages ();
+
+        level.nr_covers = clip.nr_covers;
+
+        hdc = GetClientDC (clip.bottom);
+        level.nr_rects = count_visible_rects (hdc);
+        if (!time_operations (hdc, &level))
+            retval = -1;
+        ReleaseDC (hdc);
+
+        uncover_bottom_window ();
+        handle_messages ();
+
+        if (retval)
+            break;
+
+        if (level.cell_size)
+            snprintf (pattern, sizeof (pattern), "checker-%d", level.cell_size);
+        else
+            strcpy (pattern, "none");
+        print_level (pattern, &level);
+    }
+
+    return retval;
+}
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    int retval;
+
+    JoinLayer (NAME_DEF_LAYER , "clipcost" , 0 , 0);
+
+    clip.nr_repeats = DEF_NR_REPEATS;
+    if (argc > 1)
+        clip.nr_repeats = atoi (argv[1]);
+    if (clip.nr_repeats <= 0)
+        clip.nr_repeats = DEF_NR_REPEATS;
+
+    SetRect (&clip.rc_bottom, 0, 0, BOTTOM_WIDTH, BOTTOM_HEIGHT);
+    clip.bottom = create_window (&clip.rc_bottom, "The bottom window",
+            PIXEL_lightwhite);
+    if (clip.bottom == HWND_INVALID) {
+        _ERR_PRINTF ("FATAL ERROR: failed to create the bottom window\n");
+        return -1;
+    }
+    handle_messages ();
+
+    _MG_PRINTF ("========= START TO BENCH clipping: %d repeats, "
+            "bottom window %d x %d\n",
+            clip.nr_repeats, BOTTOM_WIDTH, BOTTOM_HEIGHT);
+    retval = run_levels ();
+    _MG_PRINTF ("========= END OF BENCH clipping\n");
+
+    DestroyMainWindow (clip.bottom);
+    MainWindowCleanup (clip.bottom);
+    return retval;
+}
@@ -0,0 +1,205 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//                        IMPORTANT LEGAL NOTICE
+//
+// The following open source license statement does not apply to any
+// entity in the Exception List published by FMSoft.
+//
+// For more information, please visit:
+//
+// https://www.fmsoft.cn/exception-list
+//
+//////////////////////////////////////////////////////////////////////////////
+/*
+** helpers.c:
+**  Helpers for test code of MiniGUI 5.0
+**
+** Copyright (C) 2020 FMSoft (http://www.fmsoft.cn).
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include <minigui/common.h>
+#include <minigui/minigui.h>
+
+#include "helpers.h"
+
+Uint64 get_curr_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (Uint64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+long get_rss_kb (void)
+{
+    FILE *fp;
+    long pages = 0;
+
+    fp = fopen ("/proc/self/statm", "r");
+    if (fp == NULL)
+        return 0;
+
+    if (fscanf (fp, "%*d %ld", &pages) != 1)
+        pages = 0;
+    fclose (fp);
+
+    return pages * (sysconf (_SC_PAGESIZE) / 1024);
+}
+
+BOOL get_heap_usage (size_t *in_use, size_t *total)
+{
+#if defined(__GLIBC__) && \
+        (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 mi = mallinfo2 ();
+
+    // the chunks allocated by mmap are in use and got from the system
+    *in_use = mi.uordblks + mi.hblkhd;
+    *total = mi.arena + mi.hblkhd;
+    return TRUE;
+#else
+    *in_use = 0;
+    *total = 0;
+    return FALSE;
+#endif
+}
+
+static Uint64 get_rusage_ns (int who)
+{
+    struct rusage ru;
+
+    if (getrusage (who, &ru))
+        return 0;
+
+    return (Uint64)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ULL +
+        (Uint64)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+}
+
+Uint64 get_cpu_time_ns (void)
+{
+    return get_rusage_ns (RUSAGE_SELF);
+}
+
+Uint64 get_thread_cpu_time_ns (void)
+{
+#ifdef RUSAGE_THREAD
+    return get_rusage_ns (RUSAGE_THREAD);
+#else
+    return 0;
+#endif
+}
+
+void lat_hist_init (lat_hist_t *hist)
+{
+    memset (hist, 0, sizeof (lat_hist_t));
+    hist->min = (Uint64)-1;
+}
+
+static inline int get_bucket_index (Uint64 ns)
+{
+    int msb, shift;
+
+    if (ns < LAT_HIST_SUB_BUCKETS)
+        return (int)ns;
+
+    msb = 63 - __builtin_clzll (ns);
+    shift = msb - LAT_HIST_SUB_BITS;
+    return (shift + 1) * LAT_HIST_SUB_BUCKETS +
+        (int)((ns >> shift) & (LAT_HIST_SUB_BUCKETS - 1));
+}
+
+/* the largest value falling in the bucket */
+static inline Uint64 get_bucket_bound (int idx)
+{
+    int group = idx / LAT_HIST_SUB_BUCKETS;
+    Uint64 sub = idx % LAT_HIST_SUB_BUCKETS;
+
+    if (group == 0)
+        return sub;
+
+    return ((LAT_HIST_SUB_BUCKETS + sub + 1) << (group - 1)) - 1;
+}
+
+void lat_hist_add (lat_hist_t *hist, Uint64 ns)
+{
+    hist->counts [get_bucket_index (ns)]++;
+    hist->nr_samples++;
+    hist->sum += ns;
+    if (ns < hist->min)
+        hist->min = ns;
+    if (ns > hist->max)
+        hist->max = ns;
+}
+
+void lat_hist_merge (lat_hist_t *to, const lat_hist_t *from)
+{
+    for (int i = 0; i < LAT_HIST_NR_BUCKETS; i++)
+        to->counts [i] += from->counts [i];
+
+    to->nr_samples += from->nr_samples;
+    to->sum += from->sum;
+    if (from->min < to->min)
+        to->min = from->min;
+    if (from->max > to->max)
+        to->max = from->max;
+}
+
+Uint64 lat_hist_percentile (const lat_hist_t *hist, double percent)
+{
+    Uint64 rank, seen = 0;
+
+    if (hist->nr_samples == 0)
+        return 0;
+
+    rank = (Uint64)(hist->nr_samples * percent / 100.0 + 0.5);
+    if (rank == 0)
+        rank = 1;
+
+    for (int i = 0; i < LAT_HIST_NR_BUCKETS; i++) {
+        seen += hist->counts [i];
+        if (seen >= rank) {
+            Uint64 bound = get_bucket_bound (i);
+            return (bound > hist->max) ? hist->max : bound;
+        }
+    }
+
+    return hist->max;
+}
+
+void lat_hist_print (const lat_hist_t *hist, const char *name)
+{
+    if (hist->nr_samples == 0) {
+        _MG_PRINTF ("%-24s %8d\n", name, 0);
+        return;
+    }
+
+    _MG_PRINTF ("%-24s %8llu  avg %9.2f  p50 %9.2f  p99 %9.2f  "
+            "p999 %9.2f  max %9.2f (us)\n",
+            name, (unsigned long long)hist->nr_samples,
+            hist->sum / 1000.0 / hist->nr_samples,
+            lat_hist_percentile (hist, 50) / 1000.0,
+            lat_hist_percentile (hist, 99) / 1000.0,
+            lat_hist_percentile (hist, 99.9) / 1000.0,
+            hist->max / 1000.0);
+}
+
@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//                        IMPORTANT LEGAL NOTICE
+//
+// The following open source license statement does not apply to any
+// entity in the Exception List published by FMSoft.
+//
+// For more information, please visit:
+//
+// https://www.fmsoft.cn/exception-list
+//
+//////////////////////////////////////////////////////////////////////////////
+/*
+** helpers.h:
+**  Helpers for test code of MiniGUI 5.0
+**
+** Copyright (C) 2020 FMSoft (http://www.fmsoft.cn).
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef _MG_TESTS_HELPERS
+    #define _MG_TESTS_HELPERS
+
+#ifdef __cplusplus
+extern "C" {
+#endif  /* __cplusplus */
+
+/* monotonic clock in nanoseconds */
+Uint64 get_curr_ns (void);
+
+/* the resident set size of this process in KB; 0 if it is unknown */
+long get_rss_kb (void);
+
+/* the heap bytes in use and got from the system; FALSE if it is unknown */
+BOOL get_heap_usage (size_t *in_use, size_t *total);
+
+/* the user and system CPU time consumed by this process in nanoseconds */
+Uint64 get_cpu_time_ns (void);
+
+/* the same for the calling thread; 0 if it is unknown */
+Uint64 get_thread_cpu_time_ns (void);
+
+/*
+ * Log-linear latency histogram: every power of two is split into
+ * LAT_HIST_SUB_BUCKETS linear buckets, so a percentile is off by
+ * less than 1/LAT_HIST_SUB_BUCKETS of its value.
+ */
+#define LAT_HIST_SUB_BITS       4
+#define LAT_HIST_SUB_BUCKETS    (1 << LAT_HIST_SUB_BITS)
+#define LAT_HIST_NR_BUCKETS     \
+    ((64 - LAT_HIST_SUB_BITS + 1) * LAT_HIST_SUB_BUCKETS)
+
+typedef struct lat_hist {
+    Uint64  counts [LAT_HIST_NR_BUCKETS];
+    Uint64  nr_samples;
+    Uint64  sum;
+    Uint64  min;
+    Uint64  max;
+} lat_hist_t;
+
+void lat_hist_init (lat_hist_t *hist);
+void lat_hist_add (lat_hist_t *hist, Uint64 ns);
+void lat_hist_merge (lat_hist_t *to, const lat_hist_t *from);
+
+/* percent is in (0, 100]; returns the upper bound of the bucket */
+Uint64 lat_hist_percentile (const lat_hist_t *hist, double percent);
+
+/* prints a line with the count, average, p50/p99/p999 and maximum in us */
+void lat_hist_print (const lat_hist_t *hist, const char *name);
+
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus */
+
+#endif  /* _MG_TESTS_HELPERS */
+
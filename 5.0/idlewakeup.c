@@ -0,0 +1,367 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//                        IMPORTANT LEGAL NOTICE
+//
+// The following open source license statement does not apply to any
+// entity in the Exception List published by FMSoft.
+//
+// For more information, please visit:
+//
+// https://www.fmsoft.cn/exception-list
+//
+//////////////////////////////////////////////////////////////////////////////
+/*
+**  Benchmark of idle message loops for MiniGUI 5.0.
+**
+**  This program runs some applications which are visually idle: a main
+**  window without any timer, a main window with a timer of 2 ticks (like
+**  the dynamic wallpaper), a main window with a timer of 100 ticks, and a
+**  main window with a virtual window in a message thread. Every scenario
+**  runs for some seconds after warming up, and the program reports the
+**  wakeups (the messages got by GetMessage), the MSG_IDLE and MSG_TIMER
+**  deliveries, the context switches and the CPU time per second.
+**
+**  With -o, the report is also written to a file as `<scenario>.<metric>
+**  <value>` lines, so that the reports of two builds can be compared
+**  with diff.
+**
+**  Usage: idlewakeup [-duration <seconds>] [-o <report file>]
+**
+**  The following APIs are covered:
+**
+**      CreateMainWindow
+**      DestroyMainWindow
+**      MainWindowCleanup
+**      CreateThreadForMessaging
+**      CreateVirtualWindow
+**      DestroyVirtualWindow
+**      VirtualWindowCleanup
+**      SetTimer
+**      KillTimer
+**      GetMessage
+**      PostQuitMessage
+**      MSG_IDLE
+**      MSG_TIMER
+**
+** Copyright (C) 2020 FMSoft (http://www.fmsoft.cn).
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include <minigui/common.h>
+#include <minigui/minigui.h>
+#include <minigui/gdi.h>
+#include <minigui/window.h>
+
+#include "helpers.h"
+
+#ifdef _MGHAVE_VIRTUAL_WINDOW
+
+#define WARMUP_SECONDS      1
+#define DEF_DURATION        10
+#define IDLE_TIMER_ID       100
+
+typedef struct idle_scenario {
+    const char *name;
+    DWORD       timer_interv;   // in ticks; 0 for no timer
+    BOOL        with_thread;    // with a virtual window in a message thread
+} idle_scenario_t;
+
+static const idle_scenario_t scenarios [] = {
+    { "main-window",        0,      FALSE },
+    { "timer-2-ticks",      2,      FALSE },
+    { "timer-100-ticks",    100,    FALSE },
+    { "message-thread",     0,      TRUE  },
+};
+
+/* the counters are written by the loop of a thread and read by the
+   stopper with atomic operations */
+typedef struct loop_counters {
+    Uint64      nr_wakeups;
+    Uint64      nr_idles;
+    Uint64      nr_timers;
+} loop_counters_t;
+
+typedef struct usage_sample {
+    Uint64      ns;
+    Uint64      user_ns;
+    Uint64      sys_ns;
+    long        nr_vcsw;
+    long        nr_ivcsw;
+    loop_counters_t counters;
+} usage_sample_t;
+
+static struct idle_info {
+    int         duration;
+    FILE       *report;
+
+    HWND        main_wnd;
+    HWND        virt_wnd;
+    loop_counters_t main_counters;
+    loop_counters_t virt_counters;
+
+    usage_sample_t start;
+    usage_sample_t end;
+} idle;
+
+static void run_idle_loop (HWND hwnd, loop_counters_t *counters)
+{
+    MSG msg;
+
+    while (GetMessage (&msg, hwnd)) {
+        __atomic_add_fetch (&counters->nr_wakeups, 1, __ATOMIC_RELAXED);
+        if (msg.message == MSG_IDLE)
+            __atomic_add_fetch (&counters->nr_idles, 1, __ATOMIC_RELAXED);
+        else if (msg.message == MSG_TIMER)
+            __atomic_add_fetch (&counters->nr_timers, 1, __ATOMIC_RELAXED);
+
+        TranslateMessage (&msg);
+        DispatchMessage (&msg);
+    }
+}
+
+static void add_counters (loop_counters_t *to, loop_counters_t *from)
+{
+    to->nr_wakeups += __atomic_load_n (&from->nr_wakeups, __ATOMIC_RELAXED);
+    to->nr_idles += __atomic_load_n (&from->nr_idles, __ATOMIC_RELAXED);
+    to->nr_timers += __atomic_load_n (&from->nr_timers, __ATOMIC_RELAXED);
+}
+
+static void take_usage_sample (usage_sample_t *sample)
+{
+    struct rusage ru;
+
+    memset (sample, 0, sizeof (usage_sample_t));
+    add_counters (&sample->counters, &idle.main_counters);
+    add_counters (&sample->counters, &idle.virt_counters);
+
+    // the CPU time of all threads including the ones of MiniGUI
+    getrusage (RUSAGE_SELF, &ru);
+    sample->ns = get_curr_ns ();
+    sample->user_ns = ru.ru_utime.tv_sec * 1000000000ULL +
+        ru.ru_utime.tv_usec * 1000ULL;
+    sample->sys_ns = ru.ru_stime.tv_sec * 1000000000ULL +
+        ru.ru_stime.tv_usec * 1000ULL;
+    sample->nr_vcsw = ru.ru_nvcsw;
+    sample->nr_ivcsw = ru.ru_nivcsw;
+}
+
+/* the stopper sleeps all the time, so it adds only two wakeups */
+static void* stopper_entry (void* arg)
+{
+    HWND virt_wnd;
+
+    sleep (WARMUP_SECONDS);
+    take_usage_sample (&idle.start);
+
+    sleep (idle.duration);
+    take_usage_sample (&idle.end);
+
+    virt_wnd = __atomic_load_n (&idle.virt_wnd, __ATOMIC_ACQUIRE);
+    if (virt_wnd != HWND_NULL && virt_wnd != HWND_INVALID)
+        PostQuitMessage (virt_wnd);
+    PostQuitMessage (idle.main_wnd);
+    return NULL;
+}
+
+static LRESULT
+IdleWinProc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
+{
+    return DefaultWindowProc (hwnd, message, wparam, lparam);
+}
+
+static void* idle_thread_entry (void* arg)
+{
+    HWND hwnd = CreateVirtualWindow (HWND_DESKTOP, IdleWinProc,
+            "An idle virtual window", 0, 0);
+
+    __atomic_store_n (&idle.virt_wnd, hwnd, __ATOMIC_RELEASE);
+    if (hwnd == HWND_INVALID)
+        return NULL;
+
+    run_idle_loop (hwnd, &idle.virt_counters);
+
+    DestroyVirtualWindow (hwnd);
+    VirtualWindowCleanup (hwnd);
+    return NULL;
+}
+
+static void print_metric (const char *scenario, const char *metric,
+        double value)
+{
+    _MG_PRINTF ("%-20s %-24s %12.2f\n", scenario, metric, value);
+    if (idle.report)
+        fprintf (idle.report, "%s.%s %.2f\n", scenario, metric, value);
+}
+
+static void report_scenario (const idle_scenario_t *scenario)
+{
+    double seconds = (idle.end.ns - idle.start.ns) / 1.0E9;
+    const loop_counters_t *start = &idle.start.counters;
+    const loop_counters_t *end = &idle.end.counters;
+
+    print_metric (scenario->name, "wakeups_per_sec",
+            (end->nr_wakeups - start->nr_wakeups) / seconds);
+    print_metric (scenario->name, "idle_msgs_per_sec",
+            (end->nr_idles - start->nr_idles) / seconds);
+    print_metric (scenario->name, "timer_msgs_per_sec",
+            (end->nr_timers - start->nr_timers) / seconds);
+    print_metric (scenario->name, "voluntary_cs_per_sec",
+            (idle.end.nr_vcsw - idle.start.nr_vcsw) / seconds);
+    print_metric (scenario->name, "involuntary_cs_per_sec",
+            (idle.end.nr_ivcsw - idle.start.nr_ivcsw) / seconds);
+    print_metric (scenario->name, "user_cpu_ms_per_sec",
+            (idle.end.user_ns - idle.start.user_ns) / 1.0E6 / seconds);
+    print_metric (scenario->name, "sys_cpu_ms_per_sec",
+            (idle.end.sys_ns - idle.start.sys_ns) / 1.0E6 / seconds);
+}
+
+static int run_scenario (const idle_scenario_t *scenario)
+{
+    MAINWINCREATE create_info;
+    pthread_t th_virt, th_stopper;
+
+    memset (&idle.main_counters, 0, sizeof (loop_counters_t));
+    memset (&idle.virt_counters, 0, sizeof (loop_counters_t));
+    idle.virt_wnd = HWND_NULL;
+
+    create_info.dwStyle = WS_VISIBLE | WS_BORDER | WS_CAPTION;
+    create_info.dwExStyle = WS_EX_NONE;
+    create_info.spCaption = scenario->name;
+    create_info.hMenu = 0;
+    create_info.hCursor = GetSystemCursor (0);
+    create_info.hIcon = 0;
+    create_info.MainWindowProc = IdleWinProc;
+    create_info.lx = 0;
+    create_info.ty = 0;
+    create_info.rx = 320;
+    create_info.by = 240;
+    create_info.iBkColor = PIXEL_lightwhite;
+    create_info.dwAddData = 0;
+    create_info.hHosting = HWND_DESKTOP;
+
+    idle.main_wnd = CreateMainWindow (&create_info);
+    if (idle.main_wnd == HWND_INVALID) {
+        _ERR_PRINTF ("FATAL ERROR: failed to create the main window\n");
+        return -1;
+    }
+
+    if (scenario->timer_interv &&
+            !SetTimer (idle.main_wnd, IDLE_TIMER_ID, scenario->timer_interv)) {
+        _ERR_PRINTF ("FATAL ERROR: failed to set the timer\n");
+        goto failed;
+    }
+
+    if (scenario->with_thread) {
+        if (CreateThreadForMessaging (&th_virt, NULL, idle_thread_entry,
+                NULL, TRUE, 16)) {
+            _ERR_PRINTF ("FATAL ERROR: failed to create message thread\n");
+            goto failed;
+        }
+
+        while (__atomic_load_n (&idle.virt_wnd, __ATOMIC_ACQUIRE) == HWND_NULL)
+            usleep (1000);
+
+        if (idle.virt_wnd == HWND_INVALID) {
+            _ERR_PRINTF ("FATAL ERROR: failed to create the virtual window\n");
+            pthread_join (th_virt, NULL);
+            goto failed;
+        }
+    }
+
+    if (pthread_create (&th_stopper, NULL, stopper_entry, NULL)) {
+        _ERR_PRINTF ("FATAL ERROR: failed to create the stopper thread\n");
+        if (scenario->with_thread) {
+            PostQuitMessage (idle.virt_wnd);
+            pthread_join (th_virt, NULL);
+        }
+        goto failed;
+    }
+
+    run_idle_loop (idle.main_wnd, &idle.main_counters);
+
+    pthread_join (th_stopper, NULL);
+    if (scenario->with_thread)
+        pthread_join (th_virt, NULL);
+
+    if (scenario->timer_interv)
+        KillTimer (idle.main_wnd, IDLE_TIMER_ID);
+    DestroyMainWindow (idle.main_wnd);
+    MainWindowCleanup (idle.main_wnd);
+
+    report_scenario (scenario);
+    return 0;
+
+failed:
+    DestroyMainWindow (idle.main_wnd);
+    MainWindowCleanup (idle.main_wnd);
+    return -1;
+}
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    const char *report_file = NULL;
+    int retval = 0;
+
+    JoinLayer (NAME_DEF_LAYER , "idlewakeup" , 0 , 0);
+
+    idle.duration = DEF_DURATION;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp (argv[i], "-duration") == 0)
+            idle.duration = atoi (argv[i + 1]);
+        else if (strcmp (argv[i], "-o") == 0)
+            report_file = argv[i + 1];
+    }
+    if (idle.duration <= 0)
+        idle.duration = DEF_DURATION;
+
+    if (report_file) {
+        idle.report = fopen (report_file, "w");
+        if (idle.report == NULL) {
+            _ERR_PRINTF ("FATAL ERROR: failed to open %s\n", report_file);
+            return -1;
+        }
+        fprintf (idle.report, "duration %d\n", idle.duration);
+    }
+
+    _MG_PRINTF ("========= START TO BENCH idle message loops: "
+            "%d seconds per scenario\n", idle.duration);
+    for (int i = 0; i < TABLESIZE (scenarios); i++) {
+        if (run_scenario (scenarios + i)) {
+            retval = -1;
+            break;
+        }
+    }
+    _MG_PRINTF ("========= END OF BENCH idle message loops\n");
+
+    if (idle.report)
+        fclose (idle.report);
+    return retval;
+}
+
+#else   /* defined _MGHAVE_VIRTUAL_WINDOW */
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    _WRN_PRINTF ("Please enable virtual window.\n");
+    return 0;
+}
+
+#endif  /* not defined _MGHAVE_VIRTUAL_WINDOW */
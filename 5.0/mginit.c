@@ -13,6 +13,22 @@
 /*
 ** mginit.c: A simple server for MiniGUI-Processes runtime mode.
 **
+**  With -launch-bench, the server launches rounds of 1, 2, 4, ... and up
+**  to 64 clients, and reports the distributions of the time from forking
+**  a client to its connection (LCO_NEW_CLIENT), to its joining the layer
+**  (JoinLayer), and to its first window shown.
+**
+**  With -zorder-bench, the server launches a zorderproc client for every
+**  z-order level, and asks a random client to run a random z-order
+**  operation, one at a time, over a local socket. The time from the start
+**  of an operation to its return in the client, and to the change of the
+**  z-order confirmed by OnZNodeOperation in the server, is reported per
+**  operation; compare it with `zorder -bench` under MiniGUI-Threads.
+**
+**  Usage: mginit [client]
+**         mginit -launch-bench <client> [max_clients]
+**         mginit -zorder-bench <nr_ops> [zorderproc]
+**
 ** Copyright (C) 2003 ~ 2020 FMSoft (http://www.fmsoft.cn).
 **
 ** Licensed under the Apache License, Version 2.0 (the "License");
@@ -34,22 +50,102 @@
 #include <unistd.h>
 #include <signal.h>
 #include <time.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include <minigui/common.h>
 #include <minigui/minigui.h>
 #include <minigui/gdi.h>
 #include <minigui/window.h>
 
+#include "helpers.h"
+#include "zorderproc.h"
+
 #ifdef _MGRM_PROCESSES
 
 static BOOL quit = FALSE;
 static int nr_clients = 0;
 
+#define MAX_LAUNCH_CLIENTS  64
+#define ROUND_TIMEOUT_NS    (10 * 1000000000ULL)
+
+typedef struct launch_record {
+    pid_t       pid;
+    Uint64      fork_ns;
+    Uint64      connect_ns;     // LCO_NEW_CLIENT
+    Uint64      join_ns;        // LCO_JOIN_CLIENT
+    Uint64      shown_ns;       // the first window shown
+} launch_record_t;
+
+enum {
+    LAUNCH_IDLE = 0,
+    LAUNCH_WAIT_SHOWN,
+    LAUNCH_WAIT_GONE,
+    LAUNCH_DONE,
+};
+
+static struct launch_bench {
+    const char *client;
+    int         max_clients;
+    int         state;
+
+    int         nr_launched;
+    int         nr_shown;
+    Uint64      round_start_ns;
+    launch_record_t records [MAX_LAUNCH_CLIENTS];
+} bench;
+
+static launch_record_t *find_launch_record (pid_t pid)
+{
+    for (int i = 0; i < bench.nr_launched; i++) {
+        if (bench.records [i].pid == pid)
+            return bench.records + i;
+    }
+
+    return NULL;
+}
+
+static void on_change_layer (int op, MG_Layer* layer, MG_Client* client)
+{
+    launch_record_t *record;
+
+    if (op == LCO_JOIN_CLIENT && client &&
+            (record = find_launch_record (client->pid)) &&
+            record->join_ns == 0) {
+        record->join_ns = get_curr_ns ();
+    }
+}
+
+static void on_znode_operation (int op, int cli, int idx_znode)
+{
+    launch_record_t *record;
+    ZNODEINFO info;
+
+    if (cli <= 0 || (record = find_launch_record (mgClients[cli].pid)) == NULL
+            || record->shown_ns)
+        return;
+
+    // a window created with WS_VISIBLE is shown when it is allocated
+    if (op == ZNOP_SHOW || (op == ZNOP_ALLOCATE &&
+                ServerGetZNodeInfo (mgClients[cli].layer, idx_znode, &info) &&
+                (info.flags & ZOF_VISIBLE))) {
+        record->shown_ns = get_curr_ns ();
+        bench.nr_shown++;
+    }
+}
+
 static void on_new_del_client (int op, int cli)
 {
     if (op == LCO_NEW_CLIENT) {
+        launch_record_t *record = find_launch_record (mgClients[cli].pid);
+
+        if (record)
+            record->connect_ns = get_curr_ns ();
+
         nr_clients ++;
         _MG_PRINTF ("A new client: %d.\n", mgClients[cli].pid);
     }
@@ -67,7 +163,8 @@ static void on_new_del_client (int op, int cli)
         _ERR_PRINTF ("Serious error: incorrect operations.\n");
 }
 
-static pid_t exec_app (const char* file_name, const char* app_name)
+static pid_t exec_app_ex (const char* file_name, const char* app_name,
+        const char* arg)
 {
     pid_t pid = 0;
 
@@ -75,7 +172,7 @@ static pid_t exec_app (const char* file_name, const char* app_name)
         _MG_PRINTF ("new child, pid: %d.\n", pid);
     }
     else if (pid == 0) {
-        execl (file_name, app_name, NULL);
+        execl (file_name, app_name, arg, NULL);
         perror ("execl");
         _exit (1);
     }
@@ -86,6 +183,410 @@ static pid_t exec_app (const char* file_name, const char* app_name)
     return pid;
 }
 
+static pid_t exec_app (const char* file_name, const char* app_name)
+{
+    return exec_app_ex (file_name, app_name, NULL);
+}
+
+static void start_launch_round (int nr_to_launch)
+{
+    memset (bench.records, 0, sizeof (bench.records));
+    bench.nr_launched = 0;
+    bench.nr_shown = 0;
+    bench.round_start_ns = get_curr_ns ();
+
+    for (int i = 0; i < nr_to_launch; i++) {
+        launch_record_t *record = bench.records + bench.nr_launched;
+
+        // vfork suspends the server until the child calls execl
+        record->fork_ns = get_curr_ns ();
+        record->pid = exec_app (bench.client, bench.client);
+        if (record->pid <= 0)
+            break;
+        bench.nr_launched++;
+    }
+
+    bench.state = LAUNCH_WAIT_SHOWN;
+}
+
+static void report_launch_round (void)
+{
+    lat_hist_t connect_hist, join_hist, shown_hist;
+
+    lat_hist_init (&connect_hist);
+    lat_hist_init (&join_hist);
+    lat_hist_init (&shown_hist);
+
+    for (int i = 0; i < bench.nr_launched; i++) {
+        launch_record_t *record = bench.records + i;
+
+        if (record->connect_ns)
+            lat_hist_add (&connect_hist, record->connect_ns - record->fork_ns);
+        if (record->join_ns)
+            lat_hist_add (&join_hist, record->join_ns - record->fork_ns);
+        if (record->shown_ns)
+            lat_hist_add (&shown_hist, record->shown_ns - record->fork_ns);
+    }
+
+    _MG_PRINTF ("========= %d clients launched, %d shown a window in %.1f ms\n",
+            bench.nr_launched, bench.nr_shown,
+            (get_curr_ns () - bench.round_start_ns) / 1.0E6);
+    lat_hist_print (&connect_hist, "fork to LCO_NEW_CLIENT");
+    lat_hist_print (&join_hist, "fork to JoinLayer");
+    lat_hist_print (&shown_hist, "fork to window shown");
+}
+
+/* called in the message loop; the callbacks above fill the records */
+static void step_launch_bench (void)
+{
+    static int nr_to_launch = 1;
+
+    switch (bench.state) {
+    case LAUNCH_IDLE:
+        start_launch_round (nr_to_launch);
+        break;
+
+    case LAUNCH_WAIT_SHOWN:
+        if (bench.nr_shown < bench.nr_launched &&
+                get_curr_ns () - bench.round_start_ns < ROUND_TIMEOUT_NS)
+            break;
+
+        report_launch_round ();
+        for (int i = 0; i < bench.nr_launched; i++)
+            kill (bench.records [i].pid, SIGTERM);
+        bench.state = LAUNCH_WAIT_GONE;
+        break;
+
+    case LAUNCH_WAIT_GONE:
+        if (nr_clients > 0)
+            break;
+
+        if (nr_to_launch >= bench.max_clients) {
+            bench.state = LAUNCH_DONE;
+            quit = TRUE;
+            break;
+        }
+
+        nr_to_launch *= 2;
+        if (nr_to_launch > bench.max_clients)
+            nr_to_launch = bench.max_clients;
+        bench.state = LAUNCH_IDLE;
+        break;
+    }
+}
+
+#define ZBENCH_TIMEOUT_NS   (10 * 1000000000ULL)
+
+enum {
+    ZBENCH_WAIT_CLIENTS = 0,
+    ZBENCH_RUNNING,
+    ZBENCH_WAIT_GONE,
+};
+
+/* the z-node operation confirming every z-order operation */
+static const int zop_znops [NR_ZPROC_OPS] = {
+    ZNOP_SHOW,
+    ZNOP_HIDE,
+    ZNOP_MOVE2TOP,
+    ZNOP_MOVEWIN,
+    ZNOP_FREE,
+    ZNOP_ALLOCATE,
+};
+
+static const char *zop_names [NR_ZPROC_OPS] = {
+    "show",
+    "hide",
+    "raise",
+    "move",
+    "destroy",
+    "create",
+};
+
+static struct zorder_bench {
+    const char *client;
+    int         nr_ops;
+    int         state;
+    BOOL        failed;
+    Uint64      deadline_ns;
+
+    int         listen_fd;
+    int         conns [NR_ZPROC_LEVELS];
+    int         nr_conns;
+    int         fds [NR_ZPROC_LEVELS];  // the connections by level
+    pid_t       pids [NR_ZPROC_LEVELS];
+    int         nr_ready;
+
+    int         current;        // the level running an operation; -1 for none
+    Uint64      confirm_ns [NR_ZPROC_OPS];
+
+    int         nr_done;
+    int         nr_failed;
+    int         nr_unconfirmed [NR_ZPROC_OPS];
+    Uint64      start_ns;
+    lat_hist_t  hist_calls [NR_ZPROC_OPS];
+    lat_hist_t  hist_confirmed [NR_ZPROC_OPS];
+} zbench;
+
+static void on_zbench_znode_operation (int op, int cli, int idx_znode)
+{
+    Uint64 now;
+
+    if (zbench.current < 0 || cli <= 0 ||
+            mgClients[cli].pid != zbench.pids [zbench.current])
+        return;
+
+    now = get_curr_ns ();
+    for (int i = 0; i < NR_ZPROC_OPS; i++) {
+        if (zop_znops [i] == op && zbench.confirm_ns [i] == 0)
+            zbench.confirm_ns [i] = now;
+    }
+}
+
+static BOOL listen_zorder_bench (void)
+{
+    struct sockaddr_un addr;
+
+    zbench.listen_fd = socket (AF_UNIX, SOCK_SEQPACKET, 0);
+    if (zbench.listen_fd < 0)
+        return FALSE;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    strcpy (addr.sun_path, ZORDER_BENCH_SOCKET);
+    unlink (ZORDER_BENCH_SOCKET);
+
+    if (bind (zbench.listen_fd, (struct sockaddr *)&addr, sizeof (addr)) ||
+            listen (zbench.listen_fd, NR_ZPROC_LEVELS)) {
+        close (zbench.listen_fd);
+        return FALSE;
+    }
+
+    fcntl (zbench.listen_fd, F_SETFL, O_NONBLOCK);
+    // wake up the message loop of the server when a client connects
+    RegisterListenFD (zbench.listen_fd, POLLIN, HWND_DESKTOP, NULL);
+    return TRUE;
+}
+
+static BOOL start_zorder_bench (void)
+{
+    char arg [16];
+
+    zbench.current = -1;
+    for (int i = 0; i < NR_ZPROC_OPS; i++) {
+        lat_hist_init (zbench.hist_calls + i);
+        lat_hist_init (zbench.hist_confirmed + i);
+    }
+
+    if (!listen_zorder_bench ()) {
+        _ERR_PRINTF ("FATAL ERROR: failed to listen on %s\n",
+                ZORDER_BENCH_SOCKET);
+        return FALSE;
+    }
+
+    for (int level = 0; level < NR_ZPROC_LEVELS; level++) {
+        snprintf (arg, sizeof (arg), "%d", level);
+        if (exec_app_ex (zbench.client, "zorderproc", arg) <= 0)
+            return FALSE;
+    }
+
+    zbench.state = ZBENCH_WAIT_CLIENTS;
+    zbench.deadline_ns = get_curr_ns () + ZBENCH_TIMEOUT_NS;
+    return TRUE;
+}
+
+static BOOL send_to_zproc (int level, int type)
+{
+    zproc_msg_t msg = { type };
+
+    return send (zbench.fds [level], &msg, sizeof (msg), MSG_NOSIGNAL) ==
+        sizeof (msg);
+}
+
+static void send_go_to_random_zproc (void)
+{
+    zbench.current = random () % NR_ZPROC_LEVELS;
+    memset (zbench.confirm_ns, 0, sizeof (zbench.confirm_ns));
+
+    if (!send_to_zproc (zbench.current, ZPROC_MSG_GO)) {
+        _ERR_PRINTF ("failed to send to the client in level %d\n",
+                zbench.current);
+        zbench.failed = TRUE;
+    }
+}
+
+static void report_zorder_bench (void)
+{
+    double seconds = (get_curr_ns () - zbench.start_ns) / 1.0E9;
+    char name [32];
+
+    _MG_PRINTF ("========= %d z-order operations in %.2f s (%.1f ops/s), "
+            "%d failed\n", zbench.nr_done, seconds,
+            zbench.nr_done / seconds, zbench.nr_failed);
+
+    for (int op = 0; op < NR_ZPROC_OPS; op++) {
+        snprintf (name, sizeof (name), "%s (call)", zop_names [op]);
+        lat_hist_print (zbench.hist_calls + op, name);
+        snprintf (name, sizeof (name), "%s (confirmed)", zop_names [op]);
+        lat_hist_print (zbench.hist_confirmed + op, name);
+        if (zbench.nr_unconfirmed [op])
+            _MG_PRINTF ("%-24s %8d\n", "not confirmed",
+                    zbench.nr_unconfirmed [op]);
+    }
+}
+
+static void stop_zorder_bench (void)
+{
+    report_zorder_bench ();
+
+    for (int level = 0; level < NR_ZPROC_LEVELS; level++) {
+        if (zbench.fds [level] > 0)
+            send_to_zproc (level, ZPROC_MSG_QUIT);
+    }
+
+    zbench.current = -1;
+    zbench.state = ZBENCH_WAIT_GONE;
+    zbench.deadline_ns = get_curr_ns () + ZBENCH_TIMEOUT_NS;
+}
+
+static void on_zproc_done (const zproc_msg_t *msg)
+{
+    int op = msg->op;
+
+    if (zbench.current < 0 || msg->level != zbench.current ||
+            op < 0 || op >= NR_ZPROC_OPS) {
+        _ERR_PRINTF ("unexpected report from the client in level %d\n",
+                msg->level);
+        zbench.failed = TRUE;
+        return;
+    }
+
+    if (msg->ok) {
+        lat_hist_add (zbench.hist_calls + op, msg->return_ns - msg->start_ns);
+        if (zbench.confirm_ns [op] >= msg->start_ns)
+            lat_hist_add (zbench.hist_confirmed + op,
+                    zbench.confirm_ns [op] - msg->start_ns);
+        else
+            zbench.nr_unconfirmed [op]++;   // e.g. raising the top window
+    }
+    else {
+        zbench.nr_failed++;
+    }
+
+    zbench.current = -1;
+    zbench.nr_done++;
+    if (zbench.nr_done < zbench.nr_ops)
+        send_go_to_random_zproc ();
+}
+
+static void on_zproc_message (int idx, const zproc_msg_t *msg)
+{
+    switch (msg->type) {
+    case ZPROC_MSG_HELLO:
+        if (msg->level < 0 || msg->level >= NR_ZPROC_LEVELS ||
+                zbench.fds [msg->level] > 0) {
+            _ERR_PRINTF ("bad hello from the client %d\n", msg->pid);
+            zbench.failed = TRUE;
+            break;
+        }
+
+        zbench.fds [msg->level] = zbench.conns [idx];
+        zbench.pids [msg->level] = msg->pid;
+        zbench.nr_ready++;
+        break;
+
+    case ZPROC_MSG_DONE:
+        on_zproc_done (msg);
+        break;
+    }
+}
+
+static void accept_zprocs (void)
+{
+    int fd;
+
+    while (zbench.nr_conns < NR_ZPROC_LEVELS &&
+            (fd = accept (zbench.listen_fd, NULL, NULL)) >= 0) {
+        zbench.conns [zbench.nr_conns++] = fd;
+        RegisterListenFD (fd, POLLIN, HWND_DESKTOP, NULL);
+    }
+}
+
+static void close_zprocs (void)
+{
+    for (int i = 0; i < zbench.nr_conns; i++) {
+        UnregisterListenFD (zbench.conns [i]);
+        close (zbench.conns [i]);
+    }
+    zbench.nr_conns = 0;
+
+    UnregisterListenFD (zbench.listen_fd);
+    close (zbench.listen_fd);
+    unlink (ZORDER_BENCH_SOCKET);
+}
+
+/* called in the message loop; the clients are polled without waiting */
+static void step_zorder_bench (void)
+{
+    struct pollfd pfds [NR_ZPROC_LEVELS];
+
+    if (zbench.state == ZBENCH_WAIT_CLIENTS)
+        accept_zprocs ();
+
+    for (int i = 0; i < zbench.nr_conns; i++) {
+        pfds [i].fd = zbench.conns [i];
+        pfds [i].events = POLLIN;
+        pfds [i].revents = 0;
+    }
+
+    if (zbench.nr_conns > 0 && poll (pfds, zbench.nr_conns, 0) > 0) {
+        for (int i = 0; i < zbench.nr_conns; i++) {
+            zproc_msg_t msg;
+
+            if (pfds [i].revents == 0)
+                continue;
+
+            if (recv (pfds [i].fd, &msg, sizeof (msg), MSG_DONTWAIT) !=
+                    sizeof (msg)) {
+                if (zbench.state != ZBENCH_WAIT_GONE) {
+                    _ERR_PRINTF ("a client of the bench left unexpectedly\n");
+                    zbench.failed = TRUE;
+                }
+                continue;
+            }
+
+            on_zproc_message (i, &msg);
+        }
+    }
+
+    switch (zbench.state) {
+    case ZBENCH_WAIT_CLIENTS:
+        if (zbench.failed || get_curr_ns () > zbench.deadline_ns) {
+            _ERR_PRINTF ("FATAL ERROR: only %d clients are ready\n",
+                    zbench.nr_ready);
+            zbench.failed = TRUE;
+            stop_zorder_bench ();
+        }
+        else if (zbench.nr_ready == NR_ZPROC_LEVELS) {
+            zbench.state = ZBENCH_RUNNING;
+            zbench.start_ns = get_curr_ns ();
+            send_go_to_random_zproc ();
+        }
+        break;
+
+    case ZBENCH_RUNNING:
+        if (zbench.failed || zbench.nr_done >= zbench.nr_ops)
+            stop_zorder_bench ();
+        break;
+
+    case ZBENCH_WAIT_GONE:
+        if (nr_clients == 0 || get_curr_ns () > zbench.deadline_ns) {
+            close_zprocs ();
+            quit = TRUE;
+        }
+        break;
+    }
+}
+
 static unsigned int old_tick_count;
 
 static pid_t pid_scrnsaver = 0;
@@ -151,6 +652,26 @@ int MiniGUIMain (int argc, const char* argv[])
 
     OnNewDelClient = on_new_del_client;
 
+    if (argc > 2 && strcmp (argv[1], "-launch-bench") == 0) {
+        bench.client = argv[2];
+        bench.max_clients = MAX_LAUNCH_CLIENTS;
+        if (argc > 3)
+            bench.max_clients = atoi (argv[3]);
+        if (bench.max_clients <= 0 || bench.max_clients > MAX_LAUNCH_CLIENTS)
+            bench.max_clients = MAX_LAUNCH_CLIENTS;
+
+        OnChangeLayer = on_change_layer;
+        OnZNodeOperation = on_znode_operation;
+    }
+    else if (argc > 2 && strcmp (argv[1], "-zorder-bench") == 0) {
+        zbench.nr_ops = atoi (argv[2]);
+        if (zbench.nr_ops <= 0)
+            zbench.nr_ops = 1000;
+        zbench.client = (argc > 3) ? argv[3] : "./zorderproc";
+
+        OnZNodeOperation = on_zbench_znode_operation;
+    }
+
     if (!ServerStartup (0 , 0 , 0)) {
         _ERR_PRINTF("Can not start the server of MiniGUI-Processes: mginit.\n");
         return 1;
@@ -158,7 +679,18 @@ int MiniGUIMain (int argc, const char* argv[])
 
     SetServerEventHook (my_event_hook);
 
-    if (argc > 1) {
+    if (bench.client) {
+        _MG_PRINTF ("========= START TO BENCH launching %s: up to %d clients\n",
+                bench.client, bench.max_clients);
+    }
+    else if (zbench.client) {
+        _MG_PRINTF ("========= START TO BENCH z-order across processes: "
+                "%d operations\n", zbench.nr_ops);
+        srandom (time (NULL));
+        if (!start_zorder_bench ())
+            return 3;
+    }
+    else if (argc > 1) {
         if (exec_app (argv[1], argv[1]) == 0)
             return 3;
     }
@@ -166,9 +698,21 @@ int MiniGUIMain (int argc, const char* argv[])
     old_tick_count = GetTickCount ();
 
     while (!quit && GetMessage (&msg, HWND_DESKTOP)) {
+        if (bench.client)
+            step_launch_bench ();
+        else if (zbench.client)
+            step_zorder_bench ();
         DispatchMessage (&msg);
     }
 
+    if (bench.client)
+        _MG_PRINTF ("========= END OF BENCH launching clients\n");
+    else if (zbench.client) {
+        _MG_PRINTF ("========= END OF BENCH z-order across processes: %s\n",
+                zbench.failed ? "FAILED" : "passed");
+        return zbench.failed ? 1 : 0;
+    }
+
     return 0;
 }
 
@@ -0,0 +1,390 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//                        IMPORTANT LEGAL NOTICE
+//
+// The following open source license statement does not apply to any
+// entity in the Exception List published by FMSoft.
+//
+// For more information, please visit:
+//
+// https://www.fmsoft.cn/exception-list
+//
+//////////////////////////////////////////////////////////////////////////////
+/*
+**  Benchmark of flooding the message queue for MiniGUI 5.0.
+**
+**  This program creates a message thread with a virtual window as the
+**  consumer, and some general POSIX threads as producers. The producers
+**  call PostMessage to the consumer as fast as possible for a while; a post
+**  failed is counted and dropped, or retried with -retry. The consumer
+**  spends -work microseconds on every message to make the queue grow.
+**
+**  The program reports the messages accepted per second, the rate of failed
+**  posts, the messages dispatched per second by the consumer, the messages
+**  out of order, the growth of the resident memory, and how long the consumer
+**  takes to drain the queue after the producers stop. It fails if any
+**  accepted message is lost or dispatched out of order.
+**
+**  Usage: msgflood [-work <us>] [-retry] [nr_producers] [duration_ms]
+**
+**  The following APIs are covered:
+**
+**      CreateThreadForMessaging
+**      CreateVirtualWindow
+**      DestroyVirtualWindow
+**      VirtualWindowCleanup
+**      PostMessage
+**      SendNotifyMessage
+**      PostQuitMessage
+**
+** Copyright (C) 2020 FMSoft (http://www.fmsoft.cn).
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include <minigui/common.h>
+#include <minigui/minigui.h>
+#include <minigui/gdi.h>
+#include <minigui/window.h>
+
+#include "helpers.h"
+
+#ifdef _MGHAVE_VIRTUAL_WINDOW
+
+#define MAX_PRODUCERS       64
+#define SAMPLE_INTERVAL_US  10000
+
+/* these messages are posted by the producers to the consumer */
+#define MSG_FLOOD           (MSG_USER + 1)
+#define MSG_FLOOD_END       (MSG_USER + 2)
+
+/* this message is sent by the main thread to the consumer */
+#define MSG_QUIT_THREAD     (MSG_USER + 11)
+
+typedef struct producer_info {
+    int         idx;
+    pthread_t   th;
+    long        nr_accepted;
+    long        nr_failed;
+    Uint64      stop_ns;
+} producer_info_t;
+
+/* the counters written by the consumer are read by the main thread
+   with atomic operations. */
+static struct flood_info {
+    int         nr_producers;
+    int         duration_ms;
+    int         work_us;
+    BOOL        retry;
+
+    HWND        consumer;
+    BOOL        go;             // set when all producers are created
+    Uint64      start_ns;
+    Uint64      end_ns;         // when the producers should stop
+
+    long        nr_dispatched;
+    long        nr_reordered;
+    int         nr_ends;
+    Uint64      drained_ns;     // when the consumer got all MSG_FLOOD_END
+
+    long        last_seq [MAX_PRODUCERS];
+    producer_info_t producers [MAX_PRODUCERS];
+} flood;
+
+static void* producer_entry (void* arg)
+{
+    producer_info_t *producer = (producer_info_t *)arg;
+    long seq = 0;
+
+    // nr_producers and end_ns are not settled until all are created
+    while (!__atomic_load_n (&flood.go, __ATOMIC_ACQUIRE))
+        sched_yield ();
+
+    while (get_curr_ns () < flood.end_ns) {
+        int ret = PostMessage (flood.consumer, MSG_FLOOD,
+                (WPARAM)producer->idx, (LPARAM)seq);
+
+        if (ret == 0) {
+            producer->nr_accepted++;
+            seq++;
+        }
+        else {
+            producer->nr_failed++;
+            if (flood.retry)
+                sched_yield ();
+            else
+                seq++;  // dropped
+        }
+    }
+
+    producer->stop_ns = get_curr_ns ();
+
+    // the end mark must be accepted; it is after all messages accepted
+    while (PostMessage (flood.consumer, MSG_FLOOD_END,
+                (WPARAM)producer->idx, 0) != 0) {
+        sched_yield ();
+    }
+
+    return NULL;
+}
+
+static void do_work (int work_us)
+{
+    Uint64 until = get_curr_ns () + work_us * 1000ULL;
+
+    while (get_curr_ns () < until)
+        ;
+}
+
+static LRESULT
+consumer_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
+{
+    switch (message) {
+    case MSG_FLOOD: {
+        int idx = (int)wparam;
+
+        // the messages from a producer must be dispatched in order
+        if ((long)lparam <= flood.last_seq [idx])
+            __atomic_add_fetch (&flood.nr_reordered, 1, __ATOMIC_RELAXED);
+        flood.last_seq [idx] = (long)lparam;
+
+        if (flood.work_us > 0)
+            do_work (flood.work_us);
+
+        __atomic_add_fetch (&flood.nr_dispatched, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    case MSG_FLOOD_END:
+        if (++flood.nr_ends == flood.nr_producers) {
+            __atomic_store_n (&flood.drained_ns, get_curr_ns (),
+                    __ATOMIC_RELEASE);
+        }
+        return 0;
+
+    case MSG_QUIT_THREAD:
+        PostQuitMessage (hwnd);
+        return 0;
+
+    default:
+        break;
+    }
+
+    return DefaultVirtualWinProc (hwnd, message, wparam, lparam);
+}
+
+static void* consumer_entry (void* arg)
+{
+    MSG msg;
+    HWND hwnd;
+
+    hwnd = CreateVirtualWindow (HWND_NULL, consumer_win_proc,
+            "consumer", 0, 0);
+    if (hwnd == HWND_INVALID) {
+        _ERR_PRINTF ("FATAL ERROR: failed to create the consumer window\n");
+        __atomic_store_n (&flood.consumer, HWND_INVALID, __ATOMIC_RELEASE);
+        return NULL;
+    }
+
+    __atomic_store_n (&flood.consumer, hwnd, __ATOMIC_RELEASE);
+
+    while (GetMessage (&msg, hwnd)) {
+        DispatchMessage (&msg);
+    }
+
+    DestroyVirtualWindow (hwnd);
+    VirtualWindowCleanup (hwnd);
+    return NULL;
+}
+
+static int report_flood (long rss_before, long rss_peak, long rss_after,
+        long backlog_at_stop)
+{
+    long nr_accepted = 0, nr_failed = 0;
+    Uint64 stop_ns = flood.start_ns;
+
+    for (int i = 0; i < flood.nr_producers; i++) {
+        nr_accepted += flood.producers [i].nr_accepted;
+        nr_failed += flood.producers [i].nr_failed;
+        if (flood.producers [i].stop_ns > stop_ns)
+            stop_ns = flood.producers [i].stop_ns;
+    }
+
+    double flood_s = (stop_ns - flood.start_ns) / 1.0E9;
+    double total_s = (flood.drained_ns - flood.start_ns) / 1.0E9;
+
+    _MG_PRINTF ("========= flood of %d producers for %d ms; "
+            "work per message: %d us; failed posts %s\n",
+            flood.nr_producers, flood.duration_ms, flood.work_us,
+            flood.retry ? "retried" : "dropped");
+    _MG_PRINTF ("%-24s %ld (%.0f msgs/s)\n", "accepted",
+            nr_accepted, nr_accepted / flood_s);
+    _MG_PRINTF ("%-24s %ld (%.2f%% of posts)\n", "failed",
+            nr_failed, nr_failed * 100.0 / (nr_accepted + nr_failed));
+    _MG_PRINTF ("%-24s %ld (%.0f msgs/s)\n", "dispatched",
+            flood.nr_dispatched, flood.nr_dispatched / total_s);
+    _MG_PRINTF ("%-24s %ld\n", "out of order", flood.nr_reordered);
+    _MG_PRINTF ("%-24s %ld messages at stop, drained in %.3f ms\n", "backlog",
+            backlog_at_stop, (flood.drained_ns - stop_ns) / 1.0E6);
+    _MG_PRINTF ("%-24s before %ld KB, peak %ld KB (+%ld KB), "
+            "after drain %ld KB\n", "resident memory",
+            rss_before, rss_peak, rss_peak - rss_before, rss_after);
+
+    if (flood.nr_dispatched != nr_accepted) {
+        _ERR_PRINTF ("%ld messages accepted but %ld dispatched\n",
+                nr_accepted, flood.nr_dispatched);
+        return -1;
+    }
+
+    if (flood.nr_reordered > 0) {
+        _ERR_PRINTF ("%ld messages dispatched out of order\n",
+                flood.nr_reordered);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int test_main_entry (void)
+{
+    pthread_t consumer_th;
+    long rss_before, rss_peak, rss_after;
+    long backlog_at_stop = -1;
+    int nr_started = 0;
+    int ret;
+
+    if (CreateThreadForMessaging (&consumer_th, NULL, consumer_entry,
+                NULL, TRUE, 16)) {
+        _ERR_PRINTF ("FATAL ERROR: failed to create the consumer thread\n");
+        return -1;
+    }
+
+    while (__atomic_load_n (&flood.consumer, __ATOMIC_ACQUIRE) == HWND_NULL)
+        usleep (1000);
+    if (flood.consumer == HWND_INVALID) {
+        pthread_join (consumer_th, NULL);
+        return -1;
+    }
+
+    rss_before = rss_peak = get_rss_kb ();
+
+    _MG_PRINTF ("========= START TO BENCH message flood\n");
+    for (int i = 0; i < flood.nr_producers; i++) {
+        producer_info_t *producer = flood.producers + i;
+
+        producer->idx = i;
+        flood.last_seq [i] = -1;
+        if (pthread_create (&producer->th, NULL, producer_entry, producer)) {
+            _ERR_PRINTF ("FAILED to create producer thread %d\n", i);
+            break;
+        }
+        nr_started++;
+    }
+
+    // the consumer waits for the end marks of the started producers only
+    flood.nr_producers = nr_started;
+    if (nr_started == 0) {
+        SendNotifyMessage (flood.consumer, MSG_QUIT_THREAD, 0, 0);
+        pthread_join (consumer_th, NULL);
+        return -1;
+    }
+
+    flood.start_ns = get_curr_ns ();
+    flood.end_ns = flood.start_ns + flood.duration_ms * 1000000ULL;
+    __atomic_store_n (&flood.go, TRUE, __ATOMIC_RELEASE);
+
+    /* sample the memory and the backlog till the queue is drained */
+    while (__atomic_load_n (&flood.drained_ns, __ATOMIC_ACQUIRE) == 0) {
+        long rss;
+
+        usleep (SAMPLE_INTERVAL_US);
+        rss = get_rss_kb ();
+        if (rss > rss_peak)
+            rss_peak = rss;
+
+        if (backlog_at_stop < 0 && get_curr_ns () >= flood.end_ns) {
+            long nr_accepted = 0;
+
+            // it is approximate; some producers may be still posting
+            for (int i = 0; i < flood.nr_producers; i++) {
+                nr_accepted += __atomic_load_n (
+                        &flood.producers [i].nr_accepted, __ATOMIC_RELAXED);
+            }
+
+            backlog_at_stop = nr_accepted -
+                __atomic_load_n (&flood.nr_dispatched, __ATOMIC_RELAXED);
+        }
+    }
+
+    for (int i = 0; i < flood.nr_producers; i++)
+        pthread_join (flood.producers [i].th, NULL);
+
+    rss_after = get_rss_kb ();
+    ret = report_flood (rss_before, rss_peak, rss_after,
+            backlog_at_stop < 0 ? 0 : backlog_at_stop);
+
+    SendNotifyMessage (flood.consumer, MSG_QUIT_THREAD, 0, 0);
+    pthread_join (consumer_th, NULL);
+    return ret;
+}
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    JoinLayer (NAME_DEF_LAYER , "msgflood" , 0 , 0);
+
+    flood.nr_producers = 4;
+    flood.duration_ms = 2000;
+
+    for (int i = 1, nr_args = 0; i < argc; i++) {
+        if (strcmp (argv[i], "-work") == 0 && i + 1 < argc) {
+            flood.work_us = atoi (argv[++i]);
+        }
+        else if (strcmp (argv[i], "-retry") == 0) {
+            flood.retry = TRUE;
+        }
+        else if (nr_args == 0) {
+            flood.nr_producers = atoi (argv[i]);
+            nr_args++;
+        }
+        else {
+            flood.duration_ms = atoi (argv[i]);
+        }
+    }
+    if (flood.nr_producers <= 0 || flood.nr_producers > MAX_PRODUCERS)
+        flood.nr_producers = 4;
+    if (flood.duration_ms <= 0)
+        flood.duration_ms = 2000;
+    if (flood.work_us < 0)
+        flood.work_us = 0;
+
+    if (test_main_entry ())
+        return -1;
+
+    return 0;
+}
+
+#else   /* defined _MGHAVE_VIRTUAL_WINDOW */
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    _WRN_PRINTF ("Please enable virtual window.\n");
+    return 0;
+}
+
+#endif  /* not defined _MGHAVE_VIRTUAL_WINDOW */
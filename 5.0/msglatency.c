@@ -0,0 +1,576 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//                        IMPORTANT LEGAL NOTICE
+//
+// The following open source license statement does not apply to any
+// entity in the Exception List published by FMSoft.
+//
+// For more information, please visit:
+//
+// https://www.fmsoft.cn/exception-list
+//
+//////////////////////////////////////////////////////////////////////////////
+/*
+**  Benchmark of cross-thread messaging for MiniGUI 5.0.
+**
+**  This program creates some pairs of message threads, each thread with
+**  a virtual window as its root window. In every pair, the pinger thread
+**  sends a message to the ponger thread and the ponger replies in the same
+**  way, one message at a time. The one-way latency is measured by the ponger
+**  when it handles a message, and the round-trip latency by the pinger when
+**  it gets the reply. Then the pinger sends a burst of messages, and the
+**  throughput is measured till the ponger handles the last one.
+**
+**  All pairs run at the same time, for SendMessage, PostMessage,
+**  NotifyWindow and SendNotifyMessage in turn. With -pin, the threads
+**  are pinned to the CPUs, and the two threads of a pair to different ones.
+**
+**  Usage: msglatency [-pin] [nr_pairs] [nr_msgs]
+**
+**  The following APIs are covered:
+**
+**      CreateThreadForMessaging
+**      CreateVirtualWindow
+**      DestroyVirtualWindow
+**      VirtualWindowCleanup
+**      SendMessage
+**      PostMessage
+**      NotifyWindow
+**      SendNotifyMessage
+**      SetNotificationCallback
+**      PostQuitMessage
+**      GetWindowAdditionalData
+**
+** Copyright (C) 2020 FMSoft (http://www.fmsoft.cn).
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include <minigui/common.h>
+#include <minigui/minigui.h>
+#include <minigui/gdi.h>
+#include <minigui/window.h>
+
+#include "helpers.h"
+
+#ifdef _MGHAVE_VIRTUAL_WINDOW
+
+enum {
+    METHOD_SEND = 0,
+    METHOD_POST,
+    METHOD_NOTIFY,
+    METHOD_SEND_NOTIFY,
+    NR_METHODS,
+};
+
+static const char *method_names [] = {
+    "SendMessage",
+    "PostMessage",
+    "NotifyWindow",
+    "SendNotifyMessage",
+};
+
+/* the codes of messages between the threads in a pair;
+   they are also used as the notification codes for NotifyWindow. */
+enum {
+    CODE_PING = 0,
+    CODE_PONG,
+    CODE_BURST,
+    CODE_BURST_DONE,
+};
+
+#define MSG_PAIR_FIRST      (MSG_USER + 1)
+
+/* these messages are sent by the main thread to a pinger or a ponger */
+#define MSG_RUN_METHOD      (MSG_USER + 11)
+#define MSG_QUIT_THREAD     (MSG_USER + 12)
+
+/* these messages are sent by a message thread to the main thread */
+#define MSG_MTH_READY       (MSG_USER + 21)
+#define MSG_MTH_QUIT        (MSG_USER + 22)
+#define MSG_METHOD_DONE     (MSG_USER + 23)
+
+typedef struct pair_info {
+    int         idx;
+    HWND        main_wnd;
+    HWND        pinger;
+    HWND        ponger;
+
+    int         method;
+    int         nr_msgs;
+    int         nr_sent;        // only accessed by the pinger
+    int         nr_received;    // only accessed by the ponger
+    int         nr_retries;     // PostMessage retried for a full queue
+    Uint64      sent_ns;
+    Uint64      burst_ns;
+
+    double      msgs_per_sec [NR_METHODS];
+    lat_hist_t  round_trip [NR_METHODS];
+    lat_hist_t  one_way [NR_METHODS];
+} pair_info_t;
+
+/* only accessed in the main thread */
+static struct bench_info {
+    pair_info_t    *pairs;
+    int             nr_pairs;
+    int             nr_msgs;
+    BOOL            pin;
+    int             nr_cpus;
+    int             nr_threads;
+    int             nr_ready;
+    int             method;
+    int             nr_done;
+} bench;
+
+static void pin_thread (int cpu)
+{
+    cpu_set_t set;
+
+    CPU_ZERO (&set);
+    CPU_SET (cpu % bench.nr_cpus, &set);
+    if (pthread_setaffinity_np (pthread_self (), sizeof (set), &set)) {
+        _WRN_PRINTF ("failed to pin thread to CPU %d\n", cpu % bench.nr_cpus);
+    }
+}
+
+static void send_by_method (pair_info_t *pair, HWND to, int code)
+{
+    UINT msg = MSG_PAIR_FIRST + code;
+
+    switch (pair->method) {
+    case METHOD_SEND:
+        SendMessage (to, msg, 0, (LPARAM)pair);
+        break;
+
+    case METHOD_POST:
+        // the post message queue of a thread has a fixed size
+        while (PostMessage (to, msg, 0, (LPARAM)pair) == ERR_QUEUE_FULL) {
+            pair->nr_retries++;
+            sched_yield ();
+        }
+        break;
+
+    case METHOD_NOTIFY:
+        NotifyWindow (to, (LINT)pair->idx, code, (DWORD)pair);
+        break;
+
+    case METHOD_SEND_NOTIFY:
+        SendNotifyMessage (to, msg, 0, (LPARAM)pair);
+        break;
+
+    default:
+        assert (0);
+        break;
+    }
+}
+
+static void report_method_done (pair_info_t *pair)
+{
+    SendMessage (pair->main_wnd, MSG_METHOD_DONE, pair->method, (LPARAM)pair);
+}
+
+static void start_burst (pair_info_t *pair)
+{
+    pair->nr_received = 0;
+    pair->burst_ns = get_curr_ns ();
+
+    for (int i = 0; i < pair->nr_msgs; i++)
+        send_by_method (pair, pair->ponger, CODE_BURST);
+
+    // SendMessage returns after the ponger handled the message
+    if (pair->method == METHOD_SEND) {
+        pair->msgs_per_sec [METHOD_SEND] = pair->nr_msgs * 1.0E9 /
+            (get_curr_ns () - pair->burst_ns);
+        report_method_done (pair);
+    }
+}
+
+static void send_next_ping (pair_info_t *pair)
+{
+    if (pair->nr_sent < pair->nr_msgs) {
+        pair->nr_sent++;
+        pair->sent_ns = get_curr_ns ();
+        send_by_method (pair, pair->ponger, CODE_PING);
+    }
+    else {
+        start_burst (pair);
+    }
+}
+
+static void run_method (pair_info_t *pair, int method)
+{
+    pair->method = method;
+    pair->nr_sent = 0;
+
+    if (method == METHOD_SEND) {
+        for (int i = 0; i < pair->nr_msgs; i++) {
+            pair->sent_ns = get_curr_ns ();
+            SendMessage (pair->ponger, MSG_PAIR_FIRST + CODE_PING,
+                    0, (LPARAM)pair);
+            lat_hist_add (pair->round_trip + METHOD_SEND,
+                    get_curr_ns () - pair->sent_ns);
+        }
+
+        start_burst (pair);
+    }
+    else {
+        // the next ping is sent when the pong arrives
+        send_next_ping (pair);
+    }
+}
+
+/* handles a message from the other thread in the pair */
+static void on_pair_message (HWND hwnd, pair_info_t *pair, int code)
+{
+    Uint64 now = get_curr_ns ();
+
+    switch (code) {
+    case CODE_PING:
+        assert (hwnd == pair->ponger);
+        lat_hist_add (pair->one_way + pair->method, now - pair->sent_ns);
+        if (pair->method != METHOD_SEND)
+            send_by_method (pair, pair->pinger, CODE_PONG);
+        break;
+
+    case CODE_PONG:
+        assert (hwnd == pair->pinger);
+        lat_hist_add (pair->round_trip + pair->method, now - pair->sent_ns);
+        send_next_ping (pair);
+        break;
+
+    case CODE_BURST:
+        assert (hwnd == pair->ponger);
+        pair->nr_received++;
+        if (pair->nr_received == pair->nr_msgs && pair->method != METHOD_SEND)
+            send_by_method (pair, pair->pinger, CODE_BURST_DONE);
+        break;
+
+    case CODE_BURST_DONE:
+        assert (hwnd == pair->pinger);
+        pair->msgs_per_sec [pair->method] = pair->nr_msgs * 1.0E9 /
+            (now - pair->burst_ns);
+        report_method_done (pair);
+        break;
+
+    default:
+        assert (0);
+        break;
+    }
+}
+
+static void pair_notif_proc (HWND hwnd, LINT id, int nc, DWORD add_data)
+{
+    on_pair_message (hwnd, (pair_info_t *)add_data, nc);
+}
+
+static LRESULT
+pair_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
+{
+    switch (message) {
+    case MSG_PAIR_FIRST + CODE_PING:
+    case MSG_PAIR_FIRST + CODE_PONG:
+    case MSG_PAIR_FIRST + CODE_BURST:
+    case MSG_PAIR_FIRST + CODE_BURST_DONE:
+        on_pair_message (hwnd, (pair_info_t *)lparam,
+                message - MSG_PAIR_FIRST);
+        return 0;
+
+    case MSG_RUN_METHOD:
+        run_method ((pair_info_t *)GetWindowAdditionalData (hwnd),
+                (int)wparam);
+        return 0;
+
+    case MSG_QUIT_THREAD:
+        PostQuitMessage (hwnd);
+        return 0;
+
+    default:
+        break;
+    }
+
+    return DefaultVirtualWinProc (hwnd, message, wparam, lparam);
+}
+
+static void run_pair_thread (pair_info_t *pair, BOOL is_pinger)
+{
+    MSG msg;
+    HWND hwnd;
+
+    // the two threads in a pair run on different CPUs
+    if (bench.pin)
+        pin_thread (pair->idx * 2 + (is_pinger ? 0 : 1));
+
+    hwnd = CreateVirtualWindow (HWND_NULL, pair_win_proc,
+            is_pinger ? "pinger" : "ponger", pair->idx, (DWORD)pair);
+    if (hwnd == HWND_INVALID) {
+        _ERR_PRINTF ("FATAL ERROR: failed to create the virtual window "
+                "for pair %d\n", pair->idx);
+        SendMessage (pair->main_wnd, MSG_MTH_QUIT, 0, (LPARAM)pair);
+        return;
+    }
+
+    SetNotificationCallback (hwnd, pair_notif_proc);
+    if (is_pinger)
+        pair->pinger = hwnd;
+    else
+        pair->ponger = hwnd;
+    SendMessage (pair->main_wnd, MSG_MTH_READY, is_pinger, (LPARAM)pair);
+
+    while (GetMessage (&msg, hwnd)) {
+        DispatchMessage (&msg);
+    }
+
+    DestroyVirtualWindow (hwnd);
+    VirtualWindowCleanup (hwnd);
+
+    SendMessage (pair->main_wnd, MSG_MTH_QUIT, 0, (LPARAM)pair);
+}
+
+static void* pinger_entry (void* arg)
+{
+    run_pair_thread ((pair_info_t *)arg, TRUE);
+    return NULL;
+}
+
+static void* ponger_entry (void* arg)
+{
+    run_pair_thread ((pair_info_t *)arg, FALSE);
+    return NULL;
+}
+
+static BOOL start_pair_thread (pair_info_t *pair, BOOL is_pinger)
+{
+    pthread_t th;
+
+    if (CreateThreadForMessaging (&th, NULL,
+                is_pinger ? pinger_entry : ponger_entry,
+                (void*)pair, FALSE, 16)) {
+        _ERR_PRINTF ("FATAL ERROR: failed to create message thread "
+                "for pair %d\n", pair->idx);
+        return FALSE;
+    }
+
+    bench.nr_threads++;
+    return TRUE;
+}
+
+static void report_method (int method)
+{
+    lat_hist_t one_way, round_trip;
+    double total = 0, min = 0, max = 0;
+    int nr_retries = 0;
+
+    lat_hist_init (&one_way);
+    lat_hist_init (&round_trip);
+
+    for (int i = 0; i < bench.nr_pairs; i++) {
+        pair_info_t *pair = bench.pairs + i;
+        double rate = pair->msgs_per_sec [method];
+
+        lat_hist_merge (&one_way, pair->one_way + method);
+        lat_hist_merge (&round_trip, pair->round_trip + method);
+
+        total += rate;
+        if (i == 0 || rate < min)
+            min = rate;
+        if (i == 0 || rate > max)
+            max = rate;
+
+        nr_retries += pair->nr_retries;
+        pair->nr_retries = 0;
+    }
+
+    _MG_PRINTF ("========= %s between %d pairs of message threads%s\n",
+            method_names [method], bench.nr_pairs,
+            bench.pin ? " (pinned)" : "");
+    lat_hist_print (&one_way, "one-way");
+    lat_hist_print (&round_trip, "round-trip");
+    _MG_PRINTF ("%-24s %.0f msgs/s in total; per pair: min %.0f, max %.0f\n",
+            "throughput", total, min, max);
+    if (nr_retries > 0)
+        _MG_PRINTF ("%-24s %d\n", "retries (queue full)", nr_retries);
+}
+
+static void run_method_in_all_pairs (int method)
+{
+    bench.method = method;
+    bench.nr_done = 0;
+
+    // all pairs run at the same time
+    for (int i = 0; i < bench.nr_pairs; i++) {
+        SendNotifyMessage (bench.pairs [i].pinger, MSG_RUN_METHOD, method, 0);
+    }
+}
+
+static void quit_all_pairs (void)
+{
+    for (int i = 0; i < bench.nr_pairs; i++) {
+        if (bench.pairs [i].pinger)
+            SendNotifyMessage (bench.pairs [i].pinger, MSG_QUIT_THREAD, 0, 0);
+        if (bench.pairs [i].ponger)
+            SendNotifyMessage (bench.pairs [i].ponger, MSG_QUIT_THREAD, 0, 0);
+    }
+}
+
+static LRESULT
+main_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
+{
+    switch (message) {
+    case MSG_MTH_READY: {
+        pair_info_t *pair = (pair_info_t *)lparam;
+
+        // the pinger is started when the ponger is ready
+        if (!wparam) {
+            if (!start_pair_thread (pair, TRUE))
+                quit_all_pairs ();
+            return 0;
+        }
+
+        bench.nr_ready++;
+        if (bench.nr_ready == bench.nr_pairs) {
+            _MG_PRINTF ("========= START TO BENCH messaging: "
+                    "%d pairs, %d messages\n",
+                    bench.nr_pairs, bench.nr_msgs);
+            run_method_in_all_pairs (METHOD_SEND);
+        }
+        return 0;
+    }
+
+    case MSG_METHOD_DONE:
+        bench.nr_done++;
+        if (bench.nr_done == bench.nr_pairs) {
+            report_method ((int)wparam);
+
+            if (bench.method + 1 < NR_METHODS)
+                run_method_in_all_pairs (bench.method + 1);
+            else
+                quit_all_pairs ();
+        }
+        return 0;
+
+    case MSG_MTH_QUIT:
+        bench.nr_threads--;
+        if (bench.nr_threads == 0)
+            PostQuitMessage (hwnd);
+        return 0;
+
+    default:
+        break;
+    }
+
+    return DefaultVirtualWinProc (hwnd, message, wparam, lparam);
+}
+
+static int test_main_entry (void)
+{
+    MSG msg;
+    HWND main_wnd;
+
+    main_wnd = CreateVirtualWindow (HWND_NULL, main_win_proc,
+            "msglatency", 0, 0);
+    if (main_wnd == HWND_INVALID) {
+        _ERR_PRINTF ("FATAL ERROR: failed to create the main virtual window\n");
+        return -1;
+    }
+
+    bench.pairs = calloc (bench.nr_pairs, sizeof (pair_info_t));
+    if (bench.pairs == NULL) {
+        _ERR_PRINTF ("FATAL ERROR: failed to allocate memory for pairs\n");
+        DestroyVirtualWindow (main_wnd);
+        VirtualWindowCleanup (main_wnd);
+        return -1;
+    }
+
+    for (int i = 0; i < bench.nr_pairs; i++) {
+        pair_info_t *pair = bench.pairs + i;
+
+        pair->idx = i;
+        pair->main_wnd = main_wnd;
+        pair->nr_msgs = bench.nr_msgs;
+        for (int method = 0; method < NR_METHODS; method++) {
+            lat_hist_init (pair->one_way + method);
+            lat_hist_init (pair->round_trip + method);
+        }
+    }
+
+    /* the pinger of a pair is started after its ponger is ready */
+    bench.nr_threads = 0;
+    bench.nr_ready = 0;
+    for (int i = 0; i < bench.nr_pairs; i++) {
+        if (!start_pair_thread (bench.pairs + i, FALSE)) {
+            quit_all_pairs ();
+            break;
+        }
+    }
+
+    // no thread to wait for if the first one failed to start
+    while (bench.nr_threads > 0 && GetMessage (&msg, main_wnd)) {
+        DispatchMessage (&msg);
+    }
+
+    DestroyVirtualWindow (main_wnd);
+    VirtualWindowCleanup (main_wnd);
+
+    free (bench.pairs);
+    bench.pairs = NULL;
+    return 0;
+}
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    JoinLayer (NAME_DEF_LAYER , "msglatency" , 0 , 0);
+
+    bench.nr_pairs = 4;
+    bench.nr_msgs = 10000;
+    bench.nr_cpus = (int)sysconf (_SC_NPROCESSORS_ONLN);
+    if (bench.nr_cpus <= 0)
+        bench.nr_cpus = 1;
+
+    for (int i = 1, nr_args = 0; i < argc; i++) {
+        if (strcmp (argv[i], "-pin") == 0) {
+            bench.pin = TRUE;
+        }
+        else if (nr_args == 0) {
+            bench.nr_pairs = atoi (argv[i]);
+            nr_args++;
+        }
+        else {
+            bench.nr_msgs = atoi (argv[i]);
+        }
+    }
+    if (bench.nr_pairs <= 0)
+        bench.nr_pairs = 4;
+    if (bench.nr_msgs <= 0)
+        bench.nr_msgs = 10000;
+
+    if (test_main_entry ())
+        return -1;
+
+    return 0;
+}
+
+#else   /* defined _MGHAVE_VIRTUAL_WINDOW */
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    _WRN_PRINTF ("Please enable virtual window.\n");
+    return 0;
+}
+
+#endif  /* not defined _MGHAVE_VIRTUAL_WINDOW */
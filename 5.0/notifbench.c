@@ -0,0 +1,395 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//                        IMPORTANT LEGAL NOTICE
+//
+// The following open source license statement does not apply to any
+// entity in the Exception List published by FMSoft.
+//
+// For more information, please visit:
+//
+// https://www.fmsoft.cn/exception-list
+//
+//////////////////////////////////////////////////////////////////////////////
+/*
+**  Benchmark of notifications for MiniGUI 5.0.
+**
+**  This program creates 1, 10, 100 and 1000 static controls in a main
+**  window, sets a notification callback for every control, and notifies
+**  the controls in turn by calling NotifyWindow:
+**
+**   - in the same thread: the main thread notifies the controls in
+**     batches, and handles the messages after every batch;
+**   - across threads: another thread notifies the controls while the
+**     main thread runs the message loop. The notifications in flight
+**     are limited, so that the queue does not grow without bound. The
+**     case fails if no notification is handled in a second.
+**
+**  The throughput and the latency from NotifyWindow to the callback are
+**  reported for every case.
+**
+**  Usage: notifbench [nr_notifs]
+**
+**  The following APIs are covered:
+**
+**      CreateMainWindow
+**      CreateWindow
+**      SetNotificationCallback
+**      NotifyWindow
+**      PeekMessage
+**      GetMessage
+**      PostQuitMessage
+**      SetTimer
+**      KillTimer
+**      MSG_NOTIFICATION
+**
+** Copyright (C) 2020 FMSoft (http://www.fmsoft.cn).
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include <minigui/common.h>
+#include <minigui/minigui.h>
+#include <minigui/gdi.h>
+#include <minigui/window.h>
+#include <minigui/control.h>
+
+#include "helpers.h"
+
+#define DEF_NR_NOTIFS       100000
+#define MAX_CONTROLS        1000
+#define NR_BATCH            256     // also the notifications in flight
+
+#define NC_BENCH            1
+#define IDC_BENCH_BASE      100
+
+/* the case across threads fails if no notification is handled in time */
+#define IDT_STALL           1
+#define STALL_CHECK_TICKS   10      // in 10 ms
+#define STALL_TIMEOUT_NS    1000000000ULL
+
+static const int nr_controls_cases [] = { 1, 10, 100, 1000 };
+
+/* the counters written by the callbacks are read by the sender
+   with atomic operations */
+static struct notif_info {
+    int         nr_notifs;
+
+    HWND        main_wnd;
+    HWND        controls [MAX_CONTROLS];
+    int         nr_controls;
+
+    BOOL        quit_when_done; // for the message loop across threads
+    BOOL        stalled;        // set when the case across threads times out
+    Uint64     *sent_ns;        // indexed by the sequence number
+    int         nr_handled;     // the good and the bad ones
+    int         nr_delivered;
+    int         nr_bad;
+    int         last_handled;   // for checking the stall
+    Uint64      last_progress_ns;
+    int         per_control [MAX_CONTROLS];
+    lat_hist_t  hist;
+} notif;
+
+static void bench_notif_proc (HWND hwnd, LINT id, int nc, DWORD add_data)
+{
+    Uint64 now = get_curr_ns ();
+    int idx = (int)id - IDC_BENCH_BASE;
+    int seq = (int)add_data;
+
+    if (nc != NC_BENCH || idx < 0 || idx >= notif.nr_controls ||
+            notif.controls [idx] != hwnd || seq < 0 || seq >= notif.nr_notifs) {
+        notif.nr_bad++;
+    }
+    else {
+        lat_hist_add (&notif.hist, now - notif.sent_ns [seq]);
+        notif.per_control [idx]++;
+        notif.nr_delivered++;
+    }
+
+    // a bad one is handled too, so that the case always finishes
+    if (__atomic_add_fetch (&notif.nr_handled, 1, __ATOMIC_RELEASE) ==
+            notif.nr_notifs && notif.quit_when_done)
+        PostQuitMessage (notif.main_wnd);
+}
+
+static void notify_control (int seq)
+{
+    int idx = seq % notif.nr_controls;
+
+    notif.sent_ns [seq] = get_curr_ns ();
+    NotifyWindow (notif.controls [idx], IDC_BENCH_BASE + idx, NC_BENCH,
+            (DWORD)seq);
+}
+
+static void handle_messages (void)
+{
+    MSG msg;
+
+    while (PeekMessage (&msg, notif.main_wnd, 0, 0, PM_REMOVE)) {
+        TranslateMessage (&msg);
+        DispatchMessage (&msg);
+    }
+}
+
+static BOOL create_controls (int nr_controls)
+{
+    for (int i = 0; i < nr_controls; i++) {
+        // invisible, so that painting the controls is not counted
+        notif.controls [i] = CreateWindow (CTRL_STATIC, "", WS_CHILD,
+                IDC_BENCH_BASE + i, 0, 0, 8, 8, notif.main_wnd, 0);
+        if (notif.controls [i] == HWND_INVALID) {
+            _ERR_PRINTF ("failed to create the control #%d\n", i);
+            notif.nr_controls = i;
+            return FALSE;
+        }
+
+        SetNotificationCallback (notif.controls [i], bench_notif_proc);
+    }
+
+    notif.nr_controls = nr_controls;
+    return TRUE;
+}
+
+static void destroy_controls (void)
+{
+    for (int i = 0; i < notif.nr_controls; i++)
+        DestroyWindow (notif.controls [i]);
+    notif.nr_controls = 0;
+}
+
+static void reset_counters (void)
+{
+    notif.stalled = FALSE;
+    notif.nr_handled = 0;
+    notif.nr_delivered = 0;
+    notif.nr_bad = 0;
+    memset (notif.per_control, 0, sizeof (notif.per_control));
+    lat_hist_init (&notif.hist);
+}
+
+static int report_case (const char *name, Uint64 elapsed_ns)
+{
+    char hist_name [32];
+    int min_per_control = notif.nr_notifs;
+    int max_per_control = 0;
+
+    for (int i = 0; i < notif.nr_controls; i++) {
+        if (notif.per_control [i] < min_per_control)
+            min_per_control = notif.per_control [i];
+        if (notif.per_control [i] > max_per_control)
+            max_per_control = notif.per_control [i];
+    }
+
+    snprintf (hist_name, sizeof (hist_name), "%s, %d controls",
+            name, notif.nr_controls);
+    lat_hist_print (&notif.hist, hist_name);
+    _MG_PRINTF ("%-24s %8.0f notifs/s, %d..%d per control\n", "",
+            notif.nr_delivered * 1.0E9 / elapsed_ns,
+            min_per_control, max_per_control);
+
+    if (notif.stalled) {
+        _ERR_PRINTF ("no notification handled in %llu ms\n",
+                STALL_TIMEOUT_NS / 1000000);
+    }
+
+    if (notif.nr_delivered != notif.nr_notifs || notif.nr_bad) {
+        _ERR_PRINTF ("%d notifications delivered, %d bad ones\n",
+                notif.nr_delivered, notif.nr_bad);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int bench_same_thread (void)
+{
+    Uint64 start_ns;
+
+    reset_counters ();
+
+    start_ns = get_curr_ns ();
+    for (int seq = 0; seq < notif.nr_notifs; seq++) {
+        notify_control (seq);
+        if ((seq + 1) % NR_BATCH == 0)
+            handle_messages ();
+    }
+    handle_messages ();
+
+    return report_case ("same thread", get_curr_ns () - start_ns);
+}
+
+#ifdef _MGHAVE_VIRTUAL_WINDOW
+static void* notifier_entry (void* arg)
+{
+    for (int seq = 0; seq < notif.nr_notifs; seq++) {
+        while (seq - __atomic_load_n (&notif.nr_handled, __ATOMIC_ACQUIRE)
+                >= NR_BATCH) {
+            // the notifications in flight never drain if one is lost
+            if (__atomic_load_n (&notif.stalled, __ATOMIC_ACQUIRE))
+                return NULL;
+            sched_yield ();
+        }
+
+        notify_control (seq);
+    }
+
+    return NULL;
+}
+
+static void check_stall (void)
+{
+    Uint64 now = get_curr_ns ();
+    int nr_handled = __atomic_load_n (&notif.nr_handled, __ATOMIC_ACQUIRE);
+
+    if (nr_handled != notif.last_handled) {
+        notif.last_handled = nr_handled;
+        notif.last_progress_ns = now;
+    }
+    else if (now - notif.last_progress_ns > STALL_TIMEOUT_NS) {
+        __atomic_store_n (&notif.stalled, TRUE, __ATOMIC_RELEASE);
+        PostQuitMessage (notif.main_wnd);
+    }
+}
+
+static int bench_cross_threads (void)
+{
+    pthread_t th;
+    Uint64 start_ns;
+    MSG msg;
+
+    reset_counters ();
+    notif.quit_when_done = TRUE;
+
+    start_ns = get_curr_ns ();
+    notif.last_handled = 0;
+    notif.last_progress_ns = start_ns;
+    SetTimer (notif.main_wnd, IDT_STALL, STALL_CHECK_TICKS);
+
+    if (pthread_create (&th, NULL, notifier_entry, NULL)) {
+        _ERR_PRINTF ("FATAL ERROR: failed to create the notifier thread\n");
+        KillTimer (notif.main_wnd, IDT_STALL);
+        notif.quit_when_done = FALSE;
+        return -1;
+    }
+
+    while (GetMessage (&msg, notif.main_wnd)) {
+        TranslateMessage (&msg);
+        DispatchMessage (&msg);
+    }
+
+    KillTimer (notif.main_wnd, IDT_STALL);
+    pthread_join (th, NULL);
+    notif.quit_when_done = FALSE;
+    return report_case ("across threads", get_curr_ns () - start_ns);
+}
+#endif  /* defined _MGHAVE_VIRTUAL_WINDOW */
+
+static LRESULT
+NotifWinProc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
+{
+#ifdef _MGHAVE_VIRTUAL_WINDOW
+    if (message == MSG_TIMER && wparam == IDT_STALL) {
+        check_stall ();
+        return 0;
+    }
+#endif
+
+    return DefaultMainWinProc (hwnd, message, wparam, lparam);
+}
+
+static int test_main_entry (void)
+{
+    MAINWINCREATE create_info;
+    int retval = 0;
+
+    create_info.dwStyle = WS_VISIBLE | WS_BORDER | WS_CAPTION;
+    create_info.dwExStyle = WS_EX_NONE;
+    create_info.spCaption = "The window of notifying controls";
+    create_info.hMenu = 0;
+    create_info.hCursor = GetSystemCursor (0);
+    create_info.hIcon = 0;
+    create_info.MainWindowProc = NotifWinProc;
+    create_info.lx = 0;
+    create_info.ty = 0;
+    create_info.rx = 320;
+    create_info.by = 240;
+    create_info.iBkColor = PIXEL_lightwhite;
+    create_info.dwAddData = 0;
+    create_info.hHosting = HWND_DESKTOP;
+
+    notif.main_wnd = CreateMainWindow (&create_info);
+    if (notif.main_wnd == HWND_INVALID) {
+        _ERR_PRINTF ("FATAL ERROR: failed to create the main window\n");
+        return -1;
+    }
+    handle_messages ();
+
+    _MG_PRINTF ("========= START TO BENCH notifications: %d per case\n",
+            notif.nr_notifs);
+
+    for (int i = 0; i < TABLESIZE (nr_controls_cases) && retval == 0; i++) {
+        if (!create_controls (nr_controls_cases [i])) {
+            retval = -1;
+        }
+        else {
+            retval = bench_same_thread ();
+#ifdef _MGHAVE_VIRTUAL_WINDOW
+            if (retval == 0)
+                retval = bench_cross_threads ();
+#endif
+        }
+
+        destroy_controls ();
+        handle_messages ();
+    }
+
+#ifndef _MGHAVE_VIRTUAL_WINDOW
+    _WRN_PRINTF ("Please enable virtual window for the cases across threads.\n");
+#endif
+
+    _MG_PRINTF ("========= END OF BENCH notifications: %s\n",
+            retval ? "FAILED" : "passed");
+
+    DestroyMainWindow (notif.main_wnd);
+    MainWindowCleanup (notif.main_wnd);
+    return retval;
+}
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    int retval;
+
+    JoinLayer (NAME_DEF_LAYER , "notifbench" , 0 , 0);
+
+    notif.nr_notifs = DEF_NR_NOTIFS;
+    if (argc > 1)
+        notif.nr_notifs = atoi (argv[1]);
+    if (notif.nr_notifs <= 0)
+        notif.nr_notifs = DEF_NR_NOTIFS;
+
+    notif.sent_ns = calloc (notif.nr_notifs, sizeof (Uint64));
+    if (notif.sent_ns == NULL) {
+        _ERR_PRINTF ("FATAL ERROR: failed to allocate memory\n");
+        return -1;
+    }
+
+    retval = test_main_entry ();
+    free (notif.sent_ns);
+    return retval;
+}
@@ -0,0 +1,375 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//                        IMPORTANT LEGAL NOTICE
+//
+// The following open source license statement does not apply to any
+// entity in the Exception List published by FMSoft.
+//
+// For more information, please visit:
+//
+// https://www.fmsoft.cn/exception-list
+//
+//////////////////////////////////////////////////////////////////////////////
+/*
+**  Benchmark of invalidating and painting for MiniGUI 5.0.
+**
+**  This program creates a main window and runs storms of InvalidateRect
+**  calls on it: random small rectangles, rectangles overlapping each other,
+**  the full window, and a mix of them. Every iteration issues a storm, then
+**  handles the messages until the message queue is empty.
+**
+**  The MSG_PAINT deliveries, the rectangles in the update regions and the
+**  pixels painted are counted, and compared with the union of the
+**  invalidated rectangles. If the regions are merged well, there are few
+**  MSG_PAINT and rectangles per iteration, and the overdraw (the pixels
+**  painted divided by the pixels of the union) is close to 1.
+**
+**  Usage: paintstorm [-erase] [nr_calls_per_storm [nr_iterations]]
+**
+**  The following APIs are covered:
+**
+**      CreateMainWindow
+**      DestroyMainWindow
+**      MainWindowCleanup
+**      InvalidateRect
+**      GetUpdateRegion
+**      BeginPaint
+**      EndPaint
+**      PeekMessage
+**      CreateClipRgn
+**      DestroyClipRgn
+**      MSG_PAINT
+**
+** Copyright (C) 2020 FMSoft (http://www.fmsoft.cn).
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <minigui/common.h>
+#include <minigui/minigui.h>
+#include <minigui/gdi.h>
+#include <minigui/window.h>
+
+#include "helpers.h"
+
+#define DEF_NR_CALLS        100
+#define DEF_NR_ITERATIONS   200
+
+enum {
+    STORM_SMALL = 0,
+    STORM_OVERLAPPED,
+    STORM_FULL,
+    STORM_MIXED,
+    NR_STORM_KINDS,
+};
+
+static const char *storm_names [] = {
+    "small",
+    "overlapped",
+    "full",
+    "mixed",
+};
+
+typedef struct storm_stat {
+    Uint64      nr_calls;
+    Uint64      nr_paints;
+    Uint64      nr_rects;
+    Uint64      requested_px;   // the sum of the invalidated rectangles
+    Uint64      union_px;       // the union of the invalidated rectangles
+    Uint64      painted_px;     // the sum of the rectangles in update regions
+    Uint64      busy_ns;
+} storm_stat_t;
+
+static struct storm_info {
+    int         nr_calls;
+    int         nr_iterations;
+    BOOL        erase;
+
+    HWND        hwnd;
+    RECT        rc_client;
+    int         width;
+    int         height;
+    /* one byte per pixel of the client area to get the union */
+    unsigned char *mask;
+
+    storm_stat_t *stat;
+} storm;
+
+static void count_update_region (HWND hwnd)
+{
+    PCLIPRGN rgn = CreateClipRgn ();
+    PCLIPRECT crc;
+
+    if (rgn == NULL)
+        return;
+
+    if (GetUpdateRegion (hwnd, rgn) != -1) {
+        for (crc = rgn->head; crc != NULL; crc = crc->next) {
+            storm.stat->nr_rects++;
+            storm.stat->painted_px += RECTW (crc->rc) * RECTH (crc->rc);
+        }
+    }
+
+    DestroyClipRgn (rgn);
+}
+
+static LRESULT
+StormWinProc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
+{
+    switch (message) {
+    case MSG_PAINT: {
+        HDC hdc;
+
+        if (storm.stat) {
+            storm.stat->nr_paints++;
+            count_update_region (hwnd);
+        }
+
+        // the DC is clipped by the update region
+        hdc = BeginPaint (hwnd);
+        SetBrushColor (hdc, (storm.stat && (storm.stat->nr_paints & 1)) ?
+                PIXEL_blue : PIXEL_lightwhite);
+        FillBox (hdc, 0, 0, storm.width, storm.height);
+        EndPaint (hwnd, hdc);
+        return 0;
+    }
+    }
+
+    return DefaultMainWinProc (hwnd, message, wparam, lparam);
+}
+
+static void random_rect (RECT *rc, int min_size, int max_size,
+        const RECT *around)
+{
+    int w = min_size + random () % (max_size - min_size + 1);
+    int h = min_size + random () % (max_size - min_size + 1);
+
+    if (around) {
+        rc->left = around->left + random () % (RECTWP (around) + 1) - w / 2;
+        rc->top = around->top + random () % (RECTHP (around) + 1) - h / 2;
+    }
+    else {
+        rc->left = random () % storm.width;
+        rc->top = random () % storm.height;
+    }
+
+    rc->right = rc->left + w;
+    rc->bottom = rc->top + h;
+}
+
+static void invalidate (const RECT *rc)
+{
+    RECT clipped;
+
+    storm.stat->nr_calls++;
+
+    if (rc == NULL) {
+        InvalidateRect (storm.hwnd, NULL, storm.erase);
+        clipped = storm.rc_client;
+    }
+    else {
+        InvalidateRect (storm.hwnd, rc, storm.erase);
+        if (!IntersectRect (&clipped, rc, &storm.rc_client))
+            return;
+    }
+
+    storm.stat->requested_px += RECTW (clipped) * RECTH (clipped);
+    for (int y = clipped.top; y < clipped.bottom; y++) {
+        memset (storm.mask + y * storm.width + clipped.left, 1,
+                RECTW (clipped));
+    }
+}
+
+static void issue_storm (int kind)
+{
+    RECT rc, around;
+
+    // the overlapped rectangles are around a random area
+    random_rect (&around, 16, 64, NULL);
+
+    for (int i = 0; i < storm.nr_calls; i++) {
+        int k = kind;
+
+        if (kind == STORM_MIXED) {
+            // the full window is rare in a real mix
+            k = (random () % 20 == 0) ? STORM_FULL : random () % 2;
+        }
+
+        switch (k) {
+        case STORM_SMALL:
+            random_rect (&rc, 4, 32, NULL);
+            invalidate (&rc);
+            break;
+
+        case STORM_OVERLAPPED:
+            random_rect (&rc, 32, 128, &around);
+            invalidate (&rc);
+            break;
+
+        case STORM_FULL:
+            invalidate (NULL);
+            break;
+        }
+    }
+}
+
+static void handle_messages (void)
+{
+    MSG msg;
+
+    while (PeekMessage (&msg, storm.hwnd, 0, 0, PM_REMOVE)) {
+        TranslateMessage (&msg);
+        DispatchMessage (&msg);
+    }
+}
+
+static void run_storms (int kind, storm_stat_t *stat)
+{
+    size_t mask_size = storm.width * storm.height;
+
+    memset (stat, 0, sizeof (storm_stat_t));
+    storm.stat = stat;
+
+    for (int i = 0; i < storm.nr_iterations; i++) {
+        Uint64 start_ns;
+
+        memset (storm.mask, 0, mask_size);
+
+        start_ns = get_curr_ns ();
+        issue_storm (kind);
+        handle_messages ();
+        stat->busy_ns += get_curr_ns () - start_ns;
+
+        for (size_t j = 0; j < mask_size; j++)
+            stat->union_px += storm.mask [j];
+    }
+
+    storm.stat = NULL;
+}
+
+static void report_storms (int kind, const storm_stat_t *stat)
+{
+    double nr_iterations = storm.nr_iterations;
+
+    _MG_PRINTF ("%-12s %10.1f %10.2f %10.2f %12.0f %12.0f %12.0f %9.2f %9.2f "
+            "%10.1f\n",
+            storm_names [kind],
+            stat->nr_calls / nr_iterations,
+            stat->nr_paints / nr_iterations,
+            stat->nr_paints ? (double)stat->nr_rects / stat->nr_paints : 0,
+            stat->requested_px / nr_iterations,
+            stat->union_px / nr_iterations,
+            stat->painted_px / nr_iterations,
+            stat->union_px ? (double)stat->painted_px / stat->union_px : 0,
+            stat->union_px ? (double)stat->requested_px / stat->union_px : 0,
+            stat->busy_ns / 1000.0 / nr_iterations);
+}
+
+static int test_main_entry (void)
+{
+    MAINWINCREATE create_info;
+    storm_stat_t stats [NR_STORM_KINDS];
+
+    create_info.dwStyle = WS_VISIBLE | WS_BORDER | WS_CAPTION;
+    create_info.dwExStyle = WS_EX_NONE;
+    create_info.spCaption = "The paint storm window";
+    create_info.hMenu = 0;
+    create_info.hCursor = GetSystemCursor (0);
+    create_info.hIcon = 0;
+    create_info.MainWindowProc = StormWinProc;
+    create_info.lx = 0;
+    create_info.ty = 0;
+    create_info.rx = 640;
+    create_info.by = 480;
+    create_info.iBkColor = PIXEL_lightwhite;
+    create_info.dwAddData = 0;
+    create_info.hHosting = HWND_DESKTOP;
+
+    storm.hwnd = CreateMainWindow (&create_info);
+    if (storm.hwnd == HWND_INVALID) {
+        _ERR_PRINTF ("FATAL ERROR: failed to create the main window\n");
+        return -1;
+    }
+
+    ShowWindow (storm.hwnd, SW_SHOWNORMAL);
+    handle_messages ();
+
+    GetClientRect (storm.hwnd, &storm.rc_client);
+    storm.width = RECTW (storm.rc_client);
+    storm.height = RECTH (storm.rc_client);
+    storm.mask = malloc (storm.width * storm.height);
+    if (storm.mask == NULL || storm.width <= 0 || storm.height <= 0) {
+        _ERR_PRINTF ("FATAL ERROR: bad client area: %d x %d\n",
+                storm.width, storm.height);
+        free (storm.mask);
+        DestroyMainWindow (storm.hwnd);
+        MainWindowCleanup (storm.hwnd);
+        return -1;
+    }
+
+    _MG_PRINTF ("========= START TO BENCH paint storms: %d calls per storm, "
+            "%d iterations, client area %d x %d, erase %s\n",
+            storm.nr_calls, storm.nr_iterations, storm.width, storm.height,
+            storm.erase ? "yes" : "no");
+
+    for (int kind = 0; kind < NR_STORM_KINDS; kind++)
+        run_storms (kind, stats + kind);
+
+    _MG_PRINTF ("Per iteration:\n");
+    _MG_PRINTF ("%-12s %10s %10s %10s %12s %12s %12s %9s %9s %10s\n",
+            "storm", "calls", "paints", "rects/pnt", "requested",
+            "union", "painted", "overdraw", "overlap", "time (us)");
+    for (int kind = 0; kind < NR_STORM_KINDS; kind++)
+        report_storms (kind, stats + kind);
+
+    _MG_PRINTF ("========= END OF BENCH paint storms\n");
+
+    free (storm.mask);
+    DestroyMainWindow (storm.hwnd);
+    MainWindowCleanup (storm.hwnd);
+    return 0;
+}
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    int i = 1;
+
+    JoinLayer (NAME_DEF_LAYER , "paintstorm" , 0 , 0);
+
+    srandom (time(NULL));
+
+    storm.nr_calls = DEF_NR_CALLS;
+    storm.nr_iterations = DEF_NR_ITERATIONS;
+
+    if (i < argc && strcmp (argv[i], "-erase") == 0) {
+        storm.erase = TRUE;
+        i++;
+    }
+
+    if (i < argc)
+        storm.nr_calls = atoi (argv[i++]);
+    if (storm.nr_calls <= 0)
+        storm.nr_calls = DEF_NR_CALLS;
+
+    if (i < argc)
+        storm.nr_iterations = atoi (argv[i++]);
+    if (storm.nr_iterations <= 0)
+        storm.nr_iterations = DEF_NR_ITERATIONS;
+
+    return test_main_entry ();
+}
@@ -16,6 +16,13 @@
 **  This test program continually sleeps and call GetTickCount, then calculate
 **  the error giving by the sleep time and the GetTickCount.
 **
+**  With -bench, this program measures the cost of GetTickCount against
+**  clock_gettime, then reads the ticks concurrently in many threads to
+**  check whether the ticks are monotonic in and across the threads.
+**
+**  Usage: tickcount [nr_loops [nr_times]]
+**         tickcount -bench [nr_threads [nr_calls]]
+**
 **  The following APIs are covered:
 **
 **      GetTickCount
@@ -37,13 +44,17 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include <minigui/common.h>
 #include <minigui/minigui.h>
 #include <minigui/gdi.h>
 #include <minigui/window.h>
 
+#include "helpers.h"
+
 #define USEC_10MS   10000UL
 
 int test_main_entry (int nr_times, int max_sleep_us)
@@ -93,6 +104,189 @@ int test_main_entry (int nr_times, int max_sleep_us)
     return max_error;
 }
 
+/*
+ * The bench mode: the cost of GetTickCount against clock_gettime, and
+ * the monotonicity of the ticks read concurrently by many threads.
+ */
+#define DEF_NR_CALLS        10000000
+#define DEF_NR_THREADS      8
+#define CONCURRENT_SECONDS  3
+
+typedef DWORD (*read_clock_func) (void);
+
+static DWORD read_tick_count (void)
+{
+    return GetTickCount ();
+}
+
+static DWORD read_monotonic (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (DWORD)ts.tv_nsec;
+}
+
+#ifdef CLOCK_MONOTONIC_COARSE
+static DWORD read_monotonic_coarse (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC_COARSE, &ts);
+    return (DWORD)ts.tv_nsec;
+}
+#endif
+
+static double bench_clock (read_clock_func read_clock, int nr_calls)
+{
+    Uint64 start_ns;
+    DWORD sum = 0;
+
+    // warm up the caches and the vDSO page
+    for (int i = 0; i < 1000; i++)
+        sum += read_clock ();
+
+    start_ns = get_curr_ns ();
+    for (int i = 0; i < nr_calls; i++)
+        sum += read_clock ();
+
+    // keep the calls from being optimized away
+    __asm__ __volatile__ ("" : : "r" (sum));
+    return (double)(get_curr_ns () - start_ns) / nr_calls;
+}
+
+static struct concurrent_info {
+    int nr_threads;
+    BOOL stop;
+    DWORD max_ticks;    // the largest ticks read by all threads so far
+} concurrent;
+
+struct reader_info {
+    pthread_t th;
+    Uint64 nr_calls;
+    Uint64 nr_backwards;    // ticks less than the last one of this thread
+    Uint64 nr_behind;       // ticks less than one read by another thread
+    DWORD max_skew;
+    Uint64 busy_ns;
+};
+
+static void* tick_reader_entry (void* arg)
+{
+    struct reader_info *reader = arg;
+    DWORD last_ticks = GetTickCount ();
+    Uint64 start_ns = get_curr_ns ();
+
+    while (!__atomic_load_n (&concurrent.stop, __ATOMIC_RELAXED)) {
+        DWORD seen = __atomic_load_n (&concurrent.max_ticks, __ATOMIC_ACQUIRE);
+        DWORD ticks = GetTickCount ();
+
+        reader->nr_calls++;
+        if (ticks < last_ticks)
+            reader->nr_backwards++;
+        last_ticks = ticks;
+
+        // the ticks were read after another thread had read `seen`
+        if (ticks < seen) {
+            reader->nr_behind++;
+            if (seen - ticks > reader->max_skew)
+                reader->max_skew = seen - ticks;
+        }
+        else if (ticks > seen) {
+            __atomic_compare_exchange_n (&concurrent.max_ticks, &seen, ticks,
+                    FALSE, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+        }
+    }
+
+    reader->busy_ns = get_curr_ns () - start_ns;
+    return NULL;
+}
+
+static int bench_concurrent_ticks (int nr_threads)
+{
+    struct reader_info *readers;
+    Uint64 start_ns, wall_ns;
+    DWORD start_ticks, elapsed_ticks;
+    Uint64 nr_calls = 0, nr_backwards = 0, nr_behind = 0, busy_ns = 0;
+    DWORD max_skew = 0;
+    int nr_created = 0;
+
+    readers = calloc (nr_threads, sizeof (struct reader_info));
+    if (readers == NULL) {
+        _ERR_PRINTF ("FATAL ERROR: failed to allocate memory\n");
+        return -1;
+    }
+
+    concurrent.stop = FALSE;
+    concurrent.max_ticks = GetTickCount ();
+
+    start_ticks = GetTickCount ();
+    start_ns = get_curr_ns ();
+    for (int i = 0; i < nr_threads; i++) {
+        if (pthread_create (&readers [i].th, NULL, tick_reader_entry,
+                readers + i)) {
+            _ERR_PRINTF ("failed to create reader thread\n");
+            break;
+        }
+        nr_created++;
+    }
+
+    sleep (CONCURRENT_SECONDS);
+    __atomic_store_n (&concurrent.stop, TRUE, __ATOMIC_RELAXED);
+
+    for (int i = 0; i < nr_created; i++) {
+        pthread_join (readers [i].th, NULL);
+
+        nr_calls += readers [i].nr_calls;
+        nr_backwards += readers [i].nr_backwards;
+        nr_behind += readers [i].nr_behind;
+        busy_ns += readers [i].busy_ns;
+        if (readers [i].max_skew > max_skew)
+            max_skew = readers [i].max_skew;
+    }
+    elapsed_ticks = GetTickCount () - start_ticks;
+    wall_ns = get_curr_ns () - start_ns;
+    free (readers);
+
+    _MG_PRINTF ("%d threads read ticks %llu times in %.2f s: %.1f ns/call\n",
+            nr_created, (unsigned long long)nr_calls, wall_ns / 1.0E9,
+            nr_calls ? (double)busy_ns / nr_calls : 0);
+    _MG_PRINTF ("ticks going backwards in a thread: %llu\n",
+            (unsigned long long)nr_backwards);
+    _MG_PRINTF ("ticks behind other threads: %llu (max skew %lu ticks)\n",
+            (unsigned long long)nr_behind, max_skew);
+    _MG_PRINTF ("ticks elapsed: %lu, expected by CLOCK_MONOTONIC: %.1f\n",
+            elapsed_ticks, wall_ns / (USEC_10MS * 1000.0));
+
+    if (nr_created < nr_threads || nr_backwards || nr_behind)
+        return -1;
+    return 0;
+}
+
+static int tick_bench_main (int nr_threads, int nr_calls)
+{
+    int retval;
+
+    _MG_PRINTF ("========= START TO BENCH the cost per call (%d calls)\n",
+            nr_calls);
+    _MG_PRINTF ("%-28s %8.2f ns\n", "GetTickCount",
+            bench_clock (read_tick_count, nr_calls));
+    _MG_PRINTF ("%-28s %8.2f ns\n", "CLOCK_MONOTONIC",
+            bench_clock (read_monotonic, nr_calls));
+#ifdef CLOCK_MONOTONIC_COARSE
+    _MG_PRINTF ("%-28s %8.2f ns\n", "CLOCK_MONOTONIC_COARSE",
+            bench_clock (read_monotonic_coarse, nr_calls));
+#endif
+
+    _MG_PRINTF ("========= START TO BENCH concurrent ticks\n");
+    retval = bench_concurrent_ticks (1);
+    if (retval == 0 && nr_threads > 1)
+        retval = bench_concurrent_ticks (nr_threads);
+
+    _MG_PRINTF ("========= END OF BENCH GetTickCount: %s\n",
+            retval ? "FAILED" : "passed");
+    return retval;
+}
+
 #define DEF_NR_LOOPS    10
 #define DEF_NR_TIMES    1000
 
@@ -106,6 +300,23 @@ int MiniGUIMain (int argc, const char* argv[])
 
     srandom (time(NULL));
 
+    if (argc > 1 && strcmp (argv[1], "-bench") == 0) {
+        int nr_threads = DEF_NR_THREADS;
+        int nr_calls = DEF_NR_CALLS;
+
+        if (argc > 2)
+            nr_threads = atoi (argv[2]);
+        if (nr_threads <= 0)
+            nr_threads = DEF_NR_THREADS;
+
+        if (argc > 3)
+            nr_calls = atoi (argv[3]);
+        if (nr_calls <= 0)
+            nr_calls = DEF_NR_CALLS;
+
+        return tick_bench_main (nr_threads, nr_calls);
+    }
+
     if (argc > 1)
         nr_loops = atoi (argv[1]);
     if (nr_loops < 0)
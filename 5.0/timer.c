@@ -18,6 +18,12 @@
 **  window will be created in every thread. The window will set up some timers
 **  by calling SetTimerEx.
 **
+**  With -stress, the program spreads thousands of timers over hundreds of
+**  virtual windows in many message threads instead, and reports the
+**  lateness of the timers and the CPU usage as the number of timers grows.
+**
+**  Usage: timer [-stress [-threads <n>] [-wins <n>] [-duration <seconds>]]
+**
 **  The following APIs are covered:
 **
 **      CreateMainWindow
@@ -59,12 +65,15 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <minigui/common.h>
 #include <minigui/minigui.h>
 #include <minigui/gdi.h>
 #include <minigui/window.h>
 
+#include "helpers.h"
+
 struct _timer_info {
     LINT id;
     DWORD interv;
@@ -432,6 +441,305 @@ static int test_timer_in_gui_thread (void)
     return 0;
 }
 
+#ifdef _MGHAVE_VIRTUAL_WINDOW
+/*
+ * The stress mode: every message thread creates some virtual windows and
+ * uses up all timer slots of the thread, half of the timers with a timer
+ * procedure and half delivering MSG_TIMER. The number of message threads
+ * grows level by level, and the lateness of every firing, the firings
+ * delivered and the CPU usage are reported for every level.
+ */
+#define NS_PER_TICK         10000000ULL
+#define MAX_STRESS_INTERV   50      // in ticks
+
+struct stress_thread;
+
+struct stress_timer {
+    struct stress_thread *owner;
+    DWORD interv;
+    BOOL by_proc;
+    Uint64 expected_ns;
+};
+
+struct stress_thread {
+    pthread_t th;
+    HWND hwnds [NR_BITS_DWORD];
+    struct stress_timer timers [NR_BITS_DWORD];
+    int nr_timers;
+    Uint64 nr_fired;
+    lat_hist_t proc_hist;
+    lat_hist_t msg_hist;
+};
+
+static struct stress_info {
+    int max_threads;
+    int nr_wins;
+    int duration;       // in seconds
+
+    int nr_threads;
+    int nr_ready;
+    int nr_failed;
+    BOOL measuring;
+    struct stress_thread *threads;
+} stress;
+
+struct stress_level {
+    int nr_threads;
+    int nr_timers;
+    double delivered;
+    double cpu_usage;
+    Uint64 proc_p99;
+    Uint64 msg_p99;
+    Uint64 max;
+};
+
+static void on_stress_timer (struct stress_timer *timer, BOOL by_proc)
+{
+    Uint64 now = get_curr_ns ();
+
+    if (__atomic_load_n (&stress.measuring, __ATOMIC_RELAXED)) {
+        Uint64 lateness = 0;
+
+        if (now > timer->expected_ns)
+            lateness = now - timer->expected_ns;
+
+        if (by_proc)
+            lat_hist_add (&timer->owner->proc_hist, lateness);
+        else
+            lat_hist_add (&timer->owner->msg_hist, lateness);
+        timer->owner->nr_fired++;
+    }
+
+    // the timer restarts counting when it is fired
+    timer->expected_ns = now + timer->interv * NS_PER_TICK;
+}
+
+static BOOL stress_timer_proc (HWND hwnd, LINT id, DWORD ticks)
+{
+    on_stress_timer ((struct stress_timer *)id, TRUE);
+    return TRUE;
+}
+
+static LRESULT
+StressWinProc (HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    if (message == MSG_TIMER) {
+        on_stress_timer ((struct stress_timer *)wParam, FALSE);
+        return 0;
+    }
+
+    return DefaultWindowProc (hWnd, message, wParam, lParam);
+}
+
+static BOOL install_stress_timers (struct stress_thread *thread)
+{
+    for (int i = 0; i < stress.nr_wins; i++) {
+        thread->hwnds [i] = CreateVirtualWindow (HWND_DESKTOP, StressWinProc,
+                "Virtual Window for timer stress", i, 0);
+        if (thread->hwnds [i] == HWND_INVALID)
+            return FALSE;
+    }
+
+    // spread all timer slots of this thread over the windows
+    for (int i = 0; i < NR_BITS_DWORD; i++) {
+        struct stress_timer *timer = thread->timers + i;
+
+        timer->owner = thread;
+        timer->interv = 1 + random () % MAX_STRESS_INTERV;
+        timer->by_proc = (i % 2) == 0;
+        timer->expected_ns = get_curr_ns () + timer->interv * NS_PER_TICK;
+
+        if (!SetTimerEx (thread->hwnds [i % stress.nr_wins], (LINT)timer,
+                timer->interv, timer->by_proc ? stress_timer_proc : NULL))
+            return FALSE;
+        thread->nr_timers++;
+    }
+
+    assert (!HaveFreeTimer ());
+    return TRUE;
+}
+
+/* all timers will be killed by DestroyVirtualWindow() */
+static void destroy_stress_windows (struct stress_thread *thread)
+{
+    for (int i = 0; i < stress.nr_wins; i++) {
+        if (thread->hwnds [i] != HWND_INVALID) {
+            DestroyVirtualWindow (thread->hwnds [i]);
+            VirtualWindowCleanup (thread->hwnds [i]);
+            thread->hwnds [i] = HWND_INVALID;
+        }
+    }
+}
+
+static void* stress_timer_entry (void* arg)
+{
+    MSG Msg;
+    struct stress_thread *thread = arg;
+
+    for (int i = 0; i < stress.nr_wins; i++)
+        thread->hwnds [i] = HWND_INVALID;
+
+    if (!install_stress_timers (thread)) {
+        // no handle is left to stop_stress_threads() after the failure
+        destroy_stress_windows (thread);
+        __atomic_add_fetch (&stress.nr_failed, 1, __ATOMIC_RELEASE);
+        return NULL;
+    }
+
+    __atomic_add_fetch (&stress.nr_ready, 1, __ATOMIC_RELEASE);
+    while (GetMessage (&Msg, thread->hwnds [0])) {
+        DispatchMessage (&Msg);
+    }
+
+    destroy_stress_windows (thread);
+    return NULL;
+}
+
+static void stop_stress_threads (int nr_threads)
+{
+    for (int i = 0; i < nr_threads; i++) {
+        if (stress.threads [i].hwnds [0] != HWND_INVALID)
+            PostQuitMessage (stress.threads [i].hwnds [0]);
+    }
+
+    for (int i = 0; i < nr_threads; i++) {
+        pthread_join (stress.threads [i].th, NULL);
+    }
+}
+
+static int run_stress_level (struct stress_level *level)
+{
+    lat_hist_t proc_hist, msg_hist;
+    Uint64 start_ns, start_cpu, wall_ns, cpu_ns;
+    Uint64 nr_fired = 0;
+    double nr_expected = 0;
+    int nr_created = 0;
+
+    memset (stress.threads, 0, sizeof (struct stress_thread) * level->nr_threads);
+    stress.nr_ready = 0;
+    stress.nr_failed = 0;
+
+    for (int i = 0; i < level->nr_threads; i++) {
+        struct stress_thread *thread = stress.threads + i;
+
+        lat_hist_init (&thread->proc_hist);
+        lat_hist_init (&thread->msg_hist);
+        if (CreateThreadForMessaging (&thread->th, NULL, stress_timer_entry,
+                thread, TRUE, 16)) {
+            _ERR_PRINTF ("FATAL ERROR: failed to create message thread\n");
+            break;
+        }
+        nr_created++;
+    }
+
+    while (__atomic_load_n (&stress.nr_ready, __ATOMIC_ACQUIRE) +
+            __atomic_load_n (&stress.nr_failed, __ATOMIC_ACQUIRE) <
+            nr_created) {
+        usleep (1000);
+    }
+
+    if (nr_created < level->nr_threads || stress.nr_failed) {
+        _ERR_PRINTF ("FATAL ERROR: failed to set up timers in %d threads\n",
+                level->nr_threads - stress.nr_ready);
+        stop_stress_threads (nr_created);
+        return -1;
+    }
+
+    start_cpu = get_cpu_time_ns ();
+    start_ns = get_curr_ns ();
+    __atomic_store_n (&stress.measuring, TRUE, __ATOMIC_RELAXED);
+
+    sleep (stress.duration);
+
+    __atomic_store_n (&stress.measuring, FALSE, __ATOMIC_RELAXED);
+    wall_ns = get_curr_ns () - start_ns;
+    cpu_ns = get_cpu_time_ns () - start_cpu;
+
+    stop_stress_threads (nr_created);
+
+    lat_hist_init (&proc_hist);
+    lat_hist_init (&msg_hist);
+    level->nr_timers = 0;
+    for (int i = 0; i < level->nr_threads; i++) {
+        struct stress_thread *thread = stress.threads + i;
+
+        lat_hist_merge (&proc_hist, &thread->proc_hist);
+        lat_hist_merge (&msg_hist, &thread->msg_hist);
+        nr_fired += thread->nr_fired;
+        level->nr_timers += thread->nr_timers;
+        for (int j = 0; j < thread->nr_timers; j++) {
+            nr_expected += (double)wall_ns /
+                (thread->timers [j].interv * NS_PER_TICK);
+        }
+    }
+
+    level->delivered = nr_expected > 0 ? nr_fired * 100.0 / nr_expected : 0;
+    level->cpu_usage = cpu_ns * 100.0 / wall_ns;
+    level->proc_p99 = lat_hist_percentile (&proc_hist, 99);
+    level->msg_p99 = lat_hist_percentile (&msg_hist, 99);
+    level->max = MAX (proc_hist.max, msg_hist.max);
+
+    _MG_PRINTF ("========= %d threads, %d windows, %d timers\n",
+            level->nr_threads, level->nr_threads * stress.nr_wins,
+            level->nr_timers);
+    lat_hist_print (&proc_hist, "lateness (timer proc)");
+    lat_hist_print (&msg_hist, "lateness (MSG_TIMER)");
+    _MG_PRINTF ("fired %llu times (%.1f%% of expected), CPU usage %.1f%%\n",
+            (unsigned long long)nr_fired, level->delivered, level->cpu_usage);
+    return 0;
+}
+
+static int timer_stress_main (void)
+{
+    struct stress_level levels [16];
+    int nr_levels = 0;
+    int nr_threads = 1;
+
+    stress.threads = calloc (stress.max_threads, sizeof (struct stress_thread));
+    if (stress.threads == NULL) {
+        _ERR_PRINTF ("FATAL ERROR: failed to allocate memory\n");
+        return -1;
+    }
+
+    _MG_PRINTF ("========= START TO STRESS timers: %d timers per thread, "
+            "%d windows per thread, %d seconds per level\n",
+            NR_BITS_DWORD, stress.nr_wins, stress.duration);
+
+    while (nr_levels < TABLESIZE (levels)) {
+        levels [nr_levels].nr_threads = nr_threads;
+        if (run_stress_level (levels + nr_levels)) {
+            free (stress.threads);
+            return -1;
+        }
+        nr_levels++;
+
+        if (nr_threads == stress.max_threads)
+            break;
+        nr_threads *= 4;
+        if (nr_threads > stress.max_threads)
+            nr_threads = stress.max_threads;
+    }
+
+    free (stress.threads);
+
+    // the cost per timer keeps flat if the timer engine scales
+    _MG_PRINTF ("========= SCALING of timers\n");
+    _MG_PRINTF ("%8s %8s %12s %12s %12s %10s %8s %12s\n",
+            "threads", "timers", "p99 proc", "p99 msg", "max (us)",
+            "fired", "CPU", "CPU/1k tmrs");
+    for (int i = 0; i < nr_levels; i++) {
+        _MG_PRINTF ("%8d %8d %12.2f %12.2f %12.2f %9.1f%% %7.1f%% %11.2f%%\n",
+                levels [i].nr_threads, levels [i].nr_timers,
+                levels [i].proc_p99 / 1000.0, levels [i].msg_p99 / 1000.0,
+                levels [i].max / 1000.0, levels [i].delivered,
+                levels [i].cpu_usage,
+                levels [i].cpu_usage * 1000 / levels [i].nr_timers);
+    }
+
+    return 0;
+}
+#endif  /* defined _MGHAVE_VIRTUAL_WINDOW */
+
 int MiniGUIMain (int argc, const char* argv[])
 {
     int retval;
@@ -440,6 +748,34 @@ int MiniGUIMain (int argc, const char* argv[])
 
     srandom (time(NULL));
 
+    if (argc > 1 && strcmp (argv[1], "-stress") == 0) {
+#ifdef _MGHAVE_VIRTUAL_WINDOW
+        stress.max_threads = 64;
+        stress.nr_wins = 4;
+        stress.duration = 5;
+
+        for (int i = 2; i + 1 < argc; i += 2) {
+            if (strcmp (argv[i], "-threads") == 0)
+                stress.max_threads = atoi (argv[i + 1]);
+            else if (strcmp (argv[i], "-wins") == 0)
+                stress.nr_wins = atoi (argv[i + 1]);
+            else if (strcmp (argv[i], "-duration") == 0)
+                stress.duration = atoi (argv[i + 1]);
+        }
+        if (stress.max_threads <= 0)
+            stress.max_threads = 64;
+        if (stress.nr_wins <= 0 || stress.nr_wins > NR_BITS_DWORD)
+            stress.nr_wins = 4;
+        if (stress.duration <= 0)
+            stress.duration = 5;
+
+        return timer_stress_main ();
+#else
+        _WRN_PRINTF ("Please enable virtual window.\n");
+        return 0;
+#endif
+    }
+
     for (int i = 0; i < 3; i++) {
         retval = test_timer_in_gui_thread ();
         if (retval)
@@ -22,6 +22,31 @@
 **  calling NotifyWindow or send a synchronous message to other windows/threads
 **  by calling SendMessage.
 **
+**  With -tree-bench, this program builds hosting trees of 10 to 10,000
+**  windows in a message thread instead, and times the full traversals in
+**  depth-first and breadth-first order, and the lookups by GetHostedById
+**  for every search method and filter. Under MiniGUI-Threads, the windows
+**  at odd depths are main windows (virtual ones when the z-order nodes
+**  run out) and the others are virtual windows; under other runtime
+**  modes, all are virtual windows.
+**
+**  With -teardown-bench, this program builds full hosting trees of depth
+**  1 to 6 in a message thread, destroys the root of every tree, and
+**  reports the time of the teardown, the cost per window, and the largest
+**  delay of the messages posted to the message thread and to another
+**  message thread during the teardown. Under MiniGUI-Threads, the windows
+**  at odd depths of the trees are main windows.
+**
+**  With -scaling-bench, this program runs the same workload of creating,
+**  travelling, notifying and destroying small hosting trees in 1, 2, 4,
+**  ... and up to 128 message threads, and reports the operations per
+**  second and the CPU usage per thread for every number of threads.
+**
+**  Usage: virtualwindow [nr_loops] [nr_threads]
+**         virtualwindow -tree-bench
+**         virtualwindow -teardown-bench [max_depth [breadth]]
+**         virtualwindow -scaling-bench [max_threads]
+**
 **  The following APIs are covered:
 **
 **      CreateThreadForMessaging
@@ -79,6 +104,8 @@
 #include <minigui/gdi.h>
 #include <minigui/window.h>
 
+#include "helpers.h"
+
 #ifdef _MGHAVE_VIRTUAL_WINDOW
 
 #define MAX_DEPTH_HOSTED        4
@@ -244,30 +271,34 @@ struct _travel_context {
     HWND hosting;
 };
 
-static HWND travel_win_tree_bfs (struct _travel_context *ctxt)
+static void print_travelled_window (HWND hwnd, int depth)
+{
+    const char* spaces = "    ";
+    const WINDOWINFO* win_info;
+
+    for (int i = 0; i < depth; i++) {
+        _MG_PRINTF ("%s", spaces);
+    }
+
+    win_info = GetWindowInfo (hwnd);
+    _MG_PRINTF ("Got a window in depth (%d): %p (%ld, %s)\n",
+            depth, hwnd, win_info->id, win_info->spCaption);
+}
+
+static HWND travel_win_tree_dfs (struct _travel_context *ctxt)
 {
     HWND hosting = ctxt->hosting;
     HWND hosted = GetFirstHosted (hosting);
 
     while (hosted) {
-        if (ctxt->print) {
-            const char* spaces = "    ";
-            const WINDOWINFO* win_info;
-
-            for (int i = 0; i < ctxt->depth; i++) {
-                _MG_PRINTF ("%s", spaces);
-            }
-
-            win_info = GetWindowInfo (hosted);
-            _MG_PRINTF ("Got a window in depth (%d): %p (%ld, %s)\n",
-                    ctxt->depth, hosted, win_info->id, win_info->spCaption);
-        }
+        if (ctxt->print)
+            print_travelled_window (hosted, ctxt->depth);
 
         ctxt->nr_wins++;
 
         ctxt->hosting = hosted;
         ctxt->depth++;
-        travel_win_tree_bfs (ctxt);
+        travel_win_tree_dfs (ctxt);
         ctxt->depth--;
 
         hosted = GetNextHosted (hosting, hosted);
@@ -276,6 +307,63 @@ static HWND travel_win_tree_bfs (struct _travel_context *ctxt)
     return NULL;
 }
 
+/* travels the tree level by level with a queue; this does not count
+   the hosting window itself */
+static HWND travel_win_tree_bfs (struct _travel_context *ctxt)
+{
+    struct _queued_window {
+        HWND hwnd;
+        int depth;
+    } *queue;
+    int head = 0, tail = 0, size = 64;
+
+    queue = malloc (sizeof (queue [0]) * size);
+    if (queue == NULL) {
+        _ERR_PRINTF ("FATAL ERROR: failed to allocate memory for queue\n");
+        return NULL;
+    }
+
+    queue [tail].hwnd = ctxt->hosting;
+    queue [tail].depth = ctxt->depth;
+    tail++;
+
+    while (head < tail) {
+        HWND hosting = queue [head].hwnd;
+        int depth = queue [head].depth;
+        HWND hosted = GetFirstHosted (hosting);
+
+        head++;
+        while (hosted) {
+            if (ctxt->print)
+                print_travelled_window (hosted, depth);
+
+            ctxt->nr_wins++;
+
+            if (tail == size) {
+                void *new_queue;
+
+                size *= 2;
+                new_queue = realloc (queue, sizeof (queue [0]) * size);
+                if (new_queue == NULL) {
+                    _ERR_PRINTF ("FATAL ERROR: failed to grow the queue\n");
+                    free (queue);
+                    return NULL;
+                }
+                queue = new_queue;
+            }
+
+            queue [tail].hwnd = hosted;
+            queue [tail].depth = depth + 1;
+            tail++;
+
+            hosted = GetNextHosted (hosting, hosted);
+        }
+    }
+
+    free (queue);
+    return NULL;
+}
+
 static void test_get_hosted_by_id (HWND root_wnd, struct test_info *info)
 {
     HWND found_main = GetHostedById (root_wnd,
@@ -330,7 +418,7 @@ static void print_hosting_tree (HWND hwnd)
         info = (struct test_info*)GetWindowAdditionalData (hwnd);
 
         struct _travel_context ctxt = { 0, 0, TRUE, root_wnd };
-        travel_win_tree_bfs (&ctxt);
+        travel_win_tree_dfs (&ctxt);
 
         test_get_hosted_by_id (root_wnd, info);
     }
@@ -467,7 +555,7 @@ test_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
                 struct _travel_context ctxt = { 0, 0, FALSE, root_wnd };
 
                 // this will not count the root window itself
-                travel_win_tree_bfs (&ctxt);
+                travel_win_tree_dfs (&ctxt);
 
                 assert (nr_wins == info->nr_thread_wins);
 
@@ -816,6 +904,790 @@ static int test_main_entry (int nr_threads)
     return 0;
 }
 
+/*
+ * The hosting trees for -tree-bench; window i is hosted by (i - 1) / B.
+ * Under MiniGUI-Threads, the windows at odd depths are main windows while
+ * the z-order nodes last, and the others are virtual windows; else all
+ * are virtual windows.
+ */
+#define TREE_BREADTH        4
+#define NR_TREE_LOOKUPS     1000
+
+static const int tree_sizes [] = { 10, 100, 1000, 10000 };
+
+static const struct {
+    DWORD search_data;
+    const char *name;
+} tree_searches [] = {
+    { WIN_SEARCH_METHOD_BFS | WIN_SEARCH_FILTER_VIRT, "BFS virt" },
+    { WIN_SEARCH_METHOD_DFS | WIN_SEARCH_FILTER_VIRT, "DFS virt" },
+    { WIN_SEARCH_METHOD_BFS | WIN_SEARCH_FILTER_MAIN, "BFS main" },
+    { WIN_SEARCH_METHOD_DFS | WIN_SEARCH_FILTER_MAIN, "DFS main" },
+    { WIN_SEARCH_METHOD_BFS | WIN_SEARCH_FILTER_VIRT | WIN_SEARCH_FILTER_MAIN,
+        "BFS virt|main" },
+    { WIN_SEARCH_METHOD_DFS | WIN_SEARCH_FILTER_VIRT | WIN_SEARCH_FILTER_MAIN,
+        "DFS virt|main" },
+};
+
+static LRESULT
+tree_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
+{
+    return DefaultWindowProc (hwnd, message, wparam, lparam);
+}
+
+static int get_tree_depth (int i)
+{
+    int depth = 0;
+
+    for (; i > 0; i = (i - 1) / TREE_BREADTH)
+        depth++;
+
+    return depth;
+}
+
+static HWND create_tree_window (HWND hosting, int i)
+{
+#ifdef _MGRM_THREADS
+    if (get_tree_depth (i) % 2) {
+        MAINWINCREATE create_info;
+        HWND hwnd;
+
+        // invisible, so that painting the windows is not counted
+        create_info.dwStyle = WS_NONE;
+        create_info.dwExStyle = WS_EX_NONE;
+        create_info.spCaption = "A Tree Main Window";
+        create_info.hMenu = 0;
+        create_info.hCursor = GetSystemCursor (0);
+        create_info.hIcon = 0;
+        create_info.MainWindowProc = tree_win_proc;
+        create_info.lx = 0;
+        create_info.ty = 0;
+        create_info.rx = 100;
+        create_info.by = 100;
+        create_info.iBkColor = PIXEL_lightwhite;
+        create_info.dwAddData = 0;
+        create_info.hHosting = hosting;
+
+        hwnd = CreateMainWindowEx2 (&create_info, i, NULL, NULL, 0, 0, 0, 0);
+        if (hwnd != HWND_INVALID)
+            return hwnd;
+
+        // the z-order nodes for main windows may run out in a large tree
+    }
+#endif
+
+    return CreateVirtualWindow (hosting, tree_win_proc, "A Tree Window", i, 0);
+}
+
+/* the hosted windows are destroyed before their hosting ones */
+static int destroy_tree_windows (HWND *wins, int nr_wins)
+{
+    int nr_errors = 0;
+
+    for (int i = nr_wins; i > 0; i--) {
+        if (IsMainWindow (wins [i])) {
+            if (DestroyMainWindow (wins [i])) {
+                MainWindowCleanup (wins [i]);
+                continue;
+            }
+        }
+        else if (DestroyVirtualWindow (wins [i])) {
+            VirtualWindowCleanup (wins [i]);
+            continue;
+        }
+
+        _ERR_PRINTF ("FATAL ERROR: failed to destroy tree window %d\n", i);
+        nr_errors++;
+    }
+
+    return nr_errors;
+}
+
+/* picks the ids of the windows matching the filter; -1 if none */
+static int pick_tree_ids (LINT *ids, const HWND *wins, int nr_wins,
+        int nr_main_wins, DWORD search_data)
+{
+    if (!((nr_main_wins > 0 && (search_data & WIN_SEARCH_FILTER_MAIN)) ||
+            (nr_main_wins < nr_wins && (search_data & WIN_SEARCH_FILTER_VIRT))))
+        return -1;
+
+    for (int i = 0; i < NR_TREE_LOOKUPS; i++) {
+        DWORD filter;
+
+        do {
+            ids [i] = 1 + random () % nr_wins;
+            filter = IsMainWindow (wins [ids [i]]) ?
+                WIN_SEARCH_FILTER_MAIN : WIN_SEARCH_FILTER_VIRT;
+        } while (!(search_data & filter));
+    }
+
+    return 0;
+}
+
+/* returns the time of the lookups in ns; *nr_errors counts wrong results */
+static Uint64 time_hosted_lookups (HWND root_wnd, const LINT *ids, int nr_ids,
+        DWORD search_data, int *nr_errors)
+{
+    Uint64 start_ns = get_curr_ns ();
+
+    for (int i = 0; i < nr_ids; i++) {
+        HWND found = GetHostedById (root_wnd, ids [i], search_data);
+
+        // the ids are picked for the filter; -2 is not an id
+        if (ids [i] >= 0) {
+            if (found == HWND_NULL || GetWindowId (found) != ids [i])
+                (*nr_errors)++;
+        }
+        else if (found != HWND_NULL) {
+            (*nr_errors)++;
+        }
+    }
+
+    return get_curr_ns () - start_ns;
+}
+
+static int bench_hosting_tree (HWND root_wnd, int nr_wins)
+{
+    HWND *wins;
+    LINT ids [NR_TREE_LOOKUPS], misses [NR_TREE_LOOKUPS];
+    int nr_main_wins = 0, nr_errors = 0;
+    Uint64 start_ns, build_ns, destroy_ns;
+
+    wins = malloc (sizeof (HWND) * (nr_wins + 1));
+    if (wins == NULL) {
+        _ERR_PRINTF ("FATAL ERROR: failed to allocate memory for windows\n");
+        return -1;
+    }
+
+    /* window i is identified by i; the root window is identified by 0 */
+    wins [0] = root_wnd;
+    start_ns = get_curr_ns ();
+    for (int i = 1; i <= nr_wins; i++) {
+        wins [i] = create_tree_window (wins [(i - 1) / TREE_BREADTH], i);
+        if (wins [i] == HWND_INVALID) {
+            _ERR_PRINTF ("FATAL ERROR: failed to create tree window %d\n", i);
+            destroy_tree_windows (wins, i - 1);
+            free (wins);
+            return -1;
+        }
+
+        if (IsMainWindow (wins [i]))
+            nr_main_wins++;
+    }
+    build_ns = get_curr_ns () - start_ns;
+
+    for (int i = 0; i < NR_TREE_LOOKUPS; i++)
+        misses [i] = -2L;
+
+    _MG_PRINTF ("========= hosting tree of %d windows, %d main ones "
+            "(breadth %d, depth %d)\n", nr_wins, nr_main_wins,
+            TREE_BREADTH, get_tree_depth (nr_wins));
+    _MG_PRINTF ("%-24s %12.3f us (%.1f ns per window)\n", "build",
+            build_ns / 1000.0, (double)build_ns / nr_wins);
+
+    for (int bfs = 0; bfs < 2; bfs++) {
+        struct _travel_context ctxt = { 0, 0, FALSE, root_wnd };
+        Uint64 travel_ns;
+
+        start_ns = get_curr_ns ();
+        if (bfs)
+            travel_win_tree_bfs (&ctxt);
+        else
+            travel_win_tree_dfs (&ctxt);
+        travel_ns = get_curr_ns () - start_ns;
+
+        if (ctxt.nr_wins != nr_wins) {
+            _ERR_PRINTF ("travelled %d windows in %s, expected %d\n",
+                    ctxt.nr_wins, bfs ? "BFS" : "DFS", nr_wins);
+            nr_errors++;
+        }
+
+        _MG_PRINTF ("%-24s %12.3f us (%.1f ns per window)\n",
+                bfs ? "travel BFS" : "travel DFS",
+                travel_ns / 1000.0, (double)travel_ns / nr_wins);
+    }
+
+    for (int i = 0; i < TABLESIZE (tree_searches); i++) {
+        DWORD search_data = tree_searches [i].search_data;
+        Uint64 hit_ns, miss_ns;
+
+        if (pick_tree_ids (ids, wins, nr_wins, nr_main_wins, search_data)) {
+            _MG_PRINTF ("%-24s skipped: no window matches the filter\n",
+                    tree_searches [i].name);
+            continue;
+        }
+
+        hit_ns = time_hosted_lookups (root_wnd, ids, NR_TREE_LOOKUPS,
+                search_data, &nr_errors);
+        miss_ns = time_hosted_lookups (root_wnd, misses, NR_TREE_LOOKUPS,
+                search_data, &nr_errors);
+
+        _MG_PRINTF ("%-24s %12.1f ns per lookup; %.1f ns per miss\n",
+                tree_searches [i].name,
+                (double)hit_ns / NR_TREE_LOOKUPS,
+                (double)miss_ns / NR_TREE_LOOKUPS);
+    }
+
+    start_ns = get_curr_ns ();
+    nr_errors += destroy_tree_windows (wins, nr_wins);
+    destroy_ns = get_curr_ns () - start_ns;
+
+    _MG_PRINTF ("%-24s %12.3f us (%.1f ns per window)\n", "destroy",
+            destroy_ns / 1000.0, (double)destroy_ns / nr_wins);
+
+    free (wins);
+
+    if (nr_errors) {
+        _ERR_PRINTF ("%d errors in hosting tree of %d windows\n",
+                nr_errors, nr_wins);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void* tree_bench_entry (void* arg)
+{
+    int *result = (int *)arg;
+    HWND root_wnd;
+
+    root_wnd = CreateVirtualWindow (HWND_NULL, tree_win_proc,
+            "The Root Window", 0, 0);
+    if (root_wnd == HWND_INVALID) {
+        _ERR_PRINTF ("FATAL ERROR: failed to create the root window\n");
+        *result = -1;
+        return NULL;
+    }
+
+#ifndef _MGRM_THREADS
+    _MG_PRINTF ("NOTE: no main window can be created in a message thread "
+            "under this runtime mode; the trees are of virtual windows\n");
+#endif
+
+    // the trees are the same in every run
+    srandom (0);
+    for (int i = 0; i < TABLESIZE (tree_sizes); i++) {
+        if (bench_hosting_tree (root_wnd, tree_sizes [i]))
+            *result = -1;
+    }
+
+    DestroyVirtualWindow (root_wnd);
+    VirtualWindowCleanup (root_wnd);
+    return NULL;
+}
+
+/* the trees are built in a message thread, in which the root window
+   is a virtual window created by this program. */
+static int tree_bench_main (void)
+{
+    pthread_t th;
+    int result = 0;
+
+    if (CreateThreadForMessaging (&th, NULL, tree_bench_entry,
+                &result, TRUE, 16)) {
+        _ERR_PRINTF ("FATAL ERROR: failed to create message thread\n");
+        return -1;
+    }
+
+    pthread_join (th, NULL);
+    return result;
+}
+
+/* the messages for -teardown-bench */
+#define MSG_TD_BUILD    (MSG_USER + 21)
+#define MSG_TD_DESTROY  (MSG_USER + 22)
+#define MSG_TD_PROBE    (MSG_USER + 23)
+
+#define TD_MAX_DEPTH            6
+#define TD_DEF_BREADTH          4
+#define TD_PROBE_INTERVAL_US    500
+#define TD_PROBE_MARGIN_US      20000
+#define TD_NR_PROBE_SLOTS       4096
+
+/* the stall of a thread is the largest delay of the probes to it */
+typedef struct td_probe_stat {
+    Uint64      max_ns;
+    lat_hist_t  hist;
+} td_probe_stat_t;
+
+static struct teardown_info {
+    int         breadth;
+
+    HWND        tree_root;
+    int         nr_wins;
+    int         nr_main_wins;
+    int         nr_destroyed;   // the MSG_DESTROY got by the tree windows
+    int         nr_main_destroyed;
+    Uint64      teardown_ns;
+
+    HWND        probe_wnds [2]; // in the teardown thread and another one
+    td_probe_stat_t probe_stats [2];
+    Uint64      probe_sent_ns [TD_NR_PROBE_SLOTS];
+    BOOL        probing;
+    BOOL        quit_prober;
+} teardown;
+
+static LRESULT
+td_tree_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
+{
+    if (message == MSG_DESTROY) {
+        teardown.nr_destroyed++;
+        if (IsMainWindow (hwnd))
+            teardown.nr_main_destroyed++;
+    }
+
+    return DefaultWindowProc (hwnd, message, wparam, lparam);
+}
+
+/*
+ * Under MiniGUI-Threads, the windows at odd levels are visible main
+ * windows while the z-order nodes last, so that the teardown removes
+ * z-order nodes too; the others are virtual windows.
+ */
+static HWND create_td_tree_window (HWND hosting, int level, LINT id)
+{
+#ifdef _MGRM_THREADS
+    if (level % 2) {
+        MAINWINCREATE create_info;
+        HWND hwnd;
+
+        create_info.dwStyle = WS_VISIBLE | WS_BORDER | WS_CAPTION;
+        create_info.dwExStyle = WS_EX_NONE;
+        create_info.spCaption = "A Tree Main Window";
+        create_info.hMenu = 0;
+        create_info.hCursor = GetSystemCursor (0);
+        create_info.hIcon = 0;
+        create_info.MainWindowProc = td_tree_win_proc;
+        create_info.lx = 0;
+        create_info.ty = 0;
+        create_info.rx = 100;
+        create_info.by = 100;
+        create_info.iBkColor = PIXEL_lightwhite;
+        create_info.dwAddData = 0;
+        create_info.hHosting = hosting;
+
+        hwnd = CreateMainWindowEx2 (&create_info, id, NULL, NULL, 0, 0, 0, 0);
+        if (hwnd != HWND_INVALID) {
+            teardown.nr_main_wins++;
+            return hwnd;
+        }
+    }
+#endif
+
+    return CreateVirtualWindow (hosting, td_tree_win_proc,
+            "A Tree Window", id, 0);
+}
+
+/* builds a full tree hosted by the root; returns the number of windows */
+static int build_teardown_tree (HWND hosting, int level, int depth)
+{
+    int nr_wins = 0;
+
+    if (level > depth)
+        return 0;
+
+    for (int i = 0; i < teardown.breadth; i++) {
+        HWND hwnd = create_td_tree_window (hosting, level,
+                teardown.nr_wins + nr_wins + 1);
+
+        if (hwnd == HWND_INVALID)
+            break;
+
+        nr_wins++;
+        nr_wins += build_teardown_tree (hwnd, level + 1, depth);
+    }
+
+    return nr_wins;
+}
+
+static LRESULT
+td_probe_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
+{
+    switch (message) {
+    case MSG_TD_PROBE: {
+        td_probe_stat_t *stat = teardown.probe_stats + (int)lparam;
+        Uint64 delay = get_curr_ns () -
+            teardown.probe_sent_ns [wparam % TD_NR_PROBE_SLOTS];
+
+        lat_hist_add (&stat->hist, delay);
+        if (delay > stat->max_ns)
+            stat->max_ns = delay;
+        return 0;
+    }
+
+    case MSG_TD_BUILD:
+        teardown.tree_root = CreateVirtualWindow (HWND_NULL, td_tree_win_proc,
+                "The Root of Tree", 0, 0);
+        if (teardown.tree_root == HWND_INVALID)
+            return -1;
+
+        teardown.nr_wins = 1;
+        teardown.nr_main_wins = 0;
+        teardown.nr_wins += build_teardown_tree (teardown.tree_root,
+                1, (int)wparam);
+        return teardown.nr_wins;
+
+    case MSG_TD_DESTROY: {
+        Uint64 start_ns = get_curr_ns ();
+
+        // the hosted main and virtual windows are torn down with the root
+        DestroyVirtualWindow (teardown.tree_root);
+        VirtualWindowCleanup (teardown.tree_root);
+        teardown.teardown_ns = get_curr_ns () - start_ns;
+        return 0;
+    }
+    }
+
+    return DefaultVirtualWinProc (hwnd, message, wparam, lparam);
+}
+
+static void* td_probe_thread_entry (void* arg)
+{
+    HWND *probe_wnd = (HWND *)arg;
+    HWND hwnd;
+    MSG msg;
+
+    hwnd = CreateVirtualWindow (HWND_NULL, td_probe_win_proc,
+            "A Probe Window", 0, 0);
+    __atomic_store_n (probe_wnd, hwnd, __ATOMIC_RELEASE);
+    if (hwnd == HWND_INVALID)
+        return NULL;
+
+    while (GetMessage (&msg, hwnd)) {
+        DispatchMessage (&msg);
+    }
+
+    DestroyVirtualWindow (hwnd);
+    VirtualWindowCleanup (hwnd);
+    return NULL;
+}
+
+/* posts probes to both probe windows while probing */
+static void* td_prober_entry (void* arg)
+{
+    Uint64 seq = 0;
+
+    while (!__atomic_load_n (&teardown.quit_prober, __ATOMIC_ACQUIRE)) {
+        if (__atomic_load_n (&teardown.probing, __ATOMIC_ACQUIRE)) {
+            teardown.probe_sent_ns [seq % TD_NR_PROBE_SLOTS] = get_curr_ns ();
+            for (int i = 0; i < 2; i++) {
+                PostMessage (teardown.probe_wnds [i], MSG_TD_PROBE,
+                        (WPARAM)seq, (LPARAM)i);
+            }
+            seq++;
+        }
+
+        usleep (TD_PROBE_INTERVAL_US);
+    }
+
+    return NULL;
+}
+
+static int bench_teardown (int depth)
+{
+    int nr_wins;
+
+    for (int i = 0; i < 2; i++) {
+        teardown.probe_stats [i].max_ns = 0;
+        lat_hist_init (&teardown.probe_stats [i].hist);
+    }
+    teardown.nr_destroyed = 0;
+    teardown.nr_main_destroyed = 0;
+
+    nr_wins = (int)SendMessage (teardown.probe_wnds [0], MSG_TD_BUILD,
+            (WPARAM)depth, 0);
+    if (nr_wins <= 0) {
+        _ERR_PRINTF ("FATAL ERROR: failed to build the tree of depth %d\n",
+                depth);
+        return -1;
+    }
+
+    __atomic_store_n (&teardown.probing, TRUE, __ATOMIC_RELEASE);
+    usleep (TD_PROBE_MARGIN_US);
+    SendMessage (teardown.probe_wnds [0], MSG_TD_DESTROY, 0, 0);
+    usleep (TD_PROBE_MARGIN_US);
+    __atomic_store_n (&teardown.probing, FALSE, __ATOMIC_RELEASE);
+
+    // wait for the probes in flight
+    usleep (TD_PROBE_MARGIN_US);
+
+    _MG_PRINTF ("%6d %9d %9d %14.3f %12.1f %14.3f %14.3f %14.3f\n",
+            depth, nr_wins, teardown.nr_main_wins,
+            teardown.teardown_ns / 1000.0,
+            (double)teardown.teardown_ns / nr_wins,
+            teardown.probe_stats [0].max_ns / 1000.0,
+            teardown.probe_stats [1].max_ns / 1000.0,
+            lat_hist_percentile (&teardown.probe_stats [1].hist, 99) / 1000.0);
+
+    if (teardown.nr_destroyed != nr_wins ||
+            teardown.nr_main_destroyed != teardown.nr_main_wins) {
+        _ERR_PRINTF ("%d windows of %d (%d main ones of %d) got MSG_DESTROY\n",
+                teardown.nr_destroyed, nr_wins,
+                teardown.nr_main_destroyed, teardown.nr_main_wins);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* the tree is built and torn down in a message thread, while a prober
+   posts messages to it and to another message thread to get the stall
+   of both threads. */
+static int teardown_bench_main (int max_depth, int breadth)
+{
+    pthread_t th_probes [2], th_prober;
+    int nr_threads = 0;
+    int result = 0;
+
+    teardown.breadth = breadth;
+
+    for (int i = 0; i < 2; i++) {
+        if (CreateThreadForMessaging (th_probes + i, NULL,
+                    td_probe_thread_entry, teardown.probe_wnds + i, TRUE, 16)) {
+            _ERR_PRINTF ("FATAL ERROR: failed to create message thread\n");
+            result = -1;
+            goto done;
+        }
+        nr_threads++;
+
+        while (__atomic_load_n (teardown.probe_wnds + i, __ATOMIC_ACQUIRE) ==
+                HWND_NULL)
+            usleep (1000);
+
+        if (teardown.probe_wnds [i] == HWND_INVALID) {
+            _ERR_PRINTF ("FATAL ERROR: failed to create the probe window\n");
+            result = -1;
+            goto done;
+        }
+    }
+
+    if (pthread_create (&th_prober, NULL, td_prober_entry, NULL)) {
+        _ERR_PRINTF ("FATAL ERROR: failed to create the prober thread\n");
+        result = -1;
+        goto done;
+    }
+
+    _MG_PRINTF ("========= START TO BENCH teardown of hosting trees: "
+            "breadth %d, probes every %d us\n", breadth, TD_PROBE_INTERVAL_US);
+#ifndef _MGRM_THREADS
+    _MG_PRINTF ("NOTE: no main window can be created in a message thread "
+            "under this runtime mode; the trees are of virtual windows\n");
+#endif
+    _MG_PRINTF ("%6s %9s %9s %14s %12s %14s %14s %14s\n", "depth", "windows",
+            "main", "teardown (us)", "ns/window", "stall (us)", "other (us)",
+            "other p99");
+
+    for (int depth = 1; depth <= max_depth; depth++) {
+        if (bench_teardown (depth)) {
+            result = -1;
+            break;
+        }
+    }
+
+    __atomic_store_n (&teardown.quit_prober, TRUE, __ATOMIC_RELEASE);
+    pthread_join (th_prober, NULL);
+
+done:
+    for (int i = 0; i < nr_threads; i++) {
+        if (teardown.probe_wnds [i] != HWND_INVALID)
+            PostQuitMessage (teardown.probe_wnds [i]);
+        pthread_join (th_probes [i], NULL);
+    }
+
+    return result;
+}
+
+/* the workload of every thread for -scaling-bench */
+#define SC_MAX_THREADS      128
+#define SC_NR_ITERATIONS    200
+#define SC_NR_HOSTED        14      // a full binary tree of depth 3
+#define SC_NR_NOTIFS        16
+#define SC_BAR_WIDTH        40
+
+#define NC_SCALING          1
+
+typedef struct scaling_thread {
+    pthread_t   th;
+    Uint64      nr_ops;
+    Uint64      cpu_ns;
+    int         nr_notified;
+    int         nr_errors;
+} scaling_thread_t;
+
+static struct scaling_info {
+    int         nr_ready;
+    BOOL        go;
+    scaling_thread_t threads [SC_MAX_THREADS];
+} scaling;
+
+static LRESULT
+scaling_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
+{
+    return DefaultVirtualWinProc (hwnd, message, wparam, lparam);
+}
+
+static void scaling_notif_proc (HWND hwnd, LINT id, int nc, DWORD add_data)
+{
+    scaling_thread_t *thread = (scaling_thread_t *)GetWindowAdditionalData (hwnd);
+
+    if (nc == NC_SCALING)
+        thread->nr_notified++;
+}
+
+/* creates, travels, notifies and destroys a small hosting tree; every
+   window created, travelled or destroyed and every notification is
+   an operation */
+static void run_scaling_iteration (scaling_thread_t *thread)
+{
+    HWND wins [SC_NR_HOSTED + 1];
+    struct _travel_context ctxt = { 0, 0, FALSE, HWND_NULL };
+    int nr_wins;
+    MSG msg;
+
+    wins [0] = CreateVirtualWindow (HWND_NULL, scaling_win_proc,
+            "A Scaling Root", 0, (DWORD)thread);
+    if (wins [0] == HWND_INVALID) {
+        thread->nr_errors++;
+        return;
+    }
+    SetNotificationCallback (wins [0], scaling_notif_proc);
+
+    for (nr_wins = 1; nr_wins <= SC_NR_HOSTED; nr_wins++) {
+        wins [nr_wins] = CreateVirtualWindow (wins [(nr_wins - 1) / 2],
+                scaling_win_proc, "A Scaling Window", nr_wins, 0);
+        if (wins [nr_wins] == HWND_INVALID) {
+            thread->nr_errors++;
+            break;
+        }
+    }
+    thread->nr_ops += nr_wins;
+
+    ctxt.hosting = wins [0];
+    travel_win_tree_dfs (&ctxt);
+    if (ctxt.nr_wins != nr_wins - 1)
+        thread->nr_errors++;
+    thread->nr_ops += ctxt.nr_wins;
+
+    thread->nr_notified = 0;
+    for (int i = 0; i < SC_NR_NOTIFS; i++)
+        NotifyWindow (wins [0], 0, NC_SCALING, 0);
+    while (PeekMessage (&msg, wins [0], 0, 0, PM_REMOVE))
+        DispatchMessage (&msg);
+    if (thread->nr_notified != SC_NR_NOTIFS)
+        thread->nr_errors++;
+    thread->nr_ops += thread->nr_notified;
+
+    for (int i = nr_wins - 1; i >= 0; i--) {
+        DestroyVirtualWindow (wins [i]);
+        VirtualWindowCleanup (wins [i]);
+    }
+    thread->nr_ops += nr_wins;
+}
+
+static void* scaling_entry (void* arg)
+{
+    scaling_thread_t *thread = (scaling_thread_t *)arg;
+    Uint64 start_cpu;
+
+    __atomic_add_fetch (&scaling.nr_ready, 1, __ATOMIC_RELEASE);
+    while (!__atomic_load_n (&scaling.go, __ATOMIC_ACQUIRE))
+        usleep (100);
+
+    start_cpu = get_thread_cpu_time_ns ();
+    for (int i = 0; i < SC_NR_ITERATIONS; i++)
+        run_scaling_iteration (thread);
+    thread->cpu_ns = get_thread_cpu_time_ns () - start_cpu;
+
+    return NULL;
+}
+
+static int run_scaling_level (int nr_threads, double *ops_per_sec)
+{
+    Uint64 start_ns, wall_ns, nr_ops = 0, cpu_ns = 0;
+    int nr_created = 0, nr_errors = 0;
+
+    memset (&scaling, 0, sizeof (scaling));
+
+    for (int i = 0; i < nr_threads; i++) {
+        if (CreateThreadForMessaging (&scaling.threads [i].th, NULL,
+                    scaling_entry, scaling.threads + i, TRUE, 16)) {
+            _ERR_PRINTF ("FATAL ERROR: failed to create message thread\n");
+            nr_errors++;
+            break;
+        }
+        nr_created++;
+    }
+
+    while (__atomic_load_n (&scaling.nr_ready, __ATOMIC_ACQUIRE) < nr_created)
+        usleep (1000);
+
+    start_ns = get_curr_ns ();
+    __atomic_store_n (&scaling.go, TRUE, __ATOMIC_RELEASE);
+    for (int i = 0; i < nr_created; i++) {
+        pthread_join (scaling.threads [i].th, NULL);
+        nr_ops += scaling.threads [i].nr_ops;
+        cpu_ns += scaling.threads [i].cpu_ns;
+        nr_errors += scaling.threads [i].nr_errors;
+    }
+    wall_ns = get_curr_ns () - start_ns;
+
+    if (nr_created == 0 || wall_ns == 0) {
+        *ops_per_sec = 0;
+        _ERR_PRINTF ("no thread run with %d threads\n", nr_threads);
+        return -1;
+    }
+
+    *ops_per_sec = nr_ops * 1.0E9 / wall_ns;
+    _MG_PRINTF ("%8d %14.0f %14.0f %12.1f%%\n", nr_created, *ops_per_sec,
+            *ops_per_sec / nr_created, cpu_ns * 100.0 / nr_created / wall_ns);
+
+    if (nr_errors) {
+        _ERR_PRINTF ("%d errors with %d threads\n", nr_errors, nr_threads);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* the same workload runs in every thread; if the window management does
+   not scale, the operations per second stop growing with the threads and
+   the CPU per thread drops as the threads wait for the lock */
+static int scaling_bench_main (int max_threads)
+{
+    double rates [16];
+    int nr_levels = 0;
+    double max_rate = 0;
+    int result = 0;
+
+    _MG_PRINTF ("========= START TO BENCH message thread scaling: "
+            "%d iterations of %d windows and %d notifications per thread\n",
+            SC_NR_ITERATIONS, SC_NR_HOSTED + 1, SC_NR_NOTIFS);
+    _MG_PRINTF ("%8s %14s %14s %13s\n", "threads", "ops/s",
+            "ops/s/thread", "CPU/thread");
+
+    for (int nr_threads = 1; nr_threads <= max_threads; nr_threads *= 2) {
+        if (run_scaling_level (nr_threads, rates + nr_levels)) {
+            result = -1;
+            break;
+        }
+
+        if (rates [nr_levels] > max_rate)
+            max_rate = rates [nr_levels];
+        nr_levels++;
+    }
+
+    for (int i = 0; i < nr_levels && max_rate > 0; i++) {
+        char bar [SC_BAR_WIDTH + 1];
+        int len = (int)(rates [i] * SC_BAR_WIDTH / max_rate);
+
+        memset (bar, '#', len);
+        bar [len] = '\0';
+        _MG_PRINTF ("%8d |%s\n", 1 << i, bar);
+    }
+
+    return result;
+}
+
 int MiniGUIMain (int argc, const char* argv[])
 {
     int nr_loops = 10;
@@ -823,6 +1695,37 @@ int MiniGUIMain (int argc, const char* argv[])
 
     JoinLayer (NAME_DEF_LAYER , "virtual window" , 0 , 0);
 
+    if (argc > 1 && strcmp (argv[1], "-tree-bench") == 0)
+        return tree_bench_main ();
+
+    if (argc > 1 && strcmp (argv[1], "-teardown-bench") == 0) {
+        int max_depth = TD_MAX_DEPTH;
+        int breadth = TD_DEF_BREADTH;
+
+        if (argc > 2)
+            max_depth = atoi (argv[2]);
+        if (max_depth <= 0)
+            max_depth = TD_MAX_DEPTH;
+
+        if (argc > 3)
+            breadth = atoi (argv[3]);
+        if (breadth <= 0)
+            breadth = TD_DEF_BREADTH;
+
+        return teardown_bench_main (max_depth, breadth);
+    }
+
+    if (argc > 1 && strcmp (argv[1], "-scaling-bench") == 0) {
+        int max_threads = SC_MAX_THREADS;
+
+        if (argc > 2)
+            max_threads = atoi (argv[2]);
+        if (max_threads <= 0 || max_threads > SC_MAX_THREADS)
+            max_threads = SC_MAX_THREADS;
+
+        return scaling_bench_main (max_threads);
+    }
+
     srandom (time(NULL));
 
     if (argc > 1)
@@ -0,0 +1,376 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//                        IMPORTANT LEGAL NOTICE
+//
+// The following open source license statement does not apply to any
+// entity in the Exception List published by FMSoft.
+//
+// For more information, please visit:
+//
+// https://www.fmsoft.cn/exception-list
+//
+//////////////////////////////////////////////////////////////////////////////
+/*
+**  Benchmark of creating and destroying windows for MiniGUI 5.0.
+**
+**  This program keeps a pool of live windows hosted by a main window, and
+**  runs millions of cycles on it; every cycle destroys a random window in
+**  the pool and creates a new one, so that the lifetimes of the windows
+**  interleave like the popups of a real UI. The cycles run for virtual
+**  windows first, then for main windows.
+**
+**  The cycles per second, the resident memory and the heap usage are
+**  sampled 20 times in every run. After two samples for warming up,
+**  if the resident memory or the heap in use grows in almost all samples
+**  and the growth exceeds a threshold, the program reports a leak and fails.
+**
+**  Usage: windowchurn [-live <n>] [-visible] [nr_cycles]
+**
+**  The following APIs are covered:
+**
+**      CreateMainWindow
+**      DestroyMainWindow
+**      MainWindowCleanup
+**      CreateVirtualWindow
+**      DestroyVirtualWindow
+**      VirtualWindowCleanup
+**      DefaultMainWinProc
+**      DefaultVirtualWinProc
+**      PeekMessage
+**
+** Copyright (C) 2020 FMSoft (http://www.fmsoft.cn).
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <minigui/common.h>
+#include <minigui/minigui.h>
+#include <minigui/gdi.h>
+#include <minigui/window.h>
+
+#include "helpers.h"
+
+#ifdef _MGHAVE_VIRTUAL_WINDOW
+
+#define NR_SAMPLES          20
+#define NR_WARMUP_SAMPLES   2
+
+/* the growth over which a steady growth is taken as a leak */
+#define LEAK_THRESHOLD_RSS_KB       1024
+#define LEAK_THRESHOLD_HEAP_BYTES   (256 * 1024)
+
+enum {
+    CHURN_VIRTUAL = 0,
+    CHURN_MAIN,
+    NR_CHURN_KINDS,
+};
+
+static const char *churn_names [] = {
+    "virtual",
+    "main",
+};
+
+static struct churn_info {
+    int         nr_cycles;
+    int         nr_live;
+    BOOL        visible;
+    HWND        host;
+    HWND       *live;
+} churn;
+
+typedef struct churn_sample {
+    long        rss_kb;
+    size_t      heap_in_use;
+    size_t      heap_total;
+} churn_sample_t;
+
+static LRESULT
+churn_virt_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
+{
+    return DefaultVirtualWinProc (hwnd, message, wparam, lparam);
+}
+
+static LRESULT
+churn_main_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
+{
+    return DefaultMainWinProc (hwnd, message, wparam, lparam);
+}
+
+static HWND create_churn_window (int kind, int serial)
+{
+    MAINWINCREATE create_info;
+
+    if (kind == CHURN_VIRTUAL) {
+        return CreateVirtualWindow (churn.host, churn_virt_win_proc,
+                "A churn window", serial, 0);
+    }
+
+    create_info.dwStyle = churn.visible ? WS_VISIBLE : WS_NONE;
+    create_info.dwExStyle = WS_EX_NONE;
+    create_info.spCaption = "A churn window";
+    create_info.hMenu = 0;
+    create_info.hCursor = GetSystemCursor (0);
+    create_info.hIcon = 0;
+    create_info.MainWindowProc = churn_main_win_proc;
+    create_info.lx = random () % 200;
+    create_info.ty = random () % 200;
+    create_info.rx = create_info.lx + 50 + random () % 100;
+    create_info.by = create_info.ty + 50 + random () % 100;
+    create_info.iBkColor = PIXEL_lightwhite;
+    create_info.dwAddData = 0;
+    create_info.hHosting = churn.host;
+
+    return CreateMainWindow (&create_info);
+}
+
+static void destroy_churn_window (int kind, HWND hwnd)
+{
+    if (kind == CHURN_VIRTUAL) {
+        DestroyVirtualWindow (hwnd);
+        VirtualWindowCleanup (hwnd);
+    }
+    else {
+        DestroyMainWindow (hwnd);
+        MainWindowCleanup (hwnd);
+    }
+}
+
+/* the messages like MSG_PAINT would pile up without a message loop */
+static void pump_messages (void)
+{
+    MSG msg;
+
+    while (PeekMessage (&msg, churn.host, 0, 0, PM_REMOVE)) {
+        TranslateMessage (&msg);
+        DispatchMessage (&msg);
+    }
+}
+
+static void take_sample (churn_sample_t *sample)
+{
+    sample->rss_kb = get_rss_kb ();
+    if (!get_heap_usage (&sample->heap_in_use, &sample->heap_total)) {
+        sample->heap_in_use = 0;
+        sample->heap_total = 0;
+    }
+}
+
+/* returns TRUE if the values grow in almost all samples after warming up */
+static BOOL is_growing_steadily (const double *values, int nr_values,
+        double threshold)
+{
+    int nr_increases = 0;
+    int nr_intervals = nr_values - NR_WARMUP_SAMPLES - 1;
+
+    if (nr_intervals < 3)
+        return FALSE;
+
+    for (int i = NR_WARMUP_SAMPLES + 1; i < nr_values; i++) {
+        if (values [i] > values [i - 1])
+            nr_increases++;
+    }
+
+    return nr_increases * 10 >= nr_intervals * 9 &&
+        values [nr_values - 1] - values [NR_WARMUP_SAMPLES] > threshold;
+}
+
+static int run_churn (int kind)
+{
+    churn_sample_t samples [NR_SAMPLES];
+    double rss [NR_SAMPLES], heap [NR_SAMPLES];
+    int interval = churn.nr_cycles / NR_SAMPLES;
+    int nr_samples = 0;
+    int nr_errors = 0;
+    Uint64 start_ns;
+
+    if (interval == 0)
+        interval = 1;
+
+    for (int i = 0; i < churn.nr_live; i++) {
+        churn.live [i] = create_churn_window (kind, i);
+        if (churn.live [i] == HWND_INVALID) {
+            _ERR_PRINTF ("FATAL ERROR: failed to create a %s window\n",
+                    churn_names [kind]);
+            for (int j = 0; j < i; j++)
+                destroy_churn_window (kind, churn.live [j]);
+            return -1;
+        }
+    }
+    pump_messages ();
+
+    _MG_PRINTF ("========= START TO BENCH %s window churn: "
+            "%d cycles, %d live windows\n",
+            churn_names [kind], churn.nr_cycles, churn.nr_live);
+    _MG_PRINTF ("%12s %12s %12s %14s %14s %8s\n", "cycles", "cycles/s",
+            "RSS (KB)", "heap used(KB)", "heap total(KB)", "frag");
+
+    start_ns = get_curr_ns ();
+    for (int cycle = 1; cycle <= churn.nr_cycles; cycle++) {
+        int k = random () % churn.nr_live;
+
+        destroy_churn_window (kind, churn.live [k]);
+        churn.live [k] = create_churn_window (kind, churn.nr_live + cycle);
+        if (churn.live [k] == HWND_INVALID) {
+            _ERR_PRINTF ("failed to create a %s window in cycle %d\n",
+                    churn_names [kind], cycle);
+            // the slot is skipped when destroying the pool
+            churn.live [k] = HWND_NULL;
+            nr_errors++;
+            break;
+        }
+
+        if (cycle % interval == 0 && nr_samples < NR_SAMPLES) {
+            churn_sample_t *sample = samples + nr_samples;
+            Uint64 now;
+            double frag = 0;
+
+            pump_messages ();
+            now = get_curr_ns ();
+            take_sample (sample);
+
+            // the part of the heap got from the system but not in use
+            if (sample->heap_total > 0)
+                frag = 1.0 - (double)sample->heap_in_use / sample->heap_total;
+
+            _MG_PRINTF ("%12d %12.0f %12ld %14zu %14zu %7.1f%%\n",
+                    cycle, interval * 1.0E9 / (now - start_ns),
+                    sample->rss_kb, sample->heap_in_use / 1024,
+                    sample->heap_total / 1024, frag * 100);
+
+            rss [nr_samples] = sample->rss_kb;
+            heap [nr_samples] = sample->heap_in_use;
+            nr_samples++;
+
+            // the time of sampling is not counted
+            start_ns = get_curr_ns ();
+        }
+    }
+
+    for (int i = 0; i < churn.nr_live; i++) {
+        if (churn.live [i] != HWND_NULL)
+            destroy_churn_window (kind, churn.live [i]);
+    }
+    pump_messages ();
+
+    if (is_growing_steadily (rss, nr_samples, LEAK_THRESHOLD_RSS_KB)) {
+        _ERR_PRINTF ("the resident memory grows steadily in %s window churn: "
+                "%ld KB -> %ld KB\n", churn_names [kind],
+                samples [NR_WARMUP_SAMPLES].rss_kb,
+                samples [nr_samples - 1].rss_kb);
+        nr_errors++;
+    }
+
+    if (is_growing_steadily (heap, nr_samples, LEAK_THRESHOLD_HEAP_BYTES)) {
+        _ERR_PRINTF ("the heap in use grows steadily in %s window churn: "
+                "%zu KB -> %zu KB (%.1f bytes per cycle)\n",
+                churn_names [kind],
+                samples [NR_WARMUP_SAMPLES].heap_in_use / 1024,
+                samples [nr_samples - 1].heap_in_use / 1024,
+                (heap [nr_samples - 1] - heap [NR_WARMUP_SAMPLES]) /
+                    ((nr_samples - 1 - NR_WARMUP_SAMPLES) * (double)interval));
+        nr_errors++;
+    }
+
+    _MG_PRINTF ("========= END OF BENCH %s window churn: %s\n",
+            churn_names [kind], nr_errors ? "FAILED" : "passed");
+    return nr_errors ? -1 : 0;
+}
+
+static int test_main_entry (void)
+{
+    MAINWINCREATE create_info;
+    int result = 0;
+
+    create_info.dwStyle = WS_VISIBLE | WS_BORDER | WS_CAPTION;
+    create_info.dwExStyle = WS_EX_NONE;
+    create_info.spCaption = "The host of churn windows";
+    create_info.hMenu = 0;
+    create_info.hCursor = GetSystemCursor (0);
+    create_info.hIcon = 0;
+    create_info.MainWindowProc = churn_main_win_proc;
+    create_info.lx = 0;
+    create_info.ty = 0;
+    create_info.rx = 320;
+    create_info.by = 240;
+    create_info.iBkColor = PIXEL_lightwhite;
+    create_info.dwAddData = 0;
+    create_info.hHosting = HWND_NULL;
+
+    churn.host = CreateMainWindow (&create_info);
+    if (churn.host == HWND_INVALID) {
+        _ERR_PRINTF ("FATAL ERROR: failed to create the host window\n");
+        return -1;
+    }
+
+    churn.live = calloc (churn.nr_live, sizeof (HWND));
+    if (churn.live == NULL) {
+        _ERR_PRINTF ("FATAL ERROR: failed to allocate memory for the pool\n");
+        DestroyMainWindow (churn.host);
+        MainWindowCleanup (churn.host);
+        return -1;
+    }
+
+    for (int kind = 0; kind < NR_CHURN_KINDS; kind++) {
+        if (run_churn (kind))
+            result = -1;
+    }
+
+    free (churn.live);
+    DestroyMainWindow (churn.host);
+    MainWindowCleanup (churn.host);
+    return result;
+}
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    JoinLayer (NAME_DEF_LAYER , "windowchurn" , 0 , 0);
+
+    srandom (time(NULL));
+
+    churn.nr_cycles = 1000000;
+    churn.nr_live = 16;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp (argv[i], "-live") == 0 && i + 1 < argc) {
+            churn.nr_live = atoi (argv[++i]);
+        }
+        else if (strcmp (argv[i], "-visible") == 0) {
+            churn.visible = TRUE;
+        }
+        else {
+            churn.nr_cycles = atoi (argv[i]);
+        }
+    }
+    if (churn.nr_cycles <= 0)
+        churn.nr_cycles = 1000000;
+    if (churn.nr_live <= 0)
+        churn.nr_live = 16;
+
+    return test_main_entry ();
+}
+
+#else   /* defined _MGHAVE_VIRTUAL_WINDOW */
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    _WRN_PRINTF ("Please enable virtual window.\n");
+    return 0;
+}
+
+#endif  /* not defined _MGHAVE_VIRTUAL_WINDOW */
@@ -23,7 +23,33 @@
 **  theses threads.
 **
 **  Note that this program cannot give correct result under compositing schema.
-**  Also note that the underlying screen should run in 32-bit color depth.
+**
+**  When the screen runs in 32-bit color depth, the whole screen is copied to
+**  a memory DC and compared with the screen rasterized from the windows
+**  recorded by this program, and every mismatching region is reported.
+**  The area under the cursor is masked. Under other color depths, only
+**  the pixels on the diagonal line are checked.
+**
+**  With -bench <nr_ops>, the program runs nr_ops z-order operations back to
+**  back instead of one per timer tick, with the pixel checking off. A window
+**  destroyed is created again in the same level to keep the level full.
+**  The time of every operation is measured in the thread of the window
+**  around the MiniGUI call only: the window notifies the main thread of the
+**  change without waiting, so the model of this program is updated outside
+**  the timed span. A latency histogram is reported per operation type and
+**  per level.
+**  The operations are not printed in this mode.
+**  Use -max-wins <n> to limit the number of windows per level.
+**
+**  The operations are chosen by random(), seeded with -seed <n> or the
+**  current time. With -record <file>, every operation is written to a log,
+**  and -replay <file> runs the operations in a log again against new windows,
+**  so that a run can be repeated on another build of MiniGUI. Use -speed <f>
+**  to replay faster (f > 1) or slower (f < 1) than the recording; 0 replays
+**  the operations without waiting.
+**
+**  Usage: zorder [-bench <nr_ops>] [-max-wins <n>] [-seed <n>]
+**          [-record <file> | -replay <file> [-speed <f>]] [nr_loops]
 **
 **  The following APIs are covered:
 **
@@ -46,6 +72,12 @@
 **      SendMessage
 **      NotifyWindow
 **      GetPixel
+**      GetGDCapability
+**      CreateCompatibleDCEx
+**      BitBlt
+**      LockDC
+**      UnlockDC
+**      GetCursorPos
 **      SetTimer
 **      GetNextMainWindow
 **      WS_EX_WINTYPE_TOOLTIP
@@ -85,9 +117,16 @@
 #include <minigui/gdi.h>
 #include <minigui/window.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifndef _MGSCHEMA_COMPOSITING
 
 #include "list.h"
+#include "helpers.h"
 
 /* constants defined by MiniGUI Core */
 #define DEF_NR_TOOLTIPS             8
@@ -126,6 +165,7 @@ enum {
     MSG_TESTWINSHOWN,
     MSG_TESTWINMOVED,
     MSG_TESTWINDESTROYED,
+    MSG_ZORDER_OP_TIMED,
 
     /* Messages sent to test main window from main main window. */
     MSG_ZORDER_OP_DESTROY, 
@@ -157,6 +197,8 @@ typedef struct win_info {
     int                 level_got;
     RECT                rc_window;
     RECT                rc_exp;
+    unsigned int        z_stamp;    // larger is higher in the same level
+    int                 serial;     // identifies the window in operation logs
 } win_info_t;
 
 static struct window_template {
@@ -174,6 +216,7 @@ static struct window_template {
 #if 0
     win_info_t *windows;
 #endif
+    int         nr_serials; // the serial number for the next window
 } window_templates [] = {
     { WS_EX_WINTYPE_TOOLTIP,    0xFFFFFF00, 0x00000010,
         { 0, 0, 100, 100 }, { 13, 13 }, DEF_NR_TOOLTIPS,    0,
@@ -211,23 +254,197 @@ static struct window_template {
         "A launcher window #%d" },
 };
 
-static const win_info_t *get_window_at_point (int x, int y)
+/* z-order operations timed in bench mode */
+enum {
+    ZOP_SHOW = 0,
+    ZOP_HIDE,
+    ZOP_RAISE,
+    ZOP_MOVE,
+    ZOP_DESTROY,
+    ZOP_CREATE,
+    NR_ZOPS,
+};
+
+static const char *zop_names [] = {
+    "show",
+    "hide",
+    "raise",
+    "move",
+    "destroy",
+    "create",
+};
+
+static int get_zop_by_name (const char *name)
 {
-    int level;
+    for (int op = 0; op < NR_ZOPS; op++) {
+        if (strcmp (zop_names [op], name) == 0)
+            return op;
+    }
 
-    for (level = WIN_LEVEL_MIN; level <= WIN_LEVEL_MAX; level++) {
-        struct list_head *info;
+    return -1;
+}
 
-        list_for_each (info, &window_templates[level].list_wins) {
-            win_info_t *my_win_info = (win_info_t*)info;
-            if (my_win_info->visible &&
-                    PtInRect (&my_win_info->rc_window, x, y)) {
-                return my_win_info;
+/* the histograms are only accessed in the main thread */
+static struct bench_info {
+    int         nr_ops;         // the number of operations to run; 0 for no bench
+    int         max_wins;       // the maximal number of windows per level
+    BOOL        started;
+    BOOL        finished;
+    int         nr_done;
+    int         nr_pending;     // the number of operations not timed yet
+    int         nr_wins_settled;
+    Uint64      start_ns;
+    lat_hist_t  hist_ops [NR_ZOPS];
+    lat_hist_t  hist_levels [WIN_LEVEL_MAX + 1];
+} bench;
+
+/* the operations are not printed in bench mode, so as not to time the I/O */
+#define ZOP_PRINTF(fmt, ...)                        \
+    do {                                            \
+        if (bench.nr_ops == 0)                      \
+            _MG_PRINTF (fmt, ##__VA_ARGS__);        \
+    } while (0)
+
+/*
+ * A grid index over the screen: every cell holds the visible windows
+ * overlapping it, so that finding the window at a point only checks the
+ * windows in one cell, whatever the number of windows is.
+ * It is only accessed in the main thread.
+ */
+#define GRID_CELL_SIZE      64
+
+typedef struct grid_cell {
+    win_info_t **wins;
+    int         nr_wins;
+    int         max_wins;
+} grid_cell_t;
+
+static struct window_grid {
+    grid_cell_t    *cells;
+    int             cols;
+    int             rows;
+    unsigned int    z_stamp;    // the last stamp given to a window
+} grid;
+
+static BOOL init_window_grid (void)
+{
+    grid.cols = (RECTW (g_rcScr) + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE;
+    grid.rows = (RECTH (g_rcScr) + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE;
+    grid.cells = calloc (grid.cols * grid.rows, sizeof (grid_cell_t));
+    if (grid.cells == NULL) {
+        _ERR_PRINTF ("failed to allocate memory for the window grid\n");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void deinit_window_grid (void)
+{
+    for (int i = 0; i < grid.cols * grid.rows; i++)
+        free (grid.cells [i].wins);
+
+    free (grid.cells);
+    grid.cells = NULL;
+}
+
+/* gets the cells overlapped by a rectangle; FALSE if it is out of screen */
+static BOOL get_grid_range (const RECT *rc, RECT *range)
+{
+    int l = MAX (rc->left, 0);
+    int t = MAX (rc->top, 0);
+    int r = MIN (rc->right, RECTW (g_rcScr));
+    int b = MIN (rc->bottom, RECTH (g_rcScr));
+
+    if (l >= r || t >= b)
+        return FALSE;
+
+    SetRect (range, l / GRID_CELL_SIZE, t / GRID_CELL_SIZE,
+            (r - 1) / GRID_CELL_SIZE + 1, (b - 1) / GRID_CELL_SIZE + 1);
+    return TRUE;
+}
+
+static void add_window_to_grid (win_info_t *win_info)
+{
+    RECT range;
+
+    if (!get_grid_range (&win_info->rc_window, &range))
+        return;
+
+    for (int row = range.top; row < range.bottom; row++) {
+        for (int col = range.left; col < range.right; col++) {
+            grid_cell_t *cell = grid.cells + row * grid.cols + col;
+
+            if (cell->nr_wins == cell->max_wins) {
+                int max_wins = cell->max_wins ? cell->max_wins * 2 : 8;
+                win_info_t **wins = realloc (cell->wins,
+                        sizeof (win_info_t *) * max_wins);
+
+                if (wins == NULL) {
+                    _ERR_PRINTF ("failed to grow a cell of the window grid\n");
+                    assert (0);
+                    return;
+                }
+
+                cell->wins = wins;
+                cell->max_wins = max_wins;
             }
+
+            cell->wins [cell->nr_wins++] = win_info;
         }
     }
+}
 
-    return NULL;
+/* must be called before changing rc_window */
+static void remove_window_from_grid (win_info_t *win_info)
+{
+    RECT range;
+
+    if (!get_grid_range (&win_info->rc_window, &range))
+        return;
+
+    for (int row = range.top; row < range.bottom; row++) {
+        for (int col = range.left; col < range.right; col++) {
+            grid_cell_t *cell = grid.cells + row * grid.cols + col;
+
+            for (int i = 0; i < cell->nr_wins; i++) {
+                if (cell->wins [i] == win_info) {
+                    cell->wins [i] = cell->wins [--cell->nr_wins];
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/* a lower level is higher; in the same level, the latest raised is higher */
+static inline BOOL is_window_above (const win_info_t *a, const win_info_t *b)
+{
+    if (a->level_got != b->level_got)
+        return a->level_got < b->level_got;
+    return a->z_stamp > b->z_stamp;
+}
+
+static const win_info_t *get_window_at_point (int x, int y)
+{
+    const grid_cell_t *cell;
+    const win_info_t *found = NULL;
+
+    // no window is visible out of the screen
+    if (x < 0 || y < 0 || x >= RECTW (g_rcScr) || y >= RECTH (g_rcScr))
+        return NULL;
+
+    cell = grid.cells + (y / GRID_CELL_SIZE) * grid.cols + x / GRID_CELL_SIZE;
+    for (int i = 0; i < cell->nr_wins; i++) {
+        const win_info_t *win_info = cell->wins [i];
+
+        if (PtInRect (&win_info->rc_window, x, y) &&
+                (found == NULL || is_window_above (win_info, found))) {
+            found = win_info;
+        }
+    }
+
+    return found;
 }
 
 static int print_windows_by_pixel (gal_pixel pixel)
@@ -390,6 +607,282 @@ static int check_zorder_by_pixels (void)
     return 0;
 }
 
+#define MAX_MISMATCH_REGIONS    8
+#define CURSOR_MASK_SIZE        32
+
+/* the whole-screen verifier, only for the screen in 32-bit color depth */
+static struct screen_verifier {
+    HDC         memdc;      // the copy of the screen
+    Uint32     *expected;   // the screen rasterized from window_templates
+    int         width;
+    int         height;
+    Uint32      rgb_mask;   // the bits to compare
+} verifier = { HDC_INVALID };
+
+static BOOL init_screen_verifier (void)
+{
+    if (GetGDCapability (HDC_SCREEN, GDCAP_BITSPP) != 32) {
+        _WRN_PRINTF ("the screen is not in 32-bit color depth; "
+                "only check the pixels on the diagonal line\n");
+        return FALSE;
+    }
+
+    verifier.width = RECTW (g_rcScr);
+    verifier.height = RECTH (g_rcScr);
+    verifier.rgb_mask = GetGDCapability (HDC_SCREEN, GDCAP_RMASK) |
+        GetGDCapability (HDC_SCREEN, GDCAP_GMASK) |
+        GetGDCapability (HDC_SCREEN, GDCAP_BMASK);
+
+    verifier.memdc = CreateCompatibleDCEx (HDC_SCREEN,
+            verifier.width, verifier.height);
+    if (verifier.memdc == HDC_INVALID) {
+        _WRN_PRINTF ("failed to create the memory DC for the screen\n");
+        return FALSE;
+    }
+
+    verifier.expected = malloc (sizeof (Uint32) *
+            verifier.width * verifier.height);
+    if (verifier.expected == NULL) {
+        _WRN_PRINTF ("failed to allocate memory for the expected screen\n");
+        DeleteMemDC (verifier.memdc);
+        verifier.memdc = HDC_INVALID;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void deinit_screen_verifier (void)
+{
+    if (verifier.memdc != HDC_INVALID) {
+        DeleteMemDC (verifier.memdc);
+        free (verifier.expected);
+        verifier.memdc = HDC_INVALID;
+        verifier.expected = NULL;
+    }
+}
+
+static void fill_expected_rect (const RECT *rc, Uint32 pixel)
+{
+    for (int y = rc->top; y < rc->bottom; y++) {
+        Uint32 *row = verifier.expected + y * verifier.width;
+
+        for (int x = rc->left; x < rc->right; x++)
+            row [x] = pixel;
+    }
+}
+
+/* paints the windows from the bottommost one, like the desktop does */
+static void rasterize_expected_screen (Uint32 pixel_desktop)
+{
+    RECT rc_screen = { 0, 0, verifier.width, verifier.height };
+
+    fill_expected_rect (&rc_screen, pixel_desktop);
+
+    for (int level = WIN_LEVEL_MAX; level >= WIN_LEVEL_MIN; level--) {
+        struct list_head *head = &window_templates[level].list_wins;
+        struct list_head *info;
+
+        for (info = head->prev; info != head; info = info->prev) {
+            win_info_t *win_info = (win_info_t *)info;
+            RECT rc;
+
+            if (win_info->visible &&
+                    IntersectRect (&rc, &win_info->rc_window, &rc_screen)) {
+                fill_expected_rect (&rc, DWORD2Pixel (HDC_SCREEN,
+                            win_info->color_bkgnd));
+            }
+        }
+    }
+}
+
+static inline void scan_mismatch (const Uint32 *got, const Uint32 *exp,
+        int from, int to, Uint32 mask, int *first, int *last)
+{
+    for (int x = from; x < to; x++) {
+        if ((got [x] ^ exp [x]) & mask) {
+            if (*first < 0)
+                *first = x;
+            *last = x;
+        }
+    }
+}
+
+/*
+ * Returns the first mismatching pixel in a row, or -1 if the row matches;
+ * *last gets the last one. The pixels are compared in blocks with SIMD,
+ * and only a block with any mismatch is scanned pixel by pixel.
+ */
+static int find_mismatch_in_row (const Uint32 *got, const Uint32 *exp,
+        int width, Uint32 mask, int *last)
+{
+    int first = -1;
+    int x = 0;
+
+#if defined(__AVX2__)
+    __m256i vmask = _mm256_set1_epi32 ((int)mask);
+    __m256i zero = _mm256_setzero_si256 ();
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i diff = _mm256_xor_si256 (
+                _mm256_loadu_si256 ((const __m256i *)(got + x)),
+                _mm256_loadu_si256 ((const __m256i *)(exp + x)));
+
+        diff = _mm256_and_si256 (diff, vmask);
+        if (_mm256_movemask_epi8 (_mm256_cmpeq_epi32 (diff, zero)) != -1)
+            scan_mismatch (got, exp, x, x + 8, mask, &first, last);
+    }
+#elif defined(__SSE2__)
+    __m128i vmask = _mm_set1_epi32 ((int)mask);
+    __m128i zero = _mm_setzero_si128 ();
+
+    for (; x + 4 <= width; x += 4) {
+        __m128i diff = _mm_xor_si128 (
+                _mm_loadu_si128 ((const __m128i *)(got + x)),
+                _mm_loadu_si128 ((const __m128i *)(exp + x)));
+
+        diff = _mm_and_si128 (diff, vmask);
+        if (_mm_movemask_epi8 (_mm_cmpeq_epi32 (diff, zero)) != 0xFFFF)
+            scan_mismatch (got, exp, x, x + 4, mask, &first, last);
+    }
+#endif
+
+    scan_mismatch (got, exp, x, width, mask, &first, last);
+    return first;
+}
+
+typedef struct mismatch_region {
+    RECT    rc;
+    POINT   pt;         // the first mismatching pixel
+    int     nr_rows;
+} mismatch_region_t;
+
+/* merges the mismatching span of a row into the region above it */
+static int add_mismatch_span (mismatch_region_t *regions, int nr_regions,
+        int y, int first, int last)
+{
+    for (int i = 0; i < nr_regions; i++) {
+        RECT *rc = &regions [i].rc;
+
+        if (rc->bottom == y && first <= rc->right && last >= rc->left - 1) {
+            rc->left = MIN (rc->left, first);
+            rc->right = MAX (rc->right, last + 1);
+            rc->bottom = y + 1;
+            regions [i].nr_rows++;
+            return nr_regions;
+        }
+    }
+
+    if (nr_regions < MAX_MISMATCH_REGIONS) {
+        mismatch_region_t *region = regions + nr_regions;
+
+        SetRect (&region->rc, first, y, last + 1, y + 1);
+        region->pt.x = first;
+        region->pt.y = y;
+        region->nr_rows = 1;
+        nr_regions++;
+    }
+
+    return nr_regions;
+}
+
+static int check_zorder_by_screen (void)
+{
+    gal_pixel pixel_desktop = GetWindowElementPixelEx (HWND_DESKTOP,
+            HDC_SCREEN, WE_BGC_DESKTOP);
+    mismatch_region_t regions [MAX_MISMATCH_REGIONS];
+    int nr_regions = 0;
+    int width, height, pitch;
+    POINT pt_cursor;
+    RECT rc_cursor;
+    Uint8 *bits;
+
+    BitBlt (HDC_SCREEN, 0, 0, verifier.width, verifier.height,
+            verifier.memdc, 0, 0, 0);
+    bits = LockDC (verifier.memdc, NULL, &width, &height, &pitch);
+    if (bits == NULL) {
+        _WRN_PRINTF ("failed to lock the memory DC; check the diagonal line\n");
+        return check_zorder_by_pixels ();
+    }
+
+    rasterize_expected_screen ((Uint32)pixel_desktop);
+
+    /* mask the cursor: the pixels under it are always taken as expected */
+    GetCursorPos (&pt_cursor);
+    SetRect (&rc_cursor, pt_cursor.x - CURSOR_MASK_SIZE,
+            pt_cursor.y - CURSOR_MASK_SIZE,
+            pt_cursor.x + CURSOR_MASK_SIZE, pt_cursor.y + CURSOR_MASK_SIZE);
+    if (IntersectRect (&rc_cursor, &rc_cursor, &g_rcScr)) {
+        for (int y = rc_cursor.top; y < rc_cursor.bottom; y++) {
+            memcpy (verifier.expected + y * verifier.width + rc_cursor.left,
+                    (Uint32 *)(bits + y * pitch) + rc_cursor.left,
+                    sizeof (Uint32) * RECTW (rc_cursor));
+        }
+    }
+
+    for (int y = 0; y < height; y++) {
+        int first, last;
+
+        first = find_mismatch_in_row ((const Uint32 *)(bits + y * pitch),
+                verifier.expected + y * verifier.width, width,
+                verifier.rgb_mask, &last);
+        if (first >= 0)
+            nr_regions = add_mismatch_span (regions, nr_regions,
+                    y, first, last);
+    }
+
+    if (nr_regions == 0) {
+        UnlockDC (verifier.memdc);
+        return 0;
+    }
+
+    for (int i = 0; i < nr_regions; i++) {
+        const mismatch_region_t *region = regions + i;
+        gal_pixel pixel_screen = ((Uint32 *)(bits +
+                    region->pt.y * pitch)) [region->pt.x];
+        const win_info_t *win_info;
+
+        _ERR_PRINTF ("region (%d, %d, %d, %d) on screen does not match; "
+                "first pixel (%d, %d): %08x, expected: %08x\n",
+                region->rc.left, region->rc.top,
+                region->rc.right, region->rc.bottom,
+                region->pt.x, region->pt.y, pixel_screen,
+                verifier.expected [region->pt.y * verifier.width +
+                    region->pt.x]);
+
+        win_info = get_window_at_point (region->pt.x, region->pt.y);
+        if (win_info) {
+            _ERR_PRINTF ("the pixel is expected in window (%s), "
+                    "rect (%d, %d, %d, %d)\n",
+                    GetWindowCaption (win_info->hwnd),
+                    win_info->rc_window.left, win_info->rc_window.top,
+                    win_info->rc_window.right, win_info->rc_window.bottom);
+        }
+        else {
+            _ERR_PRINTF ("the pixel is expected in desktop\n");
+        }
+
+        // only print the windows for the first region; it is verbose
+        if (i == 0) {
+            if (pixel_screen == pixel_desktop) {
+                _ERR_PRINTF ("pixel (%d, %d) on screen "
+                        "is background pixel of desktop\n",
+                        region->pt.x, region->pt.y);
+            }
+            else {
+                print_windows_in_level (
+                        print_windows_by_pixel (pixel_screen));
+            }
+
+            if (win_info)
+                print_windows_in_level (win_info->level_got);
+        }
+    }
+
+    UnlockDC (verifier.memdc);
+    return -1;
+}
+
 static int add_new_window_in_level (int level, const win_info_t* win_info)
 {
     struct list_head *info;
@@ -413,6 +906,11 @@ static int add_new_window_in_level (int level, const win_info_t* win_info)
     memcpy (new_win_info, win_info, sizeof (win_info_t));
     list_add (&new_win_info->list, &window_templates[level].list_wins);
 
+    new_win_info->z_stamp = ++grid.z_stamp;
+    new_win_info->serial = window_templates[level].nr_serials++;
+    if (new_win_info->visible)
+        add_window_to_grid (new_win_info);
+
     window_templates[level].nr_created++;
     return 0;
 }
@@ -439,6 +937,11 @@ static int mark_window_as_visible_in_level (int level, HWND hwnd, BOOL show_hide
         return -1;
     }
 
+    if (show_hide && !found->visible)
+        add_window_to_grid (found);
+    else if (!show_hide && found->visible)
+        remove_window_from_grid (found);
+
     found->visible = show_hide;
     return 0;
 }
@@ -468,7 +971,10 @@ static int raise_window_to_top_in_level (int level, HWND hwnd)
             idx, GetWindowCaption (found->hwnd),
             found->visible, IsWindowVisible (found->hwnd));
 
+    if (!found->visible)
+        add_window_to_grid (found);
     found->visible = TRUE;
+    found->z_stamp = ++grid.z_stamp;
     assert (IsWindowVisible (found->hwnd));
 
     list_del (&found->list);
@@ -495,7 +1001,14 @@ static int change_window_rect_in_level (int level, HWND hwnd)
         return -1;
     }
 
-    found->rc_window = found->rc_exp;
+    if (found->visible) {
+        remove_window_from_grid (found);
+        found->rc_window = found->rc_exp;
+        add_window_to_grid (found);
+    }
+    else {
+        found->rc_window = found->rc_exp;
+    }
     return 0;
 }
 
@@ -518,6 +1031,9 @@ static int remove_window_in_level (int level, HWND hwnd)
         return -1;
     }
 
+    if (found->visible)
+        remove_window_from_grid (found);
+
     list_del (&found->list);
     mg_slice_delete (win_info_t, found);
 
@@ -532,12 +1048,15 @@ static int free_all_windows_in_level (int level)
 
     list_for_each_safe (info, tmp, &window_templates[level].list_wins) {
         win_info_t *win_info = (win_info_t *)info;
+        if (win_info->visible)
+            remove_window_from_grid (win_info);
         list_del (&win_info->list);
         mg_slice_delete (win_info_t, win_info);
         nr++;
     }
 
     window_templates[level].nr_created = 0;
+    window_templates[level].nr_serials = 0;
     return nr;
 }
 
@@ -549,13 +1068,15 @@ typedef struct test_info {
     int nr_thread_wins; // the number of main windows in this thread.
     int nr_threads;     // the number of active GUI threads.
     int nr_zops;        // the number of pending zorder operations.
+    BOOL recreating;    // a window is being destroyed and created again.
+    Uint64 create_ns;   // the time of the last CreateMainWindow call.
 } test_info_t;
 
 static void on_test_win_created (test_info_t* info, win_info_t* win_info)
 {
     assert (IS_WIN_LEVEL_VALID (win_info->level_got));
 
-    _MG_PRINTF ("A main window created (%s) in level (%d), visible (%s : %s)\n",
+    ZOP_PRINTF ("A main window created (%s) in level (%d), visible (%s : %s)\n",
             GetWindowCaption (win_info->hwnd), win_info->level_got,
             win_info->visible?"YSE":"NO",
             IsWindowVisible (win_info->hwnd)?"YES":"NO");
@@ -574,19 +1095,19 @@ static void on_test_win_shown (int show_cmd, HWND hwnd)
 
     switch (show_cmd) {
         case SW_HIDE:
-            _MG_PRINTF ("The main window (%s) was hidden in level (%d)\n",
+            ZOP_PRINTF ("The main window (%s) was hidden in level (%d)\n",
                     GetWindowCaption (hwnd), level);
             mark_window_as_visible_in_level (level, hwnd, FALSE);
             break;
 
         case SW_SHOW:
-            _MG_PRINTF ("The main window (%s) was shown in level (%d)\n",
+            ZOP_PRINTF ("The main window (%s) was shown in level (%d)\n",
                     GetWindowCaption (hwnd), level);
             mark_window_as_visible_in_level (level, hwnd, TRUE);
             break;
 
         case SW_SHOWNORMAL:
-            _MG_PRINTF ("The main window (%s) was raised in level (%d)\n",
+            ZOP_PRINTF ("The main window (%s) was raised in level (%d)\n",
                     GetWindowCaption (hwnd), level);
             raise_window_to_top_in_level (level, hwnd);
             break;
@@ -603,7 +1124,7 @@ static void on_test_win_moved (HWND hwnd)
 
     assert (IS_WIN_LEVEL_VALID (level));
 
-    _MG_PRINTF ("The main window (%s) was moved in level (%d)\n",
+    ZOP_PRINTF ("The main window (%s) was moved in level (%d)\n",
             GetWindowCaption (hwnd), level);
     if (change_window_rect_in_level (level, hwnd)) {
         assert (0);
@@ -616,7 +1137,7 @@ static void on_test_win_destroyed (test_info_t* info, HWND hwnd)
 
     assert (IS_WIN_LEVEL_VALID (level));
 
-    _MG_PRINTF ("The main window (%s) is being destroyed in level (%d)\n",
+    ZOP_PRINTF ("The main window (%s) is being destroyed in level (%d)\n",
             GetWindowCaption (hwnd), level);
 
     remove_window_in_level (level, hwnd);
@@ -655,14 +1176,291 @@ static void set_new_window_rect (win_info_t *win_info, int level)
     int offy = window_templates[level].size_delta.cy * (random () % 5 - 10);
 
     OffsetRect (&win_info->rc_exp, offx, offy);
+
+    /* bring back the window once it goes out of the screen */
+    if (win_info->rc_exp.right <= 0 || win_info->rc_exp.bottom <= 0) {
+        OffsetRect (&win_info->rc_exp, -win_info->rc_exp.left,
+                -win_info->rc_exp.top);
+    }
+}
+
+/*
+ * The operation log has a header line, then the operations of every loop
+ * between a "loop" line and an "end" line:
+ *
+ *  zorder-oplog 1 seed <seed> max-wins <n> bench <nr_ops>
+ *  loop <n>
+ *  op <ms> <name> <level> <serial> <a> <b> <c> <d>
+ *  end
+ *
+ * The window is identified by its level and its serial number in the level.
+ * ms is the time since the first operation of the loop. The arguments are
+ * the new rectangle for move, and the number of the window created again
+ * (or -1) for destroy.
+ */
+#define OPLOG_VERSION       1
+
+typedef struct zop_record {
+    unsigned int ms;
+    int     op;
+    int     level;
+    int     serial;
+    int     args [4];
+} zop_record_t;
+
+static struct op_log {
+    FILE           *fp;
+    BOOL            replaying;
+    BOOL            failed;     // the windows do not match the log
+    BOOL            loop_ended; // no more operation in this loop
+    double          speed;
+    unsigned int    seed;
+    Uint64          start_ns;   // the time of the first operation in a loop
+    zop_record_t    next;
+} oplog = { NULL, FALSE, FALSE, FALSE, 1.0 };
+
+static unsigned int get_oplog_ms (void)
+{
+    if (oplog.start_ns == 0)
+        oplog.start_ns = get_curr_ns ();
+    return (unsigned int)((get_curr_ns () - oplog.start_ns) / 1000000);
+}
+
+static BOOL open_oplog_for_record (const char *file)
+{
+    oplog.fp = fopen (file, "w");
+    if (oplog.fp == NULL) {
+        _ERR_PRINTF ("failed to open operation log %s\n", file);
+        return FALSE;
+    }
+
+    fprintf (oplog.fp, "zorder-oplog %d seed %u max-wins %d bench %d\n",
+            OPLOG_VERSION, oplog.seed, bench.max_wins, bench.nr_ops);
+    return TRUE;
 }
 
-static void do_zorder_operation (test_info_t* info)
+/* the options recorded in the log override the ones in the command line */
+static BOOL open_oplog_for_replay (const char *file)
+{
+    int version;
+
+    oplog.fp = fopen (file, "r");
+    if (oplog.fp == NULL) {
+        _ERR_PRINTF ("failed to open operation log %s\n", file);
+        return FALSE;
+    }
+
+    if (fscanf (oplog.fp, "zorder-oplog %d seed %u max-wins %d bench %d",
+                &version, &oplog.seed, &bench.max_wins, &bench.nr_ops) != 4 ||
+            version != OPLOG_VERSION) {
+        _ERR_PRINTF ("%s is not an operation log of version %d\n",
+                file, OPLOG_VERSION);
+        fclose (oplog.fp);
+        oplog.fp = NULL;
+        return FALSE;
+    }
+
+    oplog.replaying = TRUE;
+    return TRUE;
+}
+
+static void close_oplog (void)
+{
+    if (oplog.fp) {
+        fclose (oplog.fp);
+        oplog.fp = NULL;
+    }
+}
+
+/* reads the next operation; FALSE at the end of the loop */
+static BOOL read_oplog_record (zop_record_t *rec)
+{
+    char line [256];
+    char name [16];
+
+    while (fgets (line, sizeof (line), oplog.fp)) {
+        if (strncmp (line, "end", 3) == 0)
+            return FALSE;
+
+        if (sscanf (line, "op %u %15s %d %d %d %d %d %d", &rec->ms, name,
+                    &rec->level, &rec->serial, rec->args, rec->args + 1,
+                    rec->args + 2, rec->args + 3) == 8 &&
+                (rec->op = get_zop_by_name (name)) >= 0 &&
+                IS_WIN_LEVEL_VALID (rec->level)) {
+            return TRUE;
+        }
+
+        _WRN_PRINTF ("bad line in operation log: %s", line);
+    }
+
+    return FALSE;
+}
+
+/* called at the start of a loop; FALSE if there is no more loop to replay */
+static BOOL begin_oplog_loop (int loop)
+{
+    oplog.start_ns = 0;
+    oplog.loop_ended = FALSE;
+
+    if (oplog.fp == NULL)
+        return TRUE;
+
+    if (!oplog.replaying) {
+        fprintf (oplog.fp, "loop %d\n", loop);
+        return TRUE;
+    }
+
+    char line [256];
+    while (fgets (line, sizeof (line), oplog.fp)) {
+        if (strncmp (line, "loop", 4) == 0) {
+            oplog.loop_ended = !read_oplog_record (&oplog.next);
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static void end_oplog_loop (void)
+{
+    if (oplog.fp && !oplog.replaying) {
+        fprintf (oplog.fp, "end\n");
+        fflush (oplog.fp);
+    }
+}
+
+static void record_zorder_operation (const win_info_t *win_info, int level,
+        int op, int number)
+{
+    if (oplog.fp == NULL || oplog.replaying)
+        return;
+
+    if (op == ZOP_MOVE) {
+        fprintf (oplog.fp, "op %u %s %d %d %d %d %d %d\n", get_oplog_ms (),
+                zop_names [op], level, win_info->serial,
+                win_info->rc_exp.left, win_info->rc_exp.top,
+                win_info->rc_exp.right, win_info->rc_exp.bottom);
+    }
+    else {
+        fprintf (oplog.fp, "op %u %s %d %d %d 0 0 0\n", get_oplog_ms (),
+                zop_names [op], level, win_info->serial, number);
+    }
+}
+
+/* sends an operation to the test window; number is only used by destroy */
+static int dispatch_zorder_operation (test_info_t* info, win_info_t *win_info,
+        int level, int op, int number)
+{
+    switch (op) {
+    case ZOP_DESTROY:
+        ZOP_PRINTF ("we are destroying window (%s) in level (%d), "
+                "%d windows left\n",
+                GetWindowCaption (win_info->hwnd), level,
+                window_templates[level].nr_created);
+        // destroy the target window; the thread creates a new window
+        // with the number given in lparam if wparam is TRUE.
+        SendNotifyMessage (win_info->hwnd, MSG_ZORDER_OP_DESTROY,
+                number >= 0, number >= 0 ? number : 0);
+        break;
+
+    case ZOP_HIDE:
+        ZOP_PRINTF ("we are hiding window (%s) in level (%d)\n",
+                GetWindowCaption (win_info->hwnd), level);
+        assert (IsWindowVisible (win_info->hwnd));
+        SendNotifyMessage (win_info->hwnd, MSG_ZORDER_OP_HIDE, 0, 0);
+        break;
+
+    case ZOP_SHOW:
+        ZOP_PRINTF ("we are showing window (%s) in level (%d)\n",
+                GetWindowCaption (win_info->hwnd), level);
+        assert (!IsWindowVisible (win_info->hwnd));
+        SendNotifyMessage (win_info->hwnd, MSG_ZORDER_OP_SHOW, 0, 0);
+        break;
+
+    case ZOP_RAISE:
+        ZOP_PRINTF ("we are showing and raising window (%s) in level (%d)\n",
+                GetWindowCaption (win_info->hwnd), level);
+        SendNotifyMessage (win_info->hwnd, MSG_ZORDER_OP_RAISE, 0, 0);
+        break;
+
+    case ZOP_MOVE:
+        ZOP_PRINTF ("we are moving window (%s) in level (%d)\n",
+                GetWindowCaption (win_info->hwnd), level);
+        SendNotifyMessage (win_info->hwnd, MSG_ZORDER_OP_MOVE,
+                MAKELONG (win_info->rc_exp.left, win_info->rc_exp.top),
+                MAKELONG (win_info->rc_exp.right, win_info->rc_exp.bottom));
+        break;
+
+    default:
+        assert (0);
+        return -1;
+    }
+
+    info->nr_zops++;
+    record_zorder_operation (win_info, level, op, number);
+    return op;
+}
+
+static win_info_t *find_window_by_serial (int level, int serial)
+{
+    struct list_head *info;
+
+    list_for_each (info, &window_templates[level].list_wins) {
+        win_info_t *win_info = (win_info_t *)info;
+        if (win_info->serial == serial)
+            return win_info;
+    }
+
+    return NULL;
+}
+
+/* returns the operation replayed, or -1 if it is not the time yet */
+static int replay_zorder_operation (test_info_t* info)
+{
+    const zop_record_t *rec = &oplog.next;
+    win_info_t *win_info;
+    int op;
+
+    if (oplog.loop_ended)
+        return -1;
+
+    // operations run back to back in bench mode
+    if (bench.nr_ops == 0 && oplog.speed > 0 &&
+            get_oplog_ms () * oplog.speed < rec->ms)
+        return -1;
+
+    win_info = find_window_by_serial (rec->level, rec->serial);
+    if (win_info == NULL || win_info->hwnd == info->main_main_wnd ||
+            (rec->op == ZOP_SHOW && win_info->visible) ||
+            (rec->op == ZOP_HIDE && !win_info->visible)) {
+        _ERR_PRINTF ("the windows do not match the operation log: "
+                "%s window #%d in level (%d)\n",
+                zop_names [rec->op], rec->serial, rec->level);
+        oplog.failed = TRUE;
+        oplog.loop_ended = TRUE;
+        return -1;
+    }
+
+    if (rec->op == ZOP_MOVE)
+        SetRect (&win_info->rc_exp, rec->args [0], rec->args [1],
+                rec->args [2], rec->args [3]);
+
+    op = dispatch_zorder_operation (info, win_info, rec->level, rec->op,
+            rec->args [0]);
+    oplog.loop_ended = !read_oplog_record (&oplog.next);
+    return op;
+}
+
+/* returns the operation requested, or -1 if there is no operation */
+static int do_zorder_operation (test_info_t* info)
 {
     int level;
     int wnd_idx;
     win_info_t *win_info;
 
+    if (oplog.replaying)
+        return replay_zorder_operation (info);
+
     level = random() % (WIN_LEVEL_MAX + 1);
     if (window_templates[level].nr_created == 0) {
         _WRN_PRINTF ("all windows in level (%d) are destroyed.\n", level);
@@ -676,67 +1474,199 @@ static void do_zorder_operation (test_info_t* info)
 
     if (window_templates[level].nr_created == 0) {
         _WRN_PRINTF ("all windows in all levels are destroyed.\n");
-        return;
+        return -1;
     }
 
     wnd_idx = random() % window_templates[level].nr_created;
 
     win_info = get_win_info_by_idx (&window_templates[level].list_wins, wnd_idx);
-    if (win_info) {
-        switch (random () % 4) {    /* 3 for no moving */
-        case 0:
+    if (win_info == NULL)
+        return -1;
+
+    switch (random () % 4) {    /* 3 for no moving */
+    case 0:
+        if (win_info->hwnd == info->main_main_wnd)
+            return -1;
+
+        // in bench mode, a new window is created in the level
+        return dispatch_zorder_operation (info, win_info, level, ZOP_DESTROY,
+                (bench.nr_ops > 0) ?
+                    random () % window_templates[level].nr_allowed : -1);
+
+    case 1:
+        return dispatch_zorder_operation (info, win_info, level,
+                win_info->visible ? ZOP_HIDE : ZOP_SHOW, -1);
+
+    case 2:
+        return dispatch_zorder_operation (info, win_info, level,
+                ZOP_RAISE, -1);
+
+    case 3:
+        set_new_window_rect (win_info, level);
+        return dispatch_zorder_operation (info, win_info, level,
+                ZOP_MOVE, -1);
+
+    default:
+        assert (0);
+        break;
+    }
+
+    return -1;
+}
+
+static void bench_reset (void)
+{
+    bench.started = FALSE;
+    bench.finished = FALSE;
+    bench.nr_done = 0;
+    bench.nr_pending = 0;
+    bench.nr_wins_settled = 0;
+
+    for (int op = 0; op < NR_ZOPS; op++)
+        lat_hist_init (bench.hist_ops + op);
+    for (int level = WIN_LEVEL_MIN; level <= WIN_LEVEL_MAX; level++)
+        lat_hist_init (bench.hist_levels + level);
+}
+
+/* called in the thread of a test window after an operation */
+static void report_zorder_op_time (test_info_t *info, int op, int level,
+        Uint64 ns)
+{
+    if (bench.nr_ops > 0) {
+        SendNotifyMessage (info->main_main_wnd, MSG_ZORDER_OP_TIMED,
+                MAKELONG (op, level), (LPARAM)ns);
+    }
+}
+
+/* tells the main thread about a change of a test window; in bench mode it
+   does not wait for the model update, which would be timed otherwise */
+static void notify_test_win_changed (test_info_t *info, UINT message,
+        WPARAM wparam, HWND hwnd)
+{
+    if (bench.nr_ops > 0)
+        SendNotifyMessage (info->main_main_wnd, message, wparam, (LPARAM)hwnd);
+    else
+        SendMessage (info->main_main_wnd, message, wparam, (LPARAM)hwnd);
+}
+
+static void destroy_all_test_windows (test_info_t *info);
+
+static void finish_bench (test_info_t *info)
+{
+    Uint64 elapsed = get_curr_ns () - bench.start_ns;
+    int nr_wins = 0;
+
+    bench.finished = TRUE;
+
+    for (int level = WIN_LEVEL_MIN; level <= WIN_LEVEL_MAX; level++)
+        nr_wins += window_templates[level].nr_created;
+
+    _MG_PRINTF ("========= z-order benchmark: %d operations on %d windows "
+            "in %.3f s (%.0f ops/s)\n",
+            bench.nr_done, nr_wins, elapsed / 1.0E9,
+            bench.nr_done * 1.0E9 / elapsed);
+
+    for (int op = 0; op < NR_ZOPS; op++)
+        lat_hist_print (bench.hist_ops + op, zop_names [op]);
+
+    for (int level = WIN_LEVEL_MIN; level <= WIN_LEVEL_MAX; level++) {
+        char name [64];
+
+        snprintf (name, sizeof (name), "%s (%d)",
+                window_templates[level].type_name + strlen ("WS_EX_WINTYPE_"),
+                window_templates[level].nr_created);
+        lat_hist_print (bench.hist_levels + level, name);
+    }
+
+    destroy_all_test_windows (info);
+}
+
+/* destroys all test windows to end this loop */
+static void destroy_all_test_windows (test_info_t *info)
+{
+    for (int level = WIN_LEVEL_MIN; level <= WIN_LEVEL_MAX; level++) {
+        struct list_head *list;
+
+        list_for_each (list, &window_templates[level].list_wins) {
+            win_info_t *win_info = (win_info_t *)list;
+
             if (win_info->hwnd != info->main_main_wnd) {
-                _MG_PRINTF ("we are destroying window (%s) in level (%d), "
-                        "%d windows left\n",
-                        GetWindowCaption (win_info->hwnd), level,
-                        window_templates[level].nr_created);
-                // destroy the target window
                 SendNotifyMessage (win_info->hwnd, MSG_ZORDER_OP_DESTROY, 0, 0);
                 info->nr_zops++;
             }
-            break;
+        }
+    }
+}
 
-        case 1:
-            if (win_info->visible) {
-                _MG_PRINTF ("we are hiding window (%s) in level (%d)\n",
-                        GetWindowCaption (win_info->hwnd), level);
-                assert (IsWindowVisible (win_info->hwnd));
-                SendNotifyMessage (win_info->hwnd, MSG_ZORDER_OP_HIDE, 0, 0);
-                info->nr_zops++;
-            }
-            else {
-                _MG_PRINTF ("we are showing window (%s) in level (%d)\n",
-                        GetWindowCaption (win_info->hwnd), level);
-                assert (!IsWindowVisible (win_info->hwnd));
-                SendNotifyMessage (win_info->hwnd, MSG_ZORDER_OP_SHOW, 0, 0);
-                info->nr_zops++;
-            }
-            break;
+/* runs the next operation once the last one is done and timed */
+static void run_next_bench_op (test_info_t *info)
+{
+    if (bench.nr_ops == 0 || !bench.started || bench.finished)
+        return;
 
-        case 2:
-            _MG_PRINTF ("we are showing and raising window (%s) in level (%d)\n",
-                    GetWindowCaption (win_info->hwnd), level);
-            SendNotifyMessage (win_info->hwnd, MSG_ZORDER_OP_RAISE, 0, 0);
-            info->nr_zops++;
-            break;
+    if (info->nr_zops > 0 || bench.nr_pending > 0)
+        return;
 
-        case 3:
-            _MG_PRINTF ("we are moving window (%s) in level (%d)\n",
-                    GetWindowCaption (win_info->hwnd), level);
-            set_new_window_rect (win_info, level);
-            SendNotifyMessage (win_info->hwnd, MSG_ZORDER_OP_MOVE,
-                    MAKELONG (win_info->rc_exp.left, win_info->rc_exp.top),
-                    MAKELONG (win_info->rc_exp.right, win_info->rc_exp.bottom));
-            info->nr_zops++;
-            break;
+    if (bench.nr_done < bench.nr_ops) {
+        // do_zorder_operation may choose nothing to do; try again
+        for (int i = 0; i < 100; i++) {
+            int op = do_zorder_operation (info);
 
-        default:
-            assert (0);
-            break;
+            if (op >= 0) {
+                // a destroyed window is created again
+                bench.nr_pending += (op == ZOP_DESTROY) ? 2 : 1;
+                bench.nr_done++;
+                return;
+            }
         }
     }
+
+    finish_bench (info);
+}
+
+static void on_zorder_op_timed (test_info_t *info, int op, int level,
+        Uint64 ns)
+{
+    if (!bench.started || bench.finished)
+        return;
+
+    // ns is zero if the operation failed
+    if (ns > 0) {
+        lat_hist_add (bench.hist_ops + op, ns);
+        lat_hist_add (bench.hist_levels + level, ns);
+    }
+
+    bench.nr_pending--;
+    run_next_bench_op (info);
 }
 
+static void start_bench_if_settled (test_info_t *info)
+{
+    int nr_wins = 0;
+
+#ifdef _MGRM_THREADS
+    if (info->nr_threads <= WIN_LEVEL_MAX)
+        return;
+#endif
+
+    for (int level = WIN_LEVEL_MIN; level <= WIN_LEVEL_MAX; level++)
+        nr_wins += window_templates[level].nr_created;
+
+    // start when no window was created during the last timer tick
+    if (info->nr_zops == 0 && nr_wins == bench.nr_wins_settled) {
+        _MG_PRINTF ("========= START TO BENCH z-order: %d operations on %d windows\n",
+                bench.nr_ops, nr_wins);
+        bench.started = TRUE;
+        bench.start_ns = get_curr_ns ();
+        run_next_bench_op (info);
+    }
+
+    bench.nr_wins_settled = nr_wins;
+}
+
+static void recreate_test_main_window (test_info_t* info, int level,
+        int number);
+
 static LRESULT
 test_main_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
 {
@@ -755,8 +1685,7 @@ test_main_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
 
         assert (info && info->main_main_wnd != HWND_NULL);
 
-        SendMessage (info->main_main_wnd,
-                MSG_TESTWINSHOWN, wparam, (LPARAM)hwnd);
+        notify_test_win_changed (info, MSG_TESTWINSHOWN, wparam, hwnd);
         break;
     }
 
@@ -766,8 +1695,7 @@ test_main_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
 
         assert (info && info->main_main_wnd != HWND_NULL);
 
-        SendMessage (info->main_main_wnd,
-                MSG_TESTWINMOVED, 0, (LPARAM)hwnd);
+        notify_test_win_changed (info, MSG_TESTWINMOVED, 0, hwnd);
         break;
     }
 
@@ -817,6 +1745,7 @@ test_main_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
         assert (info && hwnd == info->main_main_wnd);
         on_test_win_shown ((int)wparam, (HWND)lparam);
         info->nr_zops--;
+        run_next_bench_op (info);
         break;
     }
 
@@ -827,6 +1756,7 @@ test_main_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
         assert (info && hwnd == info->main_main_wnd);
         on_test_win_moved ((HWND)lparam);
         info->nr_zops--;
+        run_next_bench_op (info);
         break;
     }
 
@@ -837,6 +1767,17 @@ test_main_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
         assert (info && hwnd == info->main_main_wnd);
         on_test_win_destroyed ((test_info_t *)wparam, (HWND)lparam);
         info->nr_zops--;
+        run_next_bench_op (info);
+        break;
+    }
+
+    case MSG_ZORDER_OP_TIMED: {
+        test_info_t *info;
+        info = (test_info_t *)GetWindowAdditionalData (hwnd);
+
+        assert (info && hwnd == info->main_main_wnd);
+        on_zorder_op_timed (info, LOWORD (wparam), HIWORD (wparam),
+                (Uint64)lparam);
         break;
     }
 
@@ -845,34 +1786,77 @@ test_main_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
         info = (test_info_t *)GetWindowAdditionalData (hwnd);
 
         if (info->root_wnd != hwnd) {
+            int level = (int)GetWindowAdditionalData2 (hwnd);
+            Uint64 start_ns;
+
             SendMessage (info->main_main_wnd, MSG_TESTWINDESTROYED,
                     (WPARAM)info, (LPARAM)hwnd);
             // for non root window, destroy it here
+            // wparam is TRUE in bench mode to create a new one.
+            info->recreating = (BOOL)wparam;
+            start_ns = get_curr_ns ();
             DestroyMainWindow (hwnd);
             MainWindowCleanup (hwnd);
+            if (wparam) {
+                report_zorder_op_time (info, ZOP_DESTROY, level,
+                        get_curr_ns () - start_ns);
+                recreate_test_main_window (info, level, (int)lparam);
+            }
+            info->recreating = FALSE;
         }
         break;
     }
 
-    case MSG_ZORDER_OP_SHOW:
+    case MSG_ZORDER_OP_SHOW: {
+        test_info_t *info;
+        info = (test_info_t *)GetWindowAdditionalData (hwnd);
+
+        Uint64 start_ns = get_curr_ns ();
         ShowWindow (hwnd, SW_SHOW);
+        report_zorder_op_time (info, ZOP_SHOW,
+                (int)GetWindowAdditionalData2 (hwnd),
+                get_curr_ns () - start_ns);
         break;
+    }
 
-    case MSG_ZORDER_OP_HIDE:
+    case MSG_ZORDER_OP_HIDE: {
+        test_info_t *info;
+        info = (test_info_t *)GetWindowAdditionalData (hwnd);
+
+        Uint64 start_ns = get_curr_ns ();
         ShowWindow (hwnd, SW_HIDE);
+        report_zorder_op_time (info, ZOP_HIDE,
+                (int)GetWindowAdditionalData2 (hwnd),
+                get_curr_ns () - start_ns);
         break;
+    }
 
-    case MSG_ZORDER_OP_RAISE:
+    case MSG_ZORDER_OP_RAISE: {
+        test_info_t *info;
+        info = (test_info_t *)GetWindowAdditionalData (hwnd);
+
+        Uint64 start_ns = get_curr_ns ();
         ShowWindow (hwnd, SW_SHOWNORMAL);
+        report_zorder_op_time (info, ZOP_RAISE,
+                (int)GetWindowAdditionalData2 (hwnd),
+                get_curr_ns () - start_ns);
         break;
+    }
 
     case MSG_ZORDER_OP_MOVE: {
+        test_info_t *info;
+        info = (test_info_t *)GetWindowAdditionalData (hwnd);
+
         int lx = LOSWORD (wparam);
         int ty = HISWORD (wparam);
         int rx = LOSWORD (lparam);
         int by = HISWORD (lparam);
 
+        Uint64 start_ns = get_curr_ns ();
         MoveWindow (hwnd, lx, ty, (rx - lx), (by - ty), TRUE);
+        report_zorder_op_time (info, ZOP_MOVE,
+                (int)GetWindowAdditionalData2 (hwnd),
+                get_curr_ns () - start_ns);
         break;
     }
 
@@ -885,6 +1869,11 @@ test_main_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
                 _MG_PRINTF ("It's time to quit message loop of main thread\n");
                 PostQuitMessage (hwnd);
             }
+            else if (bench.nr_ops > 0) {
+                // operations run back to back without pixel checking
+                if (!bench.started)
+                    start_bench_if_settled (info);
+            }
             else {
                 // check zorder when the main main window is idle
                 // and the number of pending zorder operation is 0.
@@ -901,13 +1890,20 @@ test_main_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
                         assert (0);
                     }
 
-                    if (check_zorder_by_pixels ()) {
+                    if (verifier.memdc != HDC_INVALID ?
+                            check_zorder_by_screen () :
+                            check_zorder_by_pixels ()) {
                         nr_errors++;
                         break;
                     }
 
                     nr_errors = 0;
                     do_zorder_operation (info);
+
+                    // the windows left by a log are destroyed at its end
+                    if (oplog.replaying && oplog.loop_ended &&
+                            info->nr_zops == 0)
+                        destroy_all_test_windows (info);
                 }
             }
         }
@@ -920,7 +1916,7 @@ test_main_win_proc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
         info = (test_info_t *)GetWindowAdditionalData (hwnd);
 
         info->nr_thread_wins--;
-        if (info->nr_thread_wins == 0)
+        if (info->nr_thread_wins == 0 && !info->recreating)
             PostQuitMessage (hwnd);
         return 0;
     }
@@ -938,6 +1934,7 @@ create_test_main_window (test_info_t* info, HWND hosting, int number)
     char            caption[64];
     MAINWINCREATE   create_info;
     win_info_t      win_info;
+    Uint64          start_ns;
 
     win_info.level_expected = info->win_level;
 
@@ -982,7 +1979,9 @@ create_test_main_window (test_info_t* info, HWND hosting, int number)
     create_info.dwAddData = (DWORD)info;
     create_info.hHosting = hosting;
 
+    start_ns = get_curr_ns ();
     win_info.hwnd = CreateMainWindow (&create_info);
+    info->create_ns = get_curr_ns () - start_ns;
     if (win_info.hwnd != HWND_INVALID) {
         if (info->main_main_wnd == HWND_NULL) {
             // we are creating main window in main thread
@@ -1032,7 +2031,7 @@ create_test_main_window (test_info_t* info, HWND hosting, int number)
         // we use dwAddData2 to record the level got
         SetWindowAdditionalData2 (win_info.hwnd, (DWORD)win_info.level_got);
 
-        _MG_PRINTF ("A main window created (%s) type (%s) visible (%s)\n",
+        ZOP_PRINTF ("A main window created (%s) type (%s) visible (%s)\n",
                 GetWindowCaption (win_info.hwnd),
                 window_templates[win_info.level_got].type_name,
                 win_info.visible?"YES":"NO");
@@ -1053,6 +2052,30 @@ create_test_main_window (test_info_t* info, HWND hosting, int number)
     return win_info.hwnd;
 }
 
+/* creates a window in the level of a destroyed one to keep the level full */
+static void recreate_test_main_window (test_info_t* info, int level,
+        int number)
+{
+    int saved_level = info->win_level;
+    HWND hwnd;
+
+    info->win_level = level;
+    hwnd = create_test_main_window (info, info->root_wnd, number);
+    // only CreateMainWindow is timed, not the update of the model
+    report_zorder_op_time (info, ZOP_CREATE, level,
+            (hwnd == HWND_INVALID) ? 0 : info->create_ns);
+    info->win_level = saved_level;
+}
+
+static int get_nr_tries (int level)
+{
+    int nr_tries = window_templates[level].nr_allowed + 1;
+
+    if (bench.max_wins > 0 && nr_tries > bench.max_wins)
+        nr_tries = bench.max_wins;
+    return nr_tries;
+}
+
 #ifdef _MGRM_THREADS
 
 /* we only created a virtual window as the root window of a new GUI thread
@@ -1108,7 +2131,7 @@ static void* test_thread_entry (void* arg)
 
     SendMessage (info.main_main_wnd, MSG_MTH_READY, 0, (LPARAM)&self);
 
-    int nr_tries = window_templates[info.win_level].nr_allowed + 1;
+    int nr_tries = get_nr_tries (info.win_level);
     for (int i = 0; i < nr_tries; i++) {
         if (create_test_main_window (&info, info.root_wnd, i) == HWND_INVALID) {
             NotifyWindow (info.main_main_wnd,
@@ -1136,6 +2159,8 @@ static int test_main_entry (void)
 {
     test_info_t info = { HWND_NULL, HWND_NULL, WIN_LEVEL_NORMAL, 0 };
 
+    bench_reset ();
+
     /* initialize window list for all levels */
     for (int level = WIN_LEVEL_MIN; level <= WIN_LEVEL_MAX; level++) {
         window_templates[level].list_wins.next =
@@ -1176,7 +2201,7 @@ static int test_main_entry (void)
     for (int level = WIN_LEVEL_MIN; level <= WIN_LEVEL_MAX; level++) {
         info.win_level = level;
 
-        int nr_tries = window_templates[info.win_level].nr_allowed + 1;
+        int nr_tries = get_nr_tries (info.win_level);
         for (int i = 0; i < nr_tries; i++) {
             if (create_test_main_window (&info, info.main_main_wnd, i)
                     == HWND_INVALID) {
@@ -1225,21 +2250,81 @@ int MiniGUIMain (int argc, const char* argv[])
 
     JoinLayer (NAME_DEF_LAYER , "zorder" , 0 , 0);
 
-    srandom (time(NULL));
+    const char *record_file = NULL;
+    const char *replay_file = NULL;
+    oplog.seed = (unsigned int)time (NULL);
 
-    if (argc > 1)
-        nr_loops = atoi (argv[1]);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp (argv[i], "-bench") == 0 && i + 1 < argc) {
+            bench.nr_ops = atoi (argv[++i]);
+        }
+        else if (strcmp (argv[i], "-max-wins") == 0 && i + 1 < argc) {
+            bench.max_wins = atoi (argv[++i]);
+        }
+        else if (strcmp (argv[i], "-seed") == 0 && i + 1 < argc) {
+            oplog.seed = (unsigned int)strtoul (argv[++i], NULL, 0);
+        }
+        else if (strcmp (argv[i], "-record") == 0 && i + 1 < argc) {
+            record_file = argv[++i];
+        }
+        else if (strcmp (argv[i], "-replay") == 0 && i + 1 < argc) {
+            replay_file = argv[++i];
+        }
+        else if (strcmp (argv[i], "-speed") == 0 && i + 1 < argc) {
+            oplog.speed = atof (argv[++i]);
+        }
+        else {
+            nr_loops = atoi (argv[i]);
+        }
+    }
     if (nr_loops < 0)
         nr_loops = 4;
+    if (bench.nr_ops < 0)
+        bench.nr_ops = 0;
+    if (oplog.speed < 0)
+        oplog.speed = 0;
+
+    if (replay_file) {
+        if (!open_oplog_for_replay (replay_file))
+            return -1;
+        _MG_PRINTF ("replaying operation log %s at speed %.2f\n",
+                replay_file, oplog.speed);
+    }
+    else if (record_file && !open_oplog_for_record (record_file)) {
+        return -1;
+    }
+
+    // print the seed so that any run can be repeated with -seed
+    _MG_PRINTF ("random seed: %u\n", oplog.seed);
+    srandom (oplog.seed);
+
+    if (!init_window_grid ())
+        return -1;
+
+    // the screen is not checked in bench mode
+    if (bench.nr_ops == 0)
+        init_screen_verifier ();
+
+    // a log is replayed for all the loops in it
+    for (int i = 0; oplog.replaying || i < nr_loops; i++) {
+        if (!begin_oplog_loop (i))
+            break;
 
-    for (int i = 0; i < nr_loops; i++) {
         _WRN_PRINTF ("Starting loop %d.\n", i);
-        if (test_main_entry ())
+        if (test_main_entry ()) {
+            deinit_screen_verifier ();
+            deinit_window_grid ();
+            close_oplog ();
             return -1;
+        }
+        end_oplog_loop ();
         _WRN_PRINTF ("==================================\n\n");
     }
 
-    return 0;
+    deinit_screen_verifier ();
+    deinit_window_grid ();
+    close_oplog ();
+    return oplog.failed ? -1 : 0;
 }
 
 #else   /* not defined _MGSCHEMA_COMPOSITING */
@@ -0,0 +1,394 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//                        IMPORTANT LEGAL NOTICE
+//
+// The following open source license statement does not apply to any
+// entity in the Exception List published by FMSoft.
+//
+// For more information, please visit:
+//
+// https://www.fmsoft.cn/exception-list
+//
+//////////////////////////////////////////////////////////////////////////////
+/*
+**  The client of the z-order bench for MiniGUI-Processes.
+**
+**  This program is launched by `mginit -zorder-bench`, one for every
+**  z-order level. It creates some main windows in its level, connects to
+**  mginit over a local socket, then runs a random z-order operation on
+**  one of its windows every time mginit asks it to. The time when the
+**  operation starts and returns is sent back to mginit, which gets the
+**  time when the server changes the z-order from OnZNodeOperation.
+**
+**  Usage: zorderproc <level>
+**
+**  The following APIs are covered:
+**
+**      CreateMainWindow
+**      DestroyMainWindow
+**      MainWindowCleanup
+**      ShowWindow
+**      MoveWindow
+**      RegisterListenFD
+**      UnregisterListenFD
+**      WS_EX_WINTYPE_TOOLTIP
+**      WS_EX_WINTYPE_SCREENLOCK
+**      WS_EX_WINTYPE_DOCKER
+**      WS_EX_WINTYPE_HIGHER
+**      WS_EX_WINTYPE_NORMAL
+**      WS_EX_WINTYPE_LAUNCHER
+**      MSG_FDEVENT
+**
+** Copyright (C) 2020 FMSoft (http://www.fmsoft.cn).
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <minigui/common.h>
+#include <minigui/minigui.h>
+#include <minigui/gdi.h>
+#include <minigui/window.h>
+
+#include "helpers.h"
+#include "zorderproc.h"
+
+#ifdef _MGRM_PROCESSES
+
+static const struct level_template {
+    DWORD       type;
+    gal_pixel   bkcolor;
+    const char *name;
+} level_templates [] = {
+    { WS_EX_WINTYPE_TOOLTIP,    0xFFFFFF00, "tooltip" },
+    { WS_EX_WINTYPE_SCREENLOCK, 0xFF00FFFF, "screenlock" },
+    { WS_EX_WINTYPE_DOCKER,     0xFFFF0000, "docker" },
+    { WS_EX_WINTYPE_HIGHER,     0xFF000000, "higher" },
+    { WS_EX_WINTYPE_NORMAL,     0xFF0000FF, "normal" },
+    { WS_EX_WINTYPE_LAUNCHER,   0xFF00FF00, "launcher" },
+};
+
+static struct zproc_info {
+    int         level;
+    int         sock;
+    HWND        ctrl;           // receives MSG_FDEVENT; never destroyed
+    HWND        wins [NR_WINS_PER_CLIENT];
+    BOOL        visible [NR_WINS_PER_CLIENT];
+} zproc;
+
+static LRESULT
+TestWinProc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
+{
+    return DefaultMainWinProc (hwnd, message, wparam, lparam);
+}
+
+static void get_random_rect (RECT *rc)
+{
+    int width = RECTW (g_rcScr) / 4;
+    int height = RECTH (g_rcScr) / 4;
+
+    rc->left = random () % (RECTW (g_rcScr) - width);
+    rc->top = random () % (RECTH (g_rcScr) - height);
+    rc->right = rc->left + width / 2 + random () % (width / 2);
+    rc->bottom = rc->top + height / 2 + random () % (height / 2);
+}
+
+static HWND create_test_window (int idx)
+{
+    MAINWINCREATE create_info;
+    char caption [64];
+    RECT rc;
+
+    get_random_rect (&rc);
+    snprintf (caption, sizeof (caption), "A %s window #%d of %d",
+            level_templates [zproc.level].name, idx, getpid ());
+
+    create_info.dwStyle = WS_VISIBLE | WS_BORDER | WS_CAPTION;
+    create_info.dwExStyle = level_templates [zproc.level].type;
+    create_info.spCaption = caption;
+    create_info.hMenu = 0;
+    create_info.hCursor = GetSystemCursor (0);
+    create_info.hIcon = 0;
+    create_info.MainWindowProc = TestWinProc;
+    create_info.lx = rc.left;
+    create_info.ty = rc.top;
+    create_info.rx = rc.right;
+    create_info.by = rc.bottom;
+    create_info.iBkColor = level_templates [zproc.level].bkcolor;
+    create_info.dwAddData = 0;
+    create_info.hHosting = HWND_DESKTOP;
+
+    return CreateMainWindow (&create_info);
+}
+
+static void destroy_test_window (int idx)
+{
+    DestroyMainWindow (zproc.wins [idx]);
+    MainWindowCleanup (zproc.wins [idx]);
+    zproc.wins [idx] = HWND_NULL;
+    zproc.visible [idx] = FALSE;
+}
+
+static BOOL send_to_server (zproc_msg_t *msg)
+{
+    msg->level = zproc.level;
+    msg->pid = getpid ();
+    return send (zproc.sock, msg, sizeof (zproc_msg_t), 0) ==
+        sizeof (zproc_msg_t);
+}
+
+static void run_random_operation (void)
+{
+    zproc_msg_t msg = { ZPROC_MSG_DONE };
+    int idx = random () % NR_WINS_PER_CLIENT;
+    HWND hwnd = zproc.wins [idx];
+    RECT rc;
+
+    if (hwnd == HWND_NULL) {
+        msg.op = ZPROC_OP_CREATE;
+    }
+    else {
+        msg.op = random () % ZPROC_OP_CREATE;
+        if (msg.op == ZPROC_OP_SHOW && zproc.visible [idx])
+            msg.op = ZPROC_OP_HIDE;
+        else if (msg.op == ZPROC_OP_HIDE && !zproc.visible [idx])
+            msg.op = ZPROC_OP_SHOW;
+    }
+
+    // only the call is timed
+    get_random_rect (&rc);
+    msg.ok = TRUE;
+    msg.start_ns = get_curr_ns ();
+
+    switch (msg.op) {
+    case ZPROC_OP_SHOW:
+        ShowWindow (hwnd, SW_SHOW);
+        break;
+
+    case ZPROC_OP_HIDE:
+        ShowWindow (hwnd, SW_HIDE);
+        break;
+
+    case ZPROC_OP_RAISE:
+        ShowWindow (hwnd, SW_SHOWNORMAL);
+        break;
+
+    case ZPROC_OP_MOVE:
+        MoveWindow (hwnd, rc.left, rc.top, RECTW (rc), RECTH (rc), TRUE);
+        break;
+
+    case ZPROC_OP_DESTROY:
+        DestroyMainWindow (hwnd);
+        break;
+
+    case ZPROC_OP_CREATE:
+        hwnd = create_test_window (idx);
+        break;
+    }
+
+    msg.return_ns = get_curr_ns ();
+
+    switch (msg.op) {
+    case ZPROC_OP_SHOW:
+    case ZPROC_OP_RAISE:
+        zproc.visible [idx] = TRUE;
+        break;
+
+    case ZPROC_OP_HIDE:
+        zproc.visible [idx] = FALSE;
+        break;
+
+    case ZPROC_OP_DESTROY:
+        MainWindowCleanup (hwnd);
+        zproc.wins [idx] = HWND_NULL;
+        zproc.visible [idx] = FALSE;
+        break;
+
+    case ZPROC_OP_CREATE:
+        if (hwnd == HWND_INVALID) {
+            _ERR_PRINTF ("failed to create a window in level %s\n",
+                    level_templates [zproc.level].name);
+            msg.ok = FALSE;
+        }
+        else {
+            zproc.wins [idx] = hwnd;
+            zproc.visible [idx] = TRUE;
+        }
+        break;
+    }
+
+    if (!send_to_server (&msg))
+        PostQuitMessage (zproc.ctrl);
+}
+
+static void on_server_event (void)
+{
+    zproc_msg_t msg;
+
+    if (recv (zproc.sock, &msg, sizeof (msg), 0) != sizeof (msg)) {
+        // mginit has gone
+        PostQuitMessage (zproc.ctrl);
+        return;
+    }
+
+    if (msg.type == ZPROC_MSG_GO)
+        run_random_operation ();
+    else if (msg.type == ZPROC_MSG_QUIT)
+        PostQuitMessage (zproc.ctrl);
+}
+
+static LRESULT
+CtrlWinProc (HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
+{
+    if (message == MSG_FDEVENT) {
+        on_server_event ();
+        return 0;
+    }
+
+    return DefaultMainWinProc (hwnd, message, wparam, lparam);
+}
+
+static BOOL connect_to_server (void)
+{
+    struct sockaddr_un addr;
+
+    zproc.sock = socket (AF_UNIX, SOCK_SEQPACKET, 0);
+    if (zproc.sock < 0)
+        return FALSE;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    strcpy (addr.sun_path, ZORDER_BENCH_SOCKET);
+    if (connect (zproc.sock, (struct sockaddr *)&addr, sizeof (addr))) {
+        close (zproc.sock);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static int test_main_entry (void)
+{
+    MAINWINCREATE create_info;
+    zproc_msg_t msg = { ZPROC_MSG_HELLO };
+    MSG Msg;
+
+    // an invisible window which is not touched by the operations
+    create_info.dwStyle = WS_NONE;
+    create_info.dwExStyle = WS_EX_NONE;
+    create_info.spCaption = "The control window of zorderproc";
+    create_info.hMenu = 0;
+    create_info.hCursor = GetSystemCursor (0);
+    create_info.hIcon = 0;
+    create_info.MainWindowProc = CtrlWinProc;
+    create_info.lx = 0;
+    create_info.ty = 0;
+    create_info.rx = 1;
+    create_info.by = 1;
+    create_info.iBkColor = PIXEL_lightwhite;
+    create_info.dwAddData = 0;
+    create_info.hHosting = HWND_DESKTOP;
+
+    zproc.ctrl = CreateMainWindow (&create_info);
+    if (zproc.ctrl == HWND_INVALID) {
+        _ERR_PRINTF ("FATAL ERROR: failed to create the control window\n");
+        return -1;
+    }
+
+    for (int i = 0; i < NR_WINS_PER_CLIENT; i++) {
+        zproc.wins [i] = create_test_window (i);
+        if (zproc.wins [i] == HWND_INVALID) {
+            _ERR_PRINTF ("FATAL ERROR: failed to create a window in %s\n",
+                    level_templates [zproc.level].name);
+            zproc.wins [i] = HWND_NULL;
+            goto error;
+        }
+        zproc.visible [i] = TRUE;
+    }
+
+    if (!connect_to_server ()) {
+        _ERR_PRINTF ("FATAL ERROR: failed to connect to %s\n",
+                ZORDER_BENCH_SOCKET);
+        goto error;
+    }
+
+    RegisterListenFD (zproc.sock, POLLIN, zproc.ctrl, NULL);
+    if (!send_to_server (&msg)) {
+        _ERR_PRINTF ("FATAL ERROR: failed to say hello to mginit\n");
+        UnregisterListenFD (zproc.sock);
+        close (zproc.sock);
+        goto error;
+    }
+
+    while (GetMessage (&Msg, zproc.ctrl)) {
+        DispatchMessage (&Msg);
+    }
+
+    UnregisterListenFD (zproc.sock);
+    close (zproc.sock);
+
+    for (int i = 0; i < NR_WINS_PER_CLIENT; i++) {
+        if (zproc.wins [i])
+            destroy_test_window (i);
+    }
+    DestroyMainWindow (zproc.ctrl);
+    MainWindowCleanup (zproc.ctrl);
+    return 0;
+
+error:
+    for (int i = 0; i < NR_WINS_PER_CLIENT; i++) {
+        if (zproc.wins [i])
+            destroy_test_window (i);
+    }
+    DestroyMainWindow (zproc.ctrl);
+    MainWindowCleanup (zproc.ctrl);
+    return -1;
+}
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    JoinLayer (NAME_DEF_LAYER , "zorderproc" , 0 , 0);
+
+    if (argc < 2) {
+        _ERR_PRINTF ("Usage: %s <level>\n", argv[0]);
+        return -1;
+    }
+
+    zproc.level = atoi (argv[1]);
+    if (zproc.level < 0 || zproc.level >= NR_ZPROC_LEVELS) {
+        _ERR_PRINTF ("Bad level: %s\n", argv[1]);
+        return -1;
+    }
+
+    srandom (getpid ());
+    return test_main_entry ();
+}
+
+#else   /* defined _MGRM_PROCESSES */
+
+int MiniGUIMain (int argc, const char* argv[])
+{
+    _WRN_PRINTF ("This test program is a client of `mginit -zorder-bench` "
+           "for MiniGUI-Processes runtime mode. But your MiniGUI was not "
+           "configured as MiniGUI-Processes\n");
+    return 0;
+}
+
+#endif  /* not defined _MGRM_PROCESSES */
@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//                        IMPORTANT LEGAL NOTICE
+//
+// The following open source license statement does not apply to any
+// entity in the Exception List published by FMSoft.
+//
+// For more information, please visit:
+//
+// https://www.fmsoft.cn/exception-list
+//
+//////////////////////////////////////////////////////////////////////////////
+/*
+** zorderproc.h:
+**  The protocol between mginit and zorderproc for the z-order bench
+**  under MiniGUI-Processes.
+**
+** Copyright (C) 2020 FMSoft (http://www.fmsoft.cn).
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef _MG_TESTS_ZORDERPROC
+    #define _MG_TESTS_ZORDERPROC
+
+#include <sys/types.h>
+
+/* a SOCK_SEQPACKET socket in the local namespace listened by mginit */
+#define ZORDER_BENCH_SOCKET     "/tmp/mginit-zorder-bench"
+
+/* the windows created by every client */
+#define NR_WINS_PER_CLIENT      4
+
+/* the levels have a client each; the global level is only for the server */
+enum {
+    ZPROC_LEVEL_TOOLTIP = 0,
+    ZPROC_LEVEL_SCREENLOCK,
+    ZPROC_LEVEL_DOCKER,
+    ZPROC_LEVEL_HIGHER,
+    ZPROC_LEVEL_NORMAL,
+    ZPROC_LEVEL_LAUNCHER,
+    NR_ZPROC_LEVELS,
+};
+
+/* the operations have the same names as the ones of zorder -bench */
+enum {
+    ZPROC_OP_SHOW = 0,
+    ZPROC_OP_HIDE,
+    ZPROC_OP_RAISE,
+    ZPROC_OP_MOVE,
+    ZPROC_OP_DESTROY,
+    ZPROC_OP_CREATE,
+    NR_ZPROC_OPS,
+};
+
+enum {
+    ZPROC_MSG_HELLO = 0,    // client -> mginit: the windows are created
+    ZPROC_MSG_GO,           // mginit -> client: run an operation
+    ZPROC_MSG_DONE,         // client -> mginit: the operation returned
+    ZPROC_MSG_QUIT,         // mginit -> client: destroy windows and exit
+};
+
+typedef struct zproc_msg {
+    int         type;
+    int         level;
+    int         op;
+    BOOL        ok;
+    pid_t       pid;
+    Uint64      start_ns;   // CLOCK_MONOTONIC is shared by the processes
+    Uint64      return_ns;
+} zproc_msg_t;
+
+#endif  /* _MG_TESTS_ZORDERPROC */
+